@@ -0,0 +1,822 @@
+// Author: Caden LeCluyse
+
+// Benchmarks the parse, build, evaluate, format, and destroy phases on generated expressions.
+// The suite times seeded random expressions of each kind the calculator handles across a range of precisions,
+// and the depth sweep grows expressions that nest as deep as they are long. Everything runs on a thread with
+// a small fixed stack, so anything that still recursed per level of nesting would crash instead of finishing.
+// The startup benchmark runs the ccalc binary on one expression at a time, to time a whole one shot call.
+// The parallel benchmark evaluates the same big trees on one thread and split across several, and checks that
+// both give the same bits.
+// Results print as a table, or as one JSON object per line with --json so runs can be compared between versions
+#include <fcntl.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "ast/ast.h"
+#include "include/types.hpp"
+#include "include/value.hpp"
+#include "lib/ccalc.h"
+#include "memory/memory.h"
+#include "parallel/pool.h"
+#include "parser/parser.h"
+#include "startup/startup.h"
+#include "version.hpp"
+
+using namespace Types;
+
+namespace {
+
+inline constexpr std::size_t bench_stack_size = 256 * 1024;
+inline constexpr std::size_t default_max_tokens = 10'000'000;
+inline constexpr std::size_t min_tokens = 10'000;
+inline constexpr std::size_t default_repeats = 5;
+inline constexpr unsigned long default_seed = 1;
+inline constexpr long default_precisions[] = {64, 320, 1024, 4096};
+inline constexpr std::size_t default_startup_runs = 50;
+inline constexpr std::size_t default_batch_size = 10'000;
+
+// One shot calls, from the one that needs the least state to the one that reads the saved variables
+struct StartupCase {
+    std::string_view name;
+    const char* argument;
+};
+
+inline constexpr StartupCase startup_cases[] = {
+    {"version", "-v"},
+    {"integer", "2+2"},
+    {"float", "1/3"},
+    {"variable", "ans+1"},
+};
+
+struct Generated {
+    std::string expression;
+    std::size_t depth;
+};
+
+// ((((1+1))))
+[[nodiscard]] Generated nested_parens(const std::size_t tokens) {
+    const std::size_t depth = (tokens - 3) / 2;
+    return Generated{std::string(depth, '(') + "1+1" + std::string(depth, ')'), depth};
+}
+
+// 1+(1+(1+(...)))
+[[nodiscard]] Generated right_chain_math(const std::size_t tokens) {
+    const std::size_t depth = (tokens - 1) / 4;
+    std::string expression;
+    expression.reserve(tokens);
+    for (std::size_t i = 0; i < depth; ++i) expression += "1+(";
+    expression += '1';
+    expression.append(depth, ')');
+    return Generated{std::move(expression), depth};
+}
+
+// 1-1+1-1+... is one long left leaning chain
+[[nodiscard]] Generated left_chain_math(const std::size_t tokens) {
+    const std::size_t depth = (tokens - 1) / 2;
+    std::string expression;
+    expression.reserve(tokens);
+    expression += '1';
+    for (std::size_t i = 0; i < depth; ++i) expression += i % 2 ? "+1" : "-1";
+    return Generated{std::move(expression), depth};
+}
+
+// F|!(!(!(T))), a leading ! would be read as a factorial
+[[nodiscard]] Generated not_chain_bool(const std::size_t tokens) {
+    const std::size_t depth = (tokens - 3) / 3;
+    std::string expression;
+    expression.reserve(tokens);
+    expression += "F|";
+    for (std::size_t i = 0; i < depth; ++i) expression += "!(";
+    expression += 'T';
+    expression.append(depth, ')');
+    return Generated{std::move(expression), depth};
+}
+
+// T&(F|(T&(...)))
+[[nodiscard]] Generated right_chain_bool(const std::size_t tokens) {
+    const std::size_t depth = (tokens - 1) / 4;
+    std::string expression;
+    expression.reserve(tokens);
+    for (std::size_t i = 0; i < depth; ++i) expression += i % 2 ? "F|(" : "T&(";
+    expression += 'T';
+    expression.append(depth, ')');
+    return Generated{std::move(expression), depth};
+}
+
+struct DepthCase {
+    std::string_view name;
+    Generated (*generate)(const std::size_t tokens);
+};
+
+inline constexpr DepthCase depth_cases[] = {
+    {"nested_parens", nested_parens},
+    {"right_chain_math", right_chain_math},
+    {"left_chain_math", left_chain_math},
+    {"not_chain_bool", not_chain_bool},
+    {"right_chain_bool", right_chain_bool},
+};
+
+// The random generators only produce expressions that parse, so a parse failure in the suite is a bug
+using Rng = std::mt19937_64;
+
+[[nodiscard]] std::size_t random_between(Rng& rng, const std::size_t low, const std::size_t high) {
+    return std::uniform_int_distribution<std::size_t>(low, high)(rng);
+}
+
+[[nodiscard]] char random_of(Rng& rng, const std::string_view choices) {
+    return choices[random_between(rng, 0, choices.size() - 1)];
+}
+
+void append_decimal(Rng& rng, std::string& expression) {
+    expression += std::to_string(random_between(rng, 0, 99));
+    expression += '.';
+    expression += std::to_string(random_between(rng, 1, 9999));
+}
+
+// 3.5*(12.25/(7.1-(...)))
+[[nodiscard]] std::string deep_nesting(Rng& rng, const std::size_t depth) {
+    std::string expression;
+    for (std::size_t i = 0; i < depth; ++i) {
+        append_decimal(rng, expression);
+        expression += random_of(rng, "+-*/");
+        expression += '(';
+    }
+    append_decimal(rng, expression);
+    expression.append(depth, ')');
+    return expression;
+}
+
+// 1.5+22.75-3.125+...
+[[nodiscard]] std::string wide_sum(Rng& rng, const std::size_t terms) {
+    std::string expression;
+    append_decimal(rng, expression);
+    for (std::size_t i = 1; i < terms; ++i) {
+        expression += random_of(rng, "+-");
+        append_decimal(rng, expression);
+    }
+    return expression;
+}
+
+// SIN(1.5)*COS(2.25)+TAN(0.5)-..., the parser expects uppercase input
+[[nodiscard]] std::string trig_heavy(Rng& rng, const std::size_t terms) {
+    static constexpr std::string_view functions[] = {"SIN(", "COS(", "TAN("};
+    std::string expression;
+    for (std::size_t i = 0; i < terms; ++i) {
+        if (i) expression += random_of(rng, "+-*");
+        expression += functions[random_between(rng, 0, 2)];
+        append_decimal(rng, expression);
+        expression += ')';
+    }
+    return expression;
+}
+
+// 37^412+1500!-...
+[[nodiscard]] std::string bigint(Rng& rng, const std::size_t terms) {
+    std::string expression;
+    for (std::size_t i = 0; i < terms; ++i) {
+        if (i) expression += random_of(rng, "+-");
+        if (random_between(rng, 0, 1)) {
+            expression += std::to_string(random_between(rng, 2, 99)) + '^' + std::to_string(random_between(rng, 100, 1000));
+        } else {
+            expression += std::to_string(random_between(rng, 100, 2000)) + '!';
+        }
+    }
+    return expression;
+}
+
+// T&(!F|(T^F))@..., parentheses open before an operand and close after one
+[[nodiscard]] std::string boolean(Rng& rng, const std::size_t terms) {
+    std::string expression;
+    std::size_t open = 0;
+    for (std::size_t i = 0; i < terms; ++i) {
+        if (i) expression += random_of(rng, "&|^@$");
+        while (random_between(rng, 0, 3) == 0) {
+            if (random_between(rng, 0, 1)) expression += '!';
+            expression += '(';
+            ++open;
+        }
+        if (random_between(rng, 0, 3) == 0) expression += '!';
+        expression += random_of(rng, "TF");
+        while (open && random_between(rng, 0, 2) == 0) {
+            expression += ')';
+            --open;
+        }
+    }
+    expression.append(open, ')');
+    return expression;
+}
+
+struct SuiteCase {
+    std::string_view name;
+    std::string (*generate)(Rng& rng, const std::size_t size);
+    std::size_t size;
+    bool uses_precision; // Integer and boolean cases only run once, at the configured precision
+};
+
+inline constexpr SuiteCase suite_cases[] = {
+    {"deep_nesting", deep_nesting, 2'000, true},
+    {"wide_sum", wide_sum, 10'000, true},
+    {"trig_heavy", trig_heavy, 1'000, true},
+    {"bigint", bigint, 200, false},
+    {"boolean", boolean, 20'000, false},
+};
+
+// Small expressions evaluated one after another, the way file mode and ccalc_eval_batch go through them
+struct BatchCase {
+    std::string_view name;
+    std::string (*generate)(Rng& rng, const std::size_t size);
+    std::size_t size;
+};
+
+inline constexpr BatchCase batch_cases[] = {
+    {"small_sum", wide_sum, 4},
+    {"small_nesting", deep_nesting, 4},
+    {"small_trig", trig_heavy, 2},
+    {"small_bigint", bigint, 1},
+    {"small_boolean", boolean, 8},
+};
+
+// Big floating point trees, evaluated on one thread and then split between threads
+struct ParallelCase {
+    std::string_view name;
+    std::string (*generate)(Rng& rng, const std::size_t size);
+    std::size_t size;
+};
+
+// Deep nesting has nothing to split, so it shows what planning costs a tree that stays on one thread
+inline constexpr ParallelCase parallel_cases[] = {
+    {"trig_heavy", trig_heavy, 2'000},
+    {"deep_nesting", deep_nesting, 2'000},
+};
+
+struct PhaseTimes {
+    double parse = 0;
+    double build = 0;
+    double evaluate = 0;
+    double format = 0;
+    double destroy = 0;
+};
+
+using Clock = std::chrono::steady_clock;
+
+[[nodiscard]] double seconds_since(const Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Formatting is timed without printing, with the conversion the calculator uses
+[[nodiscard]] std::size_t format_float(const mpfr_t& value) {
+    return CCalc::format_mpfr(value, Startup::settings().at(Setting::DISPLAY_PREC)).size();
+}
+
+[[nodiscard]] MathSettings configured_settings() {
+    const CCalc::Settings settings = Startup::calculator_settings();
+    return MathSettings{settings.precision, settings.degrees};
+}
+
+// Returns false if the expression didn't parse
+[[nodiscard]] bool run_case(const std::string_view expression, const MathSettings& settings, Parse::Parser& parser,
+                            PhaseTimes& times) {
+    static const VarMap no_vars;
+
+    auto start = Clock::now();
+    const ParseResult& result = parser.parse(expression, no_vars);
+    times.parse = seconds_since(start);
+    if (!result.success) {
+        std::cerr << "Parse failed: " << result.error_msg << '\n';
+        return false;
+    }
+
+    if (result.is_math) {
+        start = Clock::now();
+        auto tree = std::make_unique<MathAST>();
+        tree->build_ast(result.result, result.literals, no_vars, result.is_floating_point, settings);
+        times.build = seconds_since(start);
+        if (result.is_floating_point) {
+            start = Clock::now();
+            const mpfr_t& value = tree->evaluate_floating_point();
+            times.evaluate = seconds_since(start);
+            start = Clock::now();
+            [[maybe_unused]] const std::size_t length = format_float(value);
+            times.format = seconds_since(start);
+        } else {
+            start = Clock::now();
+            const mpz_class value = tree->evaluate();
+            times.evaluate = seconds_since(start);
+            start = Clock::now();
+            [[maybe_unused]] const std::string formatted = value.get_str();
+            times.format = seconds_since(start);
+        }
+        start = Clock::now();
+        tree.reset();
+        times.destroy = seconds_since(start);
+    } else {
+        start = Clock::now();
+        auto tree = std::make_unique<BoolAST>();
+        tree->build_ast(result.result);
+        times.build = seconds_since(start);
+        start = Clock::now();
+        [[maybe_unused]] const bool value = tree->evaluate();
+        times.evaluate = seconds_since(start);
+        start = Clock::now();
+        tree.reset();
+        times.destroy = seconds_since(start);
+    }
+    return true;
+}
+
+// The median of each phase on its own, so one slow repeat doesn't skew the others
+[[nodiscard]] PhaseTimes median_times(std::vector<PhaseTimes>& runs) {
+    const auto median = [&runs](double PhaseTimes::*phase) {
+        std::ranges::sort(runs, {}, phase);
+        return runs[runs.size() / 2].*phase;
+    };
+    return PhaseTimes{median(&PhaseTimes::parse), median(&PhaseTimes::build), median(&PhaseTimes::evaluate),
+                      median(&PhaseTimes::format), median(&PhaseTimes::destroy)};
+}
+
+struct BenchArgs {
+    std::size_t max_tokens = default_max_tokens;
+    std::size_t repeats = default_repeats;
+    unsigned long seed = default_seed;
+    std::vector<long> precisions{std::begin(default_precisions), std::end(default_precisions)};
+    bool json = false;
+    std::size_t startup_runs = default_startup_runs;
+    std::string ccalc_path;
+    bool run_suite = true;
+    bool run_depth = true;
+    bool run_startup = false;
+    bool run_allocator = false;
+    bool run_parallel = false;
+    std::size_t batch_size = default_batch_size;
+    unsigned threads = 0;
+    int exit_code = 0;
+};
+
+void print_json_times(const PhaseTimes& times) {
+    const auto nanoseconds = [](const double seconds) { return static_cast<long long>(seconds * 1e9); };
+    std::cout << "\"parse_ns\":" << nanoseconds(times.parse) << ",\"build_ns\":" << nanoseconds(times.build)
+              << ",\"eval_ns\":" << nanoseconds(times.evaluate) << ",\"format_ns\":" << nanoseconds(times.format)
+              << ",\"free_ns\":" << nanoseconds(times.destroy) << "}\n";
+}
+
+void print_suite_row(const BenchArgs& args, const SuiteCase& suite_case, const long precision,
+                     const std::size_t length, const PhaseTimes& times) {
+    if (args.json) {
+        std::cout << "{\"bench\":\"suite\",\"case\":\"" << suite_case.name << "\",\"seed\":" << args.seed
+                  << ",\"precision\":" << precision << ",\"length\":" << length << ",\"repeats\":" << args.repeats
+                  << ',';
+        print_json_times(times);
+        return;
+    }
+    const auto microseconds = [](const double seconds) { return seconds * 1e6; };
+    std::cout << std::left << std::setw(18) << suite_case.name << std::right << std::setw(10);
+    if (suite_case.uses_precision) {
+        std::cout << precision;
+    } else {
+        std::cout << '-';
+    }
+    std::cout << std::setw(10) << length << std::setw(12) << microseconds(times.parse) << std::setw(12)
+              << microseconds(times.build) << std::setw(12) << microseconds(times.evaluate) << std::setw(12)
+              << microseconds(times.format) << std::setw(12) << microseconds(times.destroy) << '\n';
+}
+
+void print_depth_row(const BenchArgs& args, const std::string_view name, const std::size_t length,
+                     const std::size_t depth, const PhaseTimes& times) {
+    if (args.json) {
+        std::cout << "{\"bench\":\"depth\",\"case\":\"" << name << "\",\"length\":" << length
+                  << ",\"depth\":" << depth << ',';
+        print_json_times(times);
+        return;
+    }
+    const auto per_token = [length](const double seconds) { return seconds * 1e9 / static_cast<double>(length); };
+    std::cout << std::left << std::setw(18) << name << std::right << std::setw(10) << length << std::setw(10) << depth
+              << std::setw(12) << per_token(times.parse) << std::setw(12) << per_token(times.build) << std::setw(12)
+              << per_token(times.evaluate) << std::setw(12) << per_token(times.destroy) << std::setw(12)
+              << (times.parse + times.build + times.evaluate + times.destroy) * 1000 << '\n';
+}
+
+// Every case gets its own generator seeded from the run's seed, so adding a case doesn't change the others.
+// The precision is passed to the tree when it is built, so each run can use its own
+[[nodiscard]] bool run_suite(const BenchArgs& args, Parse::Parser& parser) {
+    if (!args.json) {
+        std::cout << "Seed: " << args.seed << ", median of " << args.repeats << " runs\n"
+                  << std::left << std::setw(18) << "case" << std::right << std::setw(10) << "precision"
+                  << std::setw(10) << "length" << std::setw(12) << "parse us" << std::setw(12) << "build us"
+                  << std::setw(12) << "eval us" << std::setw(12) << "format us" << std::setw(12) << "free us" << '\n';
+    }
+    const MathSettings configured = configured_settings();
+    std::size_t case_index = 0;
+    for (const auto& suite_case : suite_cases) {
+        Rng rng(args.seed * 1'000'003 + case_index++);
+        const std::string expression = suite_case.generate(rng, suite_case.size);
+        const std::size_t num_precisions = suite_case.uses_precision ? args.precisions.size() : 1;
+        for (std::size_t i = 0; i < num_precisions; ++i) {
+            const long precision = suite_case.uses_precision ? args.precisions[i] : configured.precision;
+            const MathSettings settings{precision, configured.degrees};
+            std::vector<PhaseTimes> runs(args.repeats);
+            for (auto& times : runs) {
+                if (!run_case(expression, settings, parser, times)) return false;
+            }
+            print_suite_row(args, suite_case, precision, expression.size(), median_times(runs));
+        }
+    }
+    return true;
+}
+
+[[nodiscard]] bool run_depth_sweep(const BenchArgs& args, Parse::Parser& parser) {
+    if (!args.json) {
+        std::cout << "Stack size: " << bench_stack_size / 1024 << " KiB\n"
+                  << std::left << std::setw(18) << "case" << std::right << std::setw(10) << "tokens" << std::setw(10)
+                  << "depth" << std::setw(12) << "parse ns/t" << std::setw(12) << "build ns/t" << std::setw(12)
+                  << "eval ns/t" << std::setw(12) << "free ns/t" << std::setw(12) << "total ms" << '\n';
+    }
+    for (const auto& depth_case : depth_cases) {
+        for (std::size_t tokens = min_tokens; tokens <= args.max_tokens; tokens *= 10) {
+            const Generated generated = depth_case.generate(tokens);
+            PhaseTimes times;
+            if (!run_case(generated.expression, configured_settings(), parser, times)) return false;
+            print_depth_row(args, depth_case.name, generated.expression.size(), generated.depth, times);
+        }
+    }
+    return true;
+}
+
+// Returns the wall time of one run in seconds, or a negative value if ccalc couldn't be started
+[[nodiscard]] double time_startup(const std::string& ccalc_path, const char* const argument) {
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    char* const spawn_argv[] = {const_cast<char*>(ccalc_path.c_str()), const_cast<char*>(argument), nullptr};
+
+    const auto start = Clock::now();
+    pid_t pid;
+    const int spawned = posix_spawn(&pid, ccalc_path.c_str(), &actions, nullptr, spawn_argv, environ);
+    int status = 0;
+    if (spawned == 0) waitpid(pid, &status, 0);
+    const double seconds = seconds_since(start);
+    posix_spawn_file_actions_destroy(&actions);
+    if (spawned != 0 || !WIFEXITED(status) || WEXITSTATUS(status) == 127) return -1;
+    return seconds;
+}
+
+[[nodiscard]] bool run_startup(const BenchArgs& args) {
+    if (!args.json) {
+        std::cout << "Binary: " << args.ccalc_path << ", " << args.startup_runs << " runs\n"
+                  << std::left << std::setw(18) << "case" << std::right << std::setw(12) << "median us"
+                  << std::setw(12) << "min us" << '\n';
+    }
+    for (const auto& startup_case : startup_cases) {
+        std::vector<double> runs(args.startup_runs);
+        for (auto& seconds : runs) {
+            seconds = time_startup(args.ccalc_path, startup_case.argument);
+            if (seconds < 0) {
+                std::cerr << "Couldn't run " << args.ccalc_path << '\n';
+                return false;
+            }
+        }
+        std::ranges::sort(runs);
+        const double median = runs[runs.size() / 2];
+        if (args.json) {
+            std::cout << "{\"bench\":\"startup\",\"case\":\"" << startup_case.name << "\",\"runs\":" << runs.size()
+                      << ",\"median_ns\":" << static_cast<long long>(median * 1e9)
+                      << ",\"min_ns\":" << static_cast<long long>(runs.front() * 1e9) << "}\n";
+        } else {
+            std::cout << std::left << std::setw(18) << startup_case.name << std::right << std::setw(12)
+                      << median * 1e6 << std::setw(12) << runs.front() * 1e6 << '\n';
+        }
+    }
+    return true;
+}
+
+// Runs in a child process, since GMP's memory functions can only be picked once. Writes the median seconds per
+// expression of each case to the pipe and exits
+[[noreturn]] void time_batches(const BenchArgs& args, const std::vector<std::vector<std::string>>& batches,
+                               const Memory::Allocator allocator, const int pipe_fd) {
+    // MPFR's cached constants are the only numbers that can be left from before the fork, and they came from malloc
+    mpfr_free_cache();
+    Memory::track(allocator);
+    std::vector<double> medians;
+    for (const auto& batch : batches) {
+        CCalc::Context context(Startup::calculator_settings());
+        std::vector<double> runs(args.repeats);
+        for (auto& seconds : runs) {
+            const auto start = Clock::now();
+            for (const auto& expression : batch) {
+                [[maybe_unused]] const CCalc::Result result = context.evaluate(expression);
+            }
+            seconds = seconds_since(start) / static_cast<double>(batch.size());
+        }
+        std::ranges::sort(runs);
+        medians.push_back(runs[runs.size() / 2]);
+    }
+    const auto* data = reinterpret_cast<const char*>(medians.data());
+    std::size_t remaining = medians.size() * sizeof(double);
+    while (remaining > 0) {
+        const ssize_t written = write(pipe_fd, data, remaining);
+        if (written <= 0) _exit(1);
+        data += written;
+        remaining -= static_cast<std::size_t>(written);
+    }
+    _exit(0);
+}
+
+// Returns the median seconds per expression of each case, or nothing if the child failed
+[[nodiscard]] std::vector<double> run_batches(const BenchArgs& args,
+                                              const std::vector<std::vector<std::string>>& batches,
+                                              const Memory::Allocator allocator) {
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) return {};
+    std::cout.flush();
+    const pid_t pid = fork();
+    if (pid == 0) {
+        close(pipe_fds[0]);
+        time_batches(args, batches, allocator, pipe_fds[1]);
+    }
+    close(pipe_fds[1]);
+    std::vector<double> medians(batches.size());
+    auto* data = reinterpret_cast<char*>(medians.data());
+    std::size_t remaining = medians.size() * sizeof(double);
+    while (pid > 0 && remaining > 0) {
+        const ssize_t bytes_read = read(pipe_fds[0], data, remaining);
+        if (bytes_read <= 0) break;
+        data += bytes_read;
+        remaining -= static_cast<std::size_t>(bytes_read);
+    }
+    close(pipe_fds[0]);
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+        remaining != 0) {
+        return {};
+    }
+    return medians;
+}
+
+[[nodiscard]] bool run_allocator(const BenchArgs& args) {
+    std::vector<std::vector<std::string>> batches;
+    std::size_t case_index = 0;
+    for (const auto& batch_case : batch_cases) {
+        Rng rng(args.seed * 1'000'003 + case_index++);
+        auto& batch = batches.emplace_back(args.batch_size);
+        for (auto& expression : batch) expression = batch_case.generate(rng, batch_case.size);
+    }
+    const std::vector<double> malloc_times = run_batches(args, batches, Memory::Allocator::MALLOC);
+    const std::vector<double> pool_times = run_batches(args, batches, Memory::Allocator::POOL);
+    if (malloc_times.empty() || pool_times.empty()) {
+        std::cerr << "The allocator benchmark failed\n";
+        return false;
+    }
+    if (!args.json) {
+        std::cout << "Seed: " << args.seed << ", " << args.batch_size << " expressions per batch, median of "
+                  << args.repeats << " runs\n"
+                  << std::left << std::setw(18) << "case" << std::right << std::setw(12) << "malloc ns/e"
+                  << std::setw(12) << "pool ns/e" << std::setw(12) << "speedup" << '\n';
+    }
+    for (std::size_t i = 0; i < batches.size(); ++i) {
+        if (args.json) {
+            std::cout << "{\"bench\":\"allocator\",\"case\":\"" << batch_cases[i].name << "\",\"seed\":" << args.seed
+                      << ",\"expressions\":" << args.batch_size << ",\"repeats\":" << args.repeats
+                      << ",\"malloc_ns\":" << static_cast<long long>(malloc_times[i] * 1e9)
+                      << ",\"pool_ns\":" << static_cast<long long>(pool_times[i] * 1e9) << "}\n";
+        } else {
+            std::cout << std::left << std::setw(18) << batch_cases[i].name << std::right << std::setw(12)
+                      << malloc_times[i] * 1e9 << std::setw(12) << pool_times[i] * 1e9 << std::setw(11)
+                      << malloc_times[i] / pool_times[i] << "x\n";
+        }
+    }
+    return true;
+}
+
+// Returns the median seconds to evaluate the tree, and leaves its result in value
+[[nodiscard]] double time_evaluation(const BenchArgs& args, const ParseResult& parsed, const MathSettings& settings,
+                                     mpfr_t value, std::size_t& tasks) {
+    static const VarMap no_vars;
+    MathAST tree;
+    tree.build_ast(parsed.result, parsed.literals, no_vars, true, settings);
+    tasks = tree.parallel_tasks();
+    std::vector<double> runs(args.repeats);
+    for (auto& seconds : runs) {
+        const auto start = Clock::now();
+        [[maybe_unused]] const mpfr_t& result = tree.evaluate_floating_point();
+        seconds = seconds_since(start);
+    }
+    mpfr_set_prec(value, mpfr_get_prec(tree.evaluate_floating_point()));
+    mpfr_set(value, tree.evaluate_floating_point(), MPFR_RNDN);
+    std::ranges::sort(runs);
+    return runs[runs.size() / 2];
+}
+
+[[nodiscard]] bool same_bits(const mpfr_t left, const mpfr_t right) {
+    if (mpfr_nan_p(left) || mpfr_nan_p(right)) return mpfr_nan_p(left) && mpfr_nan_p(right);
+    return mpfr_get_prec(left) == mpfr_get_prec(right) && mpfr_equal_p(left, right) &&
+           mpfr_signbit(left) == mpfr_signbit(right);
+}
+
+[[nodiscard]] bool run_parallel(const BenchArgs& args, Parse::Parser& parser) {
+    const unsigned threads = args.threads == 0 ? Parallel::hardware_threads() : args.threads;
+    if (!args.json) {
+        std::cout << "Seed: " << args.seed << ", " << threads << " threads, median of " << args.repeats << " runs\n"
+                  << std::left << std::setw(18) << "case" << std::right << std::setw(10) << "precision"
+                  << std::setw(10) << "tasks" << std::setw(12) << "serial us" << std::setw(12) << "split us"
+                  << std::setw(12) << "speedup" << '\n';
+    }
+    const MathSettings configured = configured_settings();
+    static const VarMap no_vars;
+    mpfr_t serial_value;
+    mpfr_t split_value;
+    mpfr_init2(serial_value, MPFR_PREC_MIN);
+    mpfr_init2(split_value, MPFR_PREC_MIN);
+    bool same = true;
+    std::size_t case_index = 0;
+    for (const auto& parallel_case : parallel_cases) {
+        Rng rng(args.seed * 1'000'003 + case_index++);
+        const std::string expression = parallel_case.generate(rng, parallel_case.size);
+        const ParseResult& parsed = parser.parse(expression, no_vars);
+        if (!parsed.success) {
+            std::cerr << "Parse failed: " << parsed.error_msg << '\n';
+            same = false;
+            break;
+        }
+        for (const long precision : args.precisions) {
+            std::size_t tasks = 0;
+            const double serial = time_evaluation(args, parsed, MathSettings{precision, configured.degrees, 1},
+                                                  serial_value, tasks);
+            const double split = time_evaluation(args, parsed, MathSettings{precision, configured.degrees, threads},
+                                                 split_value, tasks);
+            if (!same_bits(serial_value, split_value)) {
+                std::cerr << parallel_case.name << " at " << precision << " bits differs between one thread and "
+                          << threads << '\n';
+                same = false;
+            }
+            if (args.json) {
+                std::cout << "{\"bench\":\"parallel\",\"case\":\"" << parallel_case.name << "\",\"seed\":" << args.seed
+                          << ",\"precision\":" << precision << ",\"threads\":" << threads << ",\"tasks\":" << tasks
+                          << ",\"repeats\":" << args.repeats
+                          << ",\"serial_ns\":" << static_cast<long long>(serial * 1e9) << ",\"split_ns\":" << static_cast<long long>(split * 1e9) << "}\n";
+            } else {
+                std::cout << std::left << std::setw(18) << parallel_case.name << std::right << std::setw(10)
+                          << precision << std::setw(10) << tasks << std::setw(12) << serial * 1e6 << std::setw(12)
+                          << split * 1e6 << std::setw(11) << serial / split << "x\n";
+            }
+        }
+    }
+    mpfr_clear(serial_value);
+    mpfr_clear(split_value);
+    return same;
+}
+
+void* run_benchmarks(void* arg) {
+    auto& args = *static_cast<BenchArgs*>(arg);
+    if (args.json) {
+        std::cout << "{\"bench\":\"meta\",\"version\":\"" << PROGRAM_VERSION_MAJOR << '.' << PROGRAM_VERSION_MINOR
+                  << '.' << PROGRAM_VERSION_PATCH << "\",\"seed\":" << args.seed
+                  << ",\"display_digits\":" << Startup::settings().at(Setting::DISPLAY_PREC) << "}\n";
+    } else {
+        std::cout << std::fixed << std::setprecision(1);
+    }
+    // One parser for every case, the same as continuous mode
+    Parse::Parser parser;
+    // The allocator comparison forks, so it goes first while this process holds no numbers
+    if ((args.run_allocator && !run_allocator(args)) || (args.run_suite && !run_suite(args, parser)) ||
+        (args.run_depth && !run_depth_sweep(args, parser)) || (args.run_startup && !run_startup(args)) ||
+        (args.run_parallel && !run_parallel(args, parser))) {
+        args.exit_code = 1;
+    }
+    return nullptr;
+}
+
+[[nodiscard]] bool parse_number(const char* const text, unsigned long long& number) {
+    char* end = nullptr;
+    number = std::strtoull(text, &end, 10);
+    return end != text && *end == '\0';
+}
+
+[[nodiscard]] bool parse_precisions(const std::string_view text, std::vector<long>& precisions) {
+    precisions.clear();
+    std::size_t start = 0;
+    while (start <= text.size()) {
+        const std::size_t comma = std::min(text.find(',', start), text.size());
+        const std::string field(text.substr(start, comma - start));
+        unsigned long long precision = 0;
+        if (!parse_number(field.c_str(), precision) || precision < MPFR_PREC_MIN ||
+            precision > static_cast<unsigned long long>(MPFR_PREC_MAX)) {
+            return false;
+        }
+        precisions.push_back(static_cast<long>(precision));
+        start = comma + 1;
+    }
+    return !precisions.empty();
+}
+
+void print_usage() {
+    std::cerr << "Usage: ccalc_bench [max tokens] [options]\n"
+              << "  --suite             run the random expression suite\n"
+              << "  --depth             run the nesting depth sweep\n"
+              << "  --startup           time whole one shot runs of the ccalc binary\n"
+              << "  --allocator         compare malloc to the pool allocator on batches of small expressions\n"
+              << "  --parallel          compare big trees evaluated on one thread to split across threads\n"
+              << "                      (the suite and sweep run when none are given)\n"
+              << "  --batch-size N      expressions per allocator batch (default " << default_batch_size << ")\n"
+              << "  --threads N         threads for --parallel, 0 is one per core (default 0)\n"
+              << "  --ccalc PATH        binary for --startup (default: ccalc next to ccalc_bench)\n"
+              << "  --startup-runs N    runs per startup case, the median is reported (default "
+              << default_startup_runs << ")\n"
+              << "  --max-tokens N      largest depth sweep expression, at least " << min_tokens << " (default "
+              << default_max_tokens << ")\n"
+              << "  --seed N            seed for the random expressions (default " << default_seed << ")\n"
+              << "  --precisions A,B    precisions in bits for the floating point cases (default 64,320,1024,4096)\n"
+              << "  --repeats N         runs per suite case, the median is reported (default " << default_repeats
+              << ")\n"
+              << "  --json              print one JSON object per line\n";
+}
+
+[[nodiscard]] bool parse_args(const int argc, const char* const argv[], BenchArgs& args) {
+    bool selected = false;
+    const auto select = [&args, &selected](bool BenchArgs::*bench) {
+        if (!selected) args.run_suite = args.run_depth = false;
+        selected = true;
+        args.*bench = true;
+    };
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        unsigned long long number = 0;
+        if (arg == "--json") {
+            args.json = true;
+        } else if (arg == "--suite") {
+            select(&BenchArgs::run_suite);
+        } else if (arg == "--depth") {
+            select(&BenchArgs::run_depth);
+        } else if (arg == "--startup") {
+            select(&BenchArgs::run_startup);
+        } else if (arg == "--allocator") {
+            select(&BenchArgs::run_allocator);
+        } else if (arg == "--parallel") {
+            select(&BenchArgs::run_parallel);
+        } else if (arg == "--threads" && has_value && parse_number(argv[++i], number) &&
+                   number <= Parallel::max_threads) {
+            args.threads = static_cast<unsigned>(number);
+        } else if (arg == "--batch-size" && has_value && parse_number(argv[++i], number) && number > 0) {
+            args.batch_size = static_cast<std::size_t>(number);
+        } else if (arg == "--ccalc" && has_value) {
+            args.ccalc_path = argv[++i];
+        } else if (arg == "--startup-runs" && has_value && parse_number(argv[++i], number) && number > 0) {
+            args.startup_runs = static_cast<std::size_t>(number);
+        } else if (arg == "--seed" && has_value && parse_number(argv[++i], number)) {
+            args.seed = static_cast<unsigned long>(number);
+        } else if (arg == "--repeats" && has_value && parse_number(argv[++i], number) && number > 0) {
+            args.repeats = static_cast<std::size_t>(number);
+        } else if (arg == "--precisions" && has_value && parse_precisions(argv[++i], args.precisions)) {
+            continue;
+        } else if ((arg == "--max-tokens" && has_value && parse_number(argv[++i], number)) ||
+                   (i == 1 && parse_number(argv[i], number))) {
+            if (number < min_tokens) return false;
+            args.max_tokens = static_cast<std::size_t>(number);
+        } else {
+            return false;
+        }
+    }
+    if (args.ccalc_path.empty()) {
+        const std::string_view bench_path = argv[0];
+        const std::size_t slash = bench_path.rfind('/');
+        args.ccalc_path = (slash == std::string_view::npos ? std::string(".") : std::string(bench_path.substr(0, slash)))
+                          + "/ccalc";
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(const int argc, const char* const argv[]) {
+    BenchArgs args;
+    if (!parse_args(argc, argv, args)) {
+        print_usage();
+        return 1;
+    }
+
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, bench_stack_size);
+    pthread_t thread;
+    if (pthread_create(&thread, &attributes, run_benchmarks, &args) != 0) {
+        std::cerr << "Couldn't start the benchmark thread\n";
+        return 1;
+    }
+    pthread_join(thread, nullptr);
+    pthread_attr_destroy(&attributes);
+    return args.exit_code;
+}
@@ -2,96 +2,338 @@
 
 #include "ast/ast.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <gmpxx.h>
+#include <memory>
 #include <mpfr.h>
 #include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "include/types.hpp"
+#include "include/value.hpp"
 #include "ast/bnode.h"
 #include "ast/mnode.h"
+#include "interrupt/interrupt.h"
+#include "memory/memory.h"
+#include "parallel/pool.h"
 
 using namespace Types;
 
-std::unique_ptr<BoolNodes::BoolNode> BoolAST::rec_build_ast(const std::span<const Types::Token>& prefix_expression, std::size_t& index) {
-    const Token current_token = prefix_expression[index++];
+namespace {
 
-    if (is_bool_operand(current_token)) {
-        return std::make_unique<BoolNodes::ValueBNode>(current_token);
+// The default destructor of a node destroys its children recursively, so detach them onto a stack first
+template <typename Node>
+void destroy_tree(std::unique_ptr<Node>& root) {
+    std::vector<std::unique_ptr<Node> > pending;
+    if (root) pending.push_back(std::move(root));
+    while (!pending.empty()) {
+        std::unique_ptr<Node> node = std::move(pending.back());
+        pending.pop_back();
+        if (node->m_left_child) pending.push_back(std::move(node->m_left_child));
+        if (node->m_right_child) pending.push_back(std::move(node->m_right_child));
+    }
+}
+
+// In postfix order every operator comes right after its operands, so each node takes its children off a stack of
+// finished subtrees, and the post-order is simply the token order
+template <typename Node, typename BuildNode>
+void build_tree(std::unique_ptr<Node>& root, std::vector<Node*>& postorder, const std::size_t num_tokens,
+                BuildNode&& build_node) {
+    destroy_tree(root);
+    postorder.clear();
+    postorder.reserve(num_tokens);
+    std::vector<std::unique_ptr<Node> > pending;
+    try {
+        for (std::size_t index = 0; index < num_tokens; ++index) {
+            std::size_t num_children = 0;
+            std::unique_ptr<Node> node = build_node(index, num_children);
+            if (num_children == 2) {
+                node->m_right_child = std::move(pending.back());
+                pending.pop_back();
+            }
+            if (num_children) {
+                node->m_left_child = std::move(pending.back());
+                pending.pop_back();
+            }
+            postorder.push_back(node.get());
+            pending.push_back(std::move(node));
+        }
+    } catch (...) {
+        for (auto& node : pending) destroy_tree(node);
+        postorder.clear();
+        throw;
+    }
+    root = std::move(pending.back());
+}
+
+// A subtree that was evaluated before the rest of the tree, as its range in the post-order and its value
+template <typename Value>
+struct Evaluated {
+    std::size_t begin;
+    std::size_t end;
+    Value value;
+};
+
+// Children come before their parents in post-order, so each node finds its operands on top of the value stack.
+// Subtrees that were already evaluated are skipped over, and their value is pushed in their place
+template <typename Value, typename Node, typename Evaluate>
+Value evaluate_postorder(const std::span<Node* const> postorder, Value none, Evaluate&& evaluate,
+                         const std::type_identity_t<std::span<const Evaluated<Value> > > evaluated = {}) {
+    std::vector<Value> values;
+    std::size_t next_evaluated = 0;
+    for (std::size_t index = 0; index < postorder.size(); ++index) {
+        if (next_evaluated < evaluated.size() && evaluated[next_evaluated].begin == index) {
+            values.push_back(evaluated[next_evaluated].value);
+            index = evaluated[next_evaluated++].end - 1;
+            continue;
+        }
+        Node* const node = postorder[index];
+        if (!node->m_left_child) {
+            values.push_back(evaluate(*node, none, none));
+        } else if (!node->m_right_child) {
+            values.back() = evaluate(*node, values.back(), none);
+        } else {
+            Value right_value = std::move(values.back());
+            values.pop_back();
+            values.back() = evaluate(*node, values.back(), right_value);
+        }
+        Memory::check();
+        Interrupt::check();
+    }
+    return std::move(values.back());
+}
+
+// Handing a task to another thread takes a few microseconds, so tasks are kept well above that, and trees that
+// wouldn't make a few tasks stay on one thread
+inline constexpr double min_task_ns = 50'000;
+inline constexpr double min_parallel_ns = 200'000;
+// Threads that finish early steal from the others, which needs more tasks than threads
+inline constexpr unsigned tasks_per_thread = 4;
+
+// Rough nanoseconds for one node at a precision of limbs 64 bit limbs, fit to timings of MPFR. It only has to be
+// close enough to tell a subtree worth a task from one that isn't
+[[nodiscard]] double node_cost(const Token kind, const double limbs) {
+    switch (kind) {
+        case Token::ADD:
+        case Token::SUB:
+        case Token::UNARY:
+            return 20 + 5 * limbs;
+        case Token::MULT:
+            return 20 + 2 * limbs * std::sqrt(limbs);
+        case Token::DIV:
+        case Token::MODULO:
+            return 40 + 4 * limbs * std::sqrt(limbs);
+        case Token::SIN:
+        case Token::COS:
+        case Token::TAN:
+        case Token::LOG:
+        case Token::LN:
+        case Token::FAC:
+            return 1000 + 30 * limbs * limbs;
+        case Token::POW_XOR:
+            return 2000 + 60 * limbs * limbs;
+        default:
+            return 20; // Numbers, constants, and variables are already evaluated
+    }
+}
+
+}  // namespace
+
+BoolAST::~BoolAST() { destroy_tree(m_root); }
+
+std::unique_ptr<BoolNodes::BoolNode> BoolAST::build_node(const TypedToken token, std::size_t& num_children) const {
+    if (is_bool_operand(token.kind)) {
+        return std::make_unique<BoolNodes::ValueBNode>(token.kind);
+    }
+    if (token.kind == Token::VAR) {
+        return std::make_unique<BoolNodes::VarBNode>(token.offset);
     }
 
-    std::unique_ptr<BoolNodes::BoolNode> node;
-    if (isnot(current_token)) {
-        node = std::make_unique<BoolNodes::UnaryBNode>(current_token);
-        node->m_left_child = rec_build_ast(prefix_expression, index);
-    } else {
-        node = std::make_unique<BoolNodes::OperationBNode>(current_token);
-        node->m_left_child = rec_build_ast(prefix_expression, index);
-        node->m_right_child = rec_build_ast(prefix_expression, index);
+    if (isnot(token.kind)) {
+        num_children = 1;
+        return std::make_unique<BoolNodes::UnaryBNode>(token.kind);
     }
+    num_children = 2;
+    return std::make_unique<BoolNodes::OperationBNode>(token.kind);
+}
+
+void BoolAST::build_ast(const std::span<const TypedToken> postfix_expression) {
+    build_tree(m_root, m_postorder, postfix_expression.size(),
+               [this, &postfix_expression](const std::size_t index, std::size_t& num_children) {
+                   return build_node(postfix_expression[index], num_children);
+               });
+}
 
-    return node;
+[[nodiscard]] bool BoolAST::evaluate() const {
+    return evaluate_postorder(std::span(m_postorder), false, [](const BoolNodes::BoolNode& node,
+                                                                const bool left_value, const bool right_value) {
+        return node.evaluate(left_value, right_value);
+    });
 }
 
-void BoolAST::build_ast(const std::span<const Types::Token> prefix_expression) noexcept {
-    std::size_t index = 0;
-    m_root = rec_build_ast(prefix_expression, index);
+NodeCounts BoolAST::count_nodes() const {
+    NodeCounts counts;
+    for (const BoolNodes::BoolNode* const node : m_postorder) {
+        if (dynamic_cast<const BoolNodes::ValueBNode*>(node)) ++counts.values;
+        else if (dynamic_cast<const BoolNodes::VarBNode*>(node)) ++counts.variables;
+        else if (dynamic_cast<const BoolNodes::UnaryBNode*>(node)) ++counts.negations;
+        else ++counts.operations;
+    }
+    return counts;
 }
 
-[[nodiscard]] bool BoolAST::evaluate() const { return m_root->evaluate(); }
+MathAST::~MathAST() { destroy_tree(m_root); }
 
-std::unique_ptr<MathNodes::MathNode> MathAST::build_value_node(const std::span<const Types::Token>& prefix_expression, const bool floating_point,
-                                                               std::size_t& index) const {
-    if (is_math_var(prefix_expression[index - 1])) {
-        return std::make_unique<MathNodes::ValueMNode>(prefix_expression[index - 1]); 
+// Number literals are null terminated in the literal buffer, so the nodes can hand them straight to GMP and MPFR
+std::unique_ptr<MathNodes::MathNode> MathAST::build_node(const TypedToken token, const std::string_view literals,
+                                                         const VarMap& var_map, const bool floating_point,
+                                                         const MathSettings& settings,
+                                                         std::size_t& num_children) const {
+    const auto precision = static_cast<mpfr_prec_t>(settings.precision);
+    if (token.kind == Token::NUMBER) {
+        const std::string_view number(literals.data() + token.offset, token.length);
+        if (floating_point) {
+            return std::make_unique<MathNodes::ValueMNode>("0", number, precision);
+        }
+        return std::make_unique<MathNodes::ValueMNode>(number, "0", precision);
     }
-    std::string current_num;
-    current_num += static_cast<char>(prefix_expression[index - 1]);
-    while (index < prefix_expression.size()) {
-        const Token next_token = prefix_expression[index++];
-        if (next_token == Token::COMMA) break;
-        current_num += static_cast<char>(next_token); 
+    if (is_math_var(token.kind)) {
+        return std::make_unique<MathNodes::ValueMNode>(token.kind, precision);
+    }
+    if (token.kind == Token::VAR) {
+        return std::make_unique<MathNodes::VarMNode>(var_map.at(static_cast<char>(token.offset)), floating_point,
+                                                     precision);
     }
 
-    if (floating_point) {
-        return std::make_unique<MathNodes::ValueMNode>("0", current_num);
+    num_children = 1;
+    if (is_trig(token.kind)) {
+        return std::make_unique<MathNodes::TrigMNode>(token.kind, precision, settings.degrees);
+    } else if (token.kind == Token::FAC) {
+        return std::make_unique<MathNodes::FactorialNode>(precision);
+    } else if (token.kind == Token::UNARY) {
+        return std::make_unique<MathNodes::UnaryMNode>(precision);
     }
-    return std::make_unique<MathNodes::ValueMNode>(current_num, "0");
+    num_children = 2;
+    return std::make_unique<MathNodes::OperationMNode>(token.kind, precision);
 }
 
-std::unique_ptr<MathNodes::MathNode> MathAST::rec_build_ast(const std::span<const Types::Token>& prefix_expression,
-                                                            const bool floating_point, std::size_t& index) {
-    Token current_token = prefix_expression[index++];
-    if (current_token == Token::COMMA) {
-        current_token = prefix_expression[index++];
+void MathAST::build_ast(const std::span<const TypedToken> postfix_expression, const std::string_view literals,
+                        const VarMap& var_map, const bool floating_point, const MathSettings& settings) {
+    build_tree(m_root, m_postorder, postfix_expression.size(),
+               [this, &postfix_expression, literals, &var_map, floating_point, &settings](const std::size_t index,
+                                                                                         std::size_t& num_children) {
+                   return build_node(postfix_expression[index], literals, var_map, floating_point, settings,
+                                     num_children);
+               });
+    m_subtrees.clear();
+    m_tasks.clear();
+    if (floating_point) plan_parallel(postfix_expression, settings);
+}
+
+// Nodes whose subtree costs more than a task are left to the calling thread, to evaluate once the tasks are done.
+// Their children that cost less are handed to tasks, several to a task when they're small. For a long sum like
+// sin(1) + sin(2) + ... the additions run on the calling thread and the terms are split between the tasks
+void MathAST::plan_parallel(const std::span<const TypedToken> postfix_expression, const MathSettings& settings) {
+    m_threads = settings.threads == 0 ? Parallel::hardware_threads() : settings.threads;
+    if (m_threads <= 1) return;
+    const double limbs = std::ceil(static_cast<double>(settings.precision) / 64);
+    double total = 0;
+    for (const TypedToken token : postfix_expression) total += node_cost(token.kind, limbs);
+    if (total < min_parallel_ns) return;
+
+    // A node's right child comes right before it in post-order, and its left child right before the right child's
+    // subtree, so the cost and start of every subtree take one pass
+    const std::size_t num_nodes = m_postorder.size();
+    std::vector<double> costs(num_nodes);
+    std::vector<std::size_t> begins(num_nodes);
+    for (std::size_t index = 0; index < num_nodes; ++index) {
+        const MathNodes::MathNode* const node = m_postorder[index];
+        costs[index] = node_cost(postfix_expression[index].kind, limbs);
+        begins[index] = index;
+        if (!node->m_left_child) continue;
+        std::size_t left = index - 1;
+        if (node->m_right_child) {
+            costs[index] += costs[left];
+            left = begins[left] - 1;
+        }
+        costs[index] += costs[left];
+        begins[index] = begins[left];
     }
 
-    if (is_math_operand(current_token)) {
-        return build_value_node(prefix_expression, floating_point, index);
+    const double task_cost = std::max(min_task_ns, total / (m_threads * tasks_per_thread));
+    // Leaves cost next to nothing, so they stay with the calling thread
+    const auto add_subtree = [this, &costs, &begins, task_cost](const std::size_t child) {
+        if (costs[child] <= task_cost && begins[child] != child) m_subtrees.push_back(Range{begins[child], child + 1});
+    };
+    for (std::size_t index = 0; index < num_nodes; ++index) {
+        const MathNodes::MathNode* const node = m_postorder[index];
+        if (costs[index] <= task_cost || !node->m_left_child) continue;
+        add_subtree(index - 1);
+        if (node->m_right_child) add_subtree(begins[index - 1] - 1);
     }
+    std::ranges::sort(m_subtrees, {}, &Range::begin);
 
-    std::unique_ptr<MathNodes::MathNode> node;
-    if (is_trig(current_token)) {
-        node = std::make_unique<MathNodes::TrigMNode>(current_token);
-        node->m_left_child = rec_build_ast(prefix_expression, floating_point, index);
-    } else if (current_token == Token::FAC) {
-        node = std::make_unique<MathNodes::FactorialNode>();
-        node->m_left_child = rec_build_ast(prefix_expression, floating_point, index);
-    } else if (current_token == Token::UNARY) {
-        node = std::make_unique<MathNodes::UnaryMNode>();
-        node->m_left_child = rec_build_ast(prefix_expression, floating_point, index);
-    } else {
-        node = std::make_unique<MathNodes::OperationMNode>(current_token);
-        node->m_left_child = rec_build_ast(prefix_expression, floating_point, index);
-        node->m_right_child = rec_build_ast(prefix_expression, floating_point, index);
+    m_tasks.push_back(0);
+    double task_total = 0;
+    for (std::size_t i = 0; i < m_subtrees.size(); ++i) {
+        task_total += costs[m_subtrees[i].end - 1];
+        if (task_total < task_cost) continue;
+        m_tasks.push_back(i + 1);
+        task_total = 0;
     }
+    if (m_tasks.back() != m_subtrees.size()) m_tasks.push_back(m_subtrees.size());
+    // A single task would only add the handoff
+    if (m_tasks.size() < 3) {
+        m_subtrees.clear();
+        m_tasks.clear();
+    }
+}
 
-    return node;
+[[nodiscard]] mpz_class MathAST::evaluate() const {
+    return evaluate_postorder(std::span(m_postorder), mpz_class{}, [](const MathNodes::MathNode& node,
+                                                                      mpz_class& left_value, mpz_class& right_value) {
+        return node.evaluate(left_value, right_value);
+    });
 }
 
-void MathAST::build_ast(const std::span<const Types::Token> prefix_expression, const bool floating_point) {
-    std::size_t index = 0;
-    m_root = rec_build_ast(prefix_expression, floating_point, index);
+// The stack holds pointers to the results the nodes keep, so nothing is copied. Each node only writes its own
+// result, so the subtrees planned for tasks can be evaluated on other threads first, and MPFR rounds every
+// operation correctly, so the result is the same bit for bit as evaluating the whole tree on this thread
+[[nodiscard]] mpfr_t& MathAST::evaluate_floating_point() const {
+    const auto evaluate = [](MathNodes::MathNode& node, mpfr_t* const left_value, mpfr_t* const right_value) {
+        return &node.evaluate_float(left_value ? *left_value : nullptr, right_value ? *right_value : nullptr);
+    };
+    const std::span postorder(m_postorder);
+    std::vector<Evaluated<mpfr_t*> > evaluated;
+    if (!m_tasks.empty()) {
+        evaluated.reserve(m_subtrees.size());
+        for (const Range range : m_subtrees) evaluated.push_back(Evaluated<mpfr_t*>{range.begin, range.end, nullptr});
+        Parallel::run(m_tasks.size() - 1, m_threads, [this, &evaluated, &evaluate, postorder](const std::size_t task) {
+            for (std::size_t i = m_tasks[task]; i < m_tasks[task + 1]; ++i) {
+                Evaluated<mpfr_t*>& subtree = evaluated[i];
+                subtree.value = evaluate_postorder(postorder.subspan(subtree.begin, subtree.end - subtree.begin),
+                                                   static_cast<mpfr_t*>(nullptr), evaluate);
+            }
+        });
+    }
+    return *evaluate_postorder(postorder, static_cast<mpfr_t*>(nullptr), evaluate,
+                               std::span<const Evaluated<mpfr_t*> >(evaluated));
 }
 
-[[nodiscard]] mpz_class MathAST::evaluate() const { return m_root->evaluate(); }
-[[nodiscard]] mpfr_t& MathAST::evaluate_floating_point() const { return m_root->evaluate_float(); }
+NodeCounts MathAST::count_nodes() const {
+    NodeCounts counts;
+    for (const MathNodes::MathNode* const node : m_postorder) {
+        if (dynamic_cast<const MathNodes::ValueMNode*>(node)) ++counts.values;
+        else if (dynamic_cast<const MathNodes::VarMNode*>(node)) ++counts.variables;
+        else if (dynamic_cast<const MathNodes::TrigMNode*>(node)) ++counts.trig;
+        else if (dynamic_cast<const MathNodes::FactorialNode*>(node)) ++counts.factorials;
+        else if (dynamic_cast<const MathNodes::UnaryMNode*>(node)) ++counts.negations;
+        else ++counts.operations;
+    }
+    return counts;
+}
@@ -7,35 +7,75 @@
 #include <memory>
 #include <mpfr.h>
 #include <span>
+#include <string_view>
+#include <vector>
 
 #include "include/types.hpp"
+#include "include/value.hpp"
 #include "ast/bnode.h"
 #include "ast/mnode.h"
 
+// How many nodes of each kind a tree has. Every node that isn't a value or a variable is one operation
+struct NodeCounts {
+    std::size_t values = 0;
+    std::size_t variables = 0;
+    std::size_t operations = 0;
+    std::size_t trig = 0;
+    std::size_t factorials = 0;
+    std::size_t negations = 0; // Unary minus, or not in boolean expressions
+};
+
+// Generated expressions can nest millions of levels deep, so building, evaluating, and destroying the trees
+// all use explicit stacks instead of recursion. The nodes are kept in post-order alongside the tree,
+// which lets evaluation run as a single pass over a value stack
 class BoolAST {
    public:
     BoolAST() noexcept = default;
-    void build_ast(const std::span<const Types::Token> expression) noexcept;
+    ~BoolAST();
+    void build_ast(const std::span<const Types::TypedToken> postfix_expression);
     [[nodiscard]] bool evaluate() const;
+    [[nodiscard]] const BoolNodes::BoolNode* root() const noexcept { return m_root.get(); }
+    [[nodiscard]] NodeCounts count_nodes() const;
 
    private:
-    std::unique_ptr<BoolNodes::BoolNode> rec_build_ast(const std::span<const Types::Token>& prefix_expression, std::size_t& index);
+    std::unique_ptr<BoolNodes::BoolNode> build_node(const Types::TypedToken token, std::size_t& num_children) const;
     std::unique_ptr<BoolNodes::BoolNode> m_root;
+    std::vector<BoolNodes::BoolNode*> m_postorder;
 };
 
 class MathAST {
    public:
     MathAST() = default;
-    void build_ast(const std::span<const Types::Token> prefix_expression, const bool floating_point);
+    ~MathAST();
+    // Variables are copied into the tree, so var_map can change once it's built
+    void build_ast(const std::span<const Types::TypedToken> postfix_expression, const std::string_view literals,
+                   const Types::VarMap& var_map, const bool floating_point, const Types::MathSettings& settings);
     [[nodiscard]] mpz_class evaluate() const;
     [[nodiscard]] mpfr_t& evaluate_floating_point() const;
+    [[nodiscard]] NodeCounts count_nodes() const;
+    // How many tasks a floating point evaluation is split into, 0 if it runs on one thread
+    [[nodiscard]] std::size_t parallel_tasks() const noexcept { return m_tasks.empty() ? 0 : m_tasks.size() - 1; }
 
    private:
-    std::unique_ptr<MathNodes::MathNode> build_value_node(const std::span<const Types::Token>& prefix_expression, const bool floating_point,
-                                                          std::size_t& index) const;
-    std::unique_ptr<MathNodes::MathNode> rec_build_ast(const std::span<const Types::Token>& prefix_expression, const bool floating_point,
-                                                       std::size_t& index);
+    // A subtree in the post-order, its nodes are [begin, end)
+    struct Range {
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    void plan_parallel(const std::span<const Types::TypedToken> postfix_expression,
+                       const Types::MathSettings& settings);
+    std::unique_ptr<MathNodes::MathNode> build_node(const Types::TypedToken token, const std::string_view literals,
+                                                    const Types::VarMap& var_map, const bool floating_point,
+                                                    const Types::MathSettings& settings,
+                                                    std::size_t& num_children) const;
     std::unique_ptr<MathNodes::MathNode> m_root;
+    std::vector<MathNodes::MathNode*> m_postorder;
+    // Set by plan_parallel for trees worth splitting. The subtrees are evaluated by tasks before the rest of the
+    // tree, and task i evaluates m_subtrees[m_tasks[i]] up to m_subtrees[m_tasks[i + 1]]
+    std::vector<Range> m_subtrees;
+    std::vector<std::size_t> m_tasks;
+    unsigned m_threads = 1;
 };
 
 #endif
@@ -1,6 +1,8 @@
 #include "ast/bnode.h"
 
 #include <memory>
+#include <stdexcept>
+#include <string>
 
 #include "include/types.hpp"
 
@@ -8,12 +10,13 @@ namespace BoolNodes {
 
 BoolNode::BoolNode(const Types::Token token) noexcept : key(token){}
 
-[[nodiscard]] bool ValueBNode::evaluate() const { return key == Types::Token::TRUE; }
+[[nodiscard]] bool ValueBNode::evaluate(const bool, const bool) const { return key == Types::Token::TRUE; }
 
-[[nodiscard]] bool OperationBNode::evaluate() const {
-    const bool left_value = m_left_child->evaluate();
-    const bool right_value = m_right_child->evaluate();
+[[nodiscard]] bool VarBNode::evaluate(const bool, const bool) const {
+    throw std::runtime_error("Variables can only be used with the sat, anf, and minimize commands");
+}
 
+[[nodiscard]] bool OperationBNode::evaluate(const bool left_value, const bool right_value) const {
     switch (key) {
         case Types::Token::AND:
             return left_value && right_value;
@@ -31,6 +34,6 @@ BoolNode::BoolNode(const Types::Token token) noexcept : key(token){}
 
 }
 
-[[nodiscard]] bool UnaryBNode::evaluate() const { return !m_left_child->evaluate(); }
+[[nodiscard]] bool UnaryBNode::evaluate(const bool left_value, const bool) const { return !left_value; }
 
 }
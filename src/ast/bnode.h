@@ -7,10 +7,12 @@
 
 namespace BoolNodes {
 
+// Nodes don't evaluate their children, BoolAST walks the tree with an explicit stack and passes the values in.
+// Leaves ignore both arguments and unary nodes ignore the right one
 struct BoolNode {
     explicit BoolNode(const Types::Token token) noexcept;
     virtual ~BoolNode() = default;
-    [[nodiscard]] virtual bool evaluate() const = 0;
+    [[nodiscard]] virtual bool evaluate(const bool left_value, const bool right_value) const = 0;
     std::unique_ptr<BoolNode> m_left_child;
     std::unique_ptr<BoolNode> m_right_child;
     const Types::Token key;
@@ -18,17 +20,24 @@ struct BoolNode {
 
 struct ValueBNode : public BoolNode {
     explicit ValueBNode(const Types::Token token) : BoolNode(token) {}
-    [[nodiscard]] bool evaluate() const override;
+    [[nodiscard]] bool evaluate(const bool left_value, const bool right_value) const override;
+};
+
+// Variables only appear in symbolic expressions, which are never evaluated directly
+struct VarBNode : public BoolNode {
+    explicit VarBNode(const std::size_t _index) : BoolNode(Types::Token::VAR), index(_index) {}
+    [[nodiscard]] bool evaluate(const bool left_value, const bool right_value) const override;
+    const std::size_t index;
 };
 
 struct OperationBNode : public BoolNode {
     explicit OperationBNode(const Types::Token token) : BoolNode(token) {}
-    [[nodiscard]] bool evaluate() const override;
+    [[nodiscard]] bool evaluate(const bool left_value, const bool right_value) const override;
 };
 
 struct UnaryBNode : public BoolNode {
     explicit UnaryBNode(const Types::Token token) : BoolNode(token) {}
-    [[nodiscard]] bool evaluate() const override;
+    [[nodiscard]] bool evaluate(const bool left_value, const bool right_value) const override;
 };
 
 }
@@ -2,7 +2,10 @@
 
 #include "ast/mnode.h"
 
+#include <bit>
 #include <cctype>
+#include <cmath>
+#include <cstddef>
 #include <gmpxx.h>
 #include <limits>
 #include <memory>
@@ -10,14 +13,16 @@
 #include <stdexcept>
 
 #include "include/types.hpp"
+#include "interrupt/interrupt.h"
+#include "memory/memory.h"
 
 using namespace Types;
 
 namespace MathNodes {
 
-ValueMNode::ValueMNode(const std::string_view _value_mpz, const std::string_view _value_mpf) :
-    value_mpz(_value_mpz.data()) {
-    mpfr_init2(value_mpfr, static_cast<mpfr_prec_t>(Startup::settings.at(Setting::PRECISION)));
+ValueMNode::ValueMNode(const std::string_view _value_mpz, const std::string_view _value_mpf,
+                       const mpfr_prec_t precision) : value_mpz(_value_mpz.data()) {
+    mpfr_init2(value_mpfr, precision);
     const int successful = mpfr_set_str(value_mpfr, _value_mpf.data(), 10, MPFR_RNDN);
     if (successful != 0) [[unlikely]] {
         mpfr_clear(value_mpfr);
@@ -25,8 +30,8 @@ ValueMNode::ValueMNode(const std::string_view _value_mpz, const std::string_view
     }
 }
 
-ValueMNode::ValueMNode(const Token token) : value_mpz(0) {
-    mpfr_init2(value_mpfr, static_cast<mpfr_prec_t>(Startup::settings.at(Setting::PRECISION)));
+ValueMNode::ValueMNode(const Token token, const mpfr_prec_t precision) : value_mpz(0) {
+    mpfr_init2(value_mpfr, precision);
     if (token == Token::PI) mpfr_const_pi(value_mpfr, MPFR_RNDN);
     if (token == Token::EULER) {
         const int successful = mpfr_set_str(value_mpfr, euler.data(), 10, MPFR_RNDN);
@@ -37,29 +42,130 @@ ValueMNode::ValueMNode(const Token token) : value_mpz(0) {
     }
 }
 
-[[nodiscard]] mpz_class ValueMNode::evaluate() const { return value_mpz; }
+[[nodiscard]] mpz_class ValueMNode::evaluate(mpz_class&, mpz_class&) const { return value_mpz; }
 
-[[nodiscard]] mpfr_t& ValueMNode::evaluate_float() { return value_mpfr; }
+[[nodiscard]] mpfr_t& ValueMNode::evaluate_float(mpfr_srcptr, mpfr_srcptr) { return value_mpfr; }
 
+VarMNode::VarMNode(const Value& value, const bool floating_point, const mpfr_prec_t precision)
+    : m_floating_point(floating_point) {
+    if (!m_floating_point) {
+        m_integer = value.integer();
+        return;
+    }
+    if (value.is_floating_point()) {
+        mpfr_init2(node_result, mpfr_get_prec(value.floating_point()));
+        mpfr_set(node_result, value.floating_point(), MPFR_RNDN);
+    } else {
+        mpfr_init2(node_result, precision);
+        mpfr_set_z(node_result, value.integer().get_mpz_t(), MPFR_RNDN);
+    }
+}
+
+[[nodiscard]] mpz_class VarMNode::evaluate(mpz_class&, mpz_class&) const { return m_integer; }
+
+[[nodiscard]] mpfr_t& VarMNode::evaluate_float(mpfr_srcptr, mpfr_srcptr) { return node_result; }
+
+[[nodiscard]] static inline std::size_t limb_bytes(const mpz_class& value) {
+    return mpz_size(value.get_mpz_t()) * sizeof(mp_limb_t);
+}
+
+// A multiply of numbers this big takes long enough that reading the clock before it costs nothing
+inline constexpr std::size_t large_limbs = 1024;
+// Below this both factorials finish in a few milliseconds, so they're computed in one call
+inline constexpr unsigned long chunked_factorial_min = 100'000;
+inline constexpr unsigned long float_factorial_check_interval = 4096;
+
+static inline void check_step(const mpz_class& operand) {
+    if (mpz_size(operand.get_mpz_t()) >= large_limbs) {
+        Interrupt::check_now();
+    } else {
+        Interrupt::check();
+    }
+}
+
+// n! = (n/2)!^2 * swing(n), the split mpz_fac_ui makes inside, taken one level at a time with a check between
+// each multiply. The swing is the central binomial coefficient, times n/2 + 1 when n is odd
+static void chunked_factorial(mpz_class& result, const unsigned long n) {
+    if (n < chunked_factorial_min) {
+        mpz_fac_ui(result.get_mpz_t(), n);
+        return;
+    }
+    const unsigned long half = n / 2;
+    chunked_factorial(result, half);
+    Interrupt::check_now();
+    result *= result;
+    Interrupt::check_now();
+    mpz_class swing;
+    mpz_bin_uiui(swing.get_mpz_t(), n, half);
+    if (n % 2 == 1) swing *= half + 1;
+    Interrupt::check_now();
+    result *= swing;
+}
+
+// mpfr_fac_ui multiplies its way up one integer at a time, and can't be stopped. This makes the same products
+// with enough extra bits to cover the n roundings, checking every few thousand, then rounds once to the
+// precision of result. If the rounding could still go either way it tries again with more bits, the way
+// mpfr_fac_ui does, so the result is the same
+static void chunked_float_factorial(mpfr_t result, const unsigned long n) {
+    if (n < chunked_factorial_min) {
+        mpfr_fac_ui(result, n, MPFR_RNDN);
+        return;
+    }
+    const mpfr_prec_t precision = mpfr_get_prec(result);
+    // Each rounding is off by at most half an ulp, so the product is within n ulps
+    const auto error_bits = static_cast<mpfr_prec_t>(std::bit_width(n)) + 1;
+    mpfr_prec_t working_precision = precision + error_bits + 32;
+    mpfr_t product;
+    mpfr_init2(product, working_precision);
+    try {
+        while (true) {
+            mpfr_set_ui(product, 1, MPFR_RNDN);
+            for (unsigned long i = 2; i <= n; ++i) {
+                mpfr_mul_ui(product, product, i, MPFR_RNDN);
+                if (i % float_factorial_check_interval == 0) Interrupt::check_now();
+            }
+            if (mpfr_inf_p(product) ||
+                mpfr_can_round(product, working_precision - error_bits, MPFR_RNDN, MPFR_RNDZ, precision + 1)) {
+                break;
+            }
+            working_precision += 64;
+            mpfr_set_prec(product, working_precision);
+        }
+    } catch (...) {
+        mpfr_clear(product);
+        throw;
+    }
+    mpfr_set(result, product, MPFR_RNDN);
+    mpfr_clear(product);
+}
+
+// The result has about right * log2(left) bits, so a power that can't fit in the memory budget is stopped before
+// squaring its way up to it. A product is at most as big as its factors put together, so each step is checked too
 static inline mpz_class mpz_exponent(mpz_class& left_value, mpz_class& right_value) {
     if (right_value == 0) return 1;
     if (right_value == 1) return left_value;
+    if (abs(left_value) > 1) {
+        const double bits = right_value.get_d() * static_cast<double>(mpz_sizeinbase(left_value.get_mpz_t(), 2) - 1);
+        Memory::reserve(bits / 8 < 0x1p63 ? static_cast<std::size_t>(bits / 8) : std::numeric_limits<std::size_t>::max());
+    }
     mpz_class retval = 1;
     while (right_value > 0) {
+        check_step(left_value);
         if (right_value % 2 == 1) {
+            Memory::reserve(limb_bytes(retval) + limb_bytes(left_value));
             retval *= left_value;
         }
-        left_value *= left_value;
         right_value /= 2;
+        // The square after the last bit would never be used
+        if (right_value == 0) break;
+        Memory::reserve(2 * limb_bytes(left_value));
+        left_value *= left_value;
     }
     
     return retval;
 }
 
-[[nodiscard]] mpz_class OperationMNode::evaluate() const {
-    mpz_class left_value = m_left_child->evaluate();
-    mpz_class right_value = m_right_child->evaluate();
-
+[[nodiscard]] mpz_class OperationMNode::evaluate(mpz_class& left_value, mpz_class& right_value) const {
     switch(key) {
         case Token::ADD:
             return left_value + right_value;
@@ -74,10 +180,7 @@ static inline mpz_class mpz_exponent(mpz_class& left_value, mpz_class& right_val
     }
 }
 
-mpfr_t& OperationMNode::evaluate_float() {
-    const mpfr_t& left_value = m_left_child->evaluate_float();
-    const mpfr_t& right_value = m_right_child->evaluate_float();
-
+mpfr_t& OperationMNode::evaluate_float(mpfr_srcptr left_value, mpfr_srcptr right_value) {
     switch(key) {
         case Token::ADD:
             mpfr_add(node_result, left_value, right_value, MPFR_RNDN);
@@ -102,10 +205,7 @@ mpfr_t& OperationMNode::evaluate_float() {
     }
 }
 
-mpfr_t& TrigMNode::evaluate_float() {
-    const mpfr_t& left_value = m_left_child->evaluate_float();
-    const bool use_degrees = Startup::settings.at(Setting::ANGLE) == 1;
-    
+mpfr_t& TrigMNode::evaluate_float(mpfr_srcptr left_value, mpfr_srcptr) {
     switch(key) {
         case Token::SIN:
             if (use_degrees) {
@@ -133,10 +233,19 @@ mpfr_t& TrigMNode::evaluate_float() {
     }
 }
 
-[[nodiscard]] mpz_class FactorialNode::evaluate() const { return factorial(m_left_child->evaluate()); }
+// n! has log2(n!) bits, which lgamma gives without computing it
+[[nodiscard]] mpz_class FactorialNode::evaluate(mpz_class& left_value, mpz_class&) const {
+    if (left_value > 1 && mpz_fits_ulong_p(left_value.get_mpz_t())) {
+        const double bits = std::lgamma(left_value.get_d() + 1) / std::log(2.0);
+        Memory::reserve(static_cast<std::size_t>(bits / 8));
+        mpz_class result;
+        chunked_factorial(result, left_value.get_ui());
+        return result;
+    }
+    return factorial(left_value);
+}
 
-mpfr_t& FactorialNode::evaluate_float() {
-    const mpfr_t& prev_val = m_left_child->evaluate_float();
+mpfr_t& FactorialNode::evaluate_float(mpfr_srcptr prev_val, mpfr_srcptr) {
     if (!mpfr_integer_p(prev_val)) {
         throw std::runtime_error("Factorial called on non integer value");
     } else if (mpfr_sgn(prev_val) < 0) {
@@ -147,14 +256,14 @@ mpfr_t& FactorialNode::evaluate_float() {
         prev_val_int == std::numeric_limits<unsigned long int>::min()) {
         throw std::runtime_error("Value is too big for factorial");
     }
-    mpfr_fac_ui(node_result, prev_val_int, MPFR_RNDN);
+    chunked_float_factorial(node_result, prev_val_int);
     return node_result;
 }
 
-[[nodiscard]] mpz_class UnaryMNode::evaluate() const { return m_left_child->evaluate() * -1; }
+[[nodiscard]] mpz_class UnaryMNode::evaluate(mpz_class& left_value, mpz_class&) const { return left_value * -1; }
 
-mpfr_t& UnaryMNode::evaluate_float() {
-    mpfr_mul_si(node_result, m_left_child->evaluate_float(), -1L, MPFR_RNDN);
+mpfr_t& UnaryMNode::evaluate_float(mpfr_srcptr left_value, mpfr_srcptr) {
+    mpfr_mul_si(node_result, left_value, -1L, MPFR_RNDN);
     return node_result;
 }
 
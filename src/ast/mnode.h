@@ -9,76 +9,93 @@
 #include <mpfr.h>
 
 #include "include/types.hpp"
-#include "startup/startup.h"
+#include "include/value.hpp"
 
 using namespace Types;
 
 namespace MathNodes {
 
 // According to the MPFR docs, when using c++ you should try to avoid making copies whenever possible,
-// so evaluate_float returns a reference to a node_result, which is initialized in the constructor of the node
+// so evaluate_float returns a reference to a node_result, which is initialized in the constructor of the node.
+// Nodes don't evaluate their children, MathAST walks the tree with an explicit stack and passes the values in.
+// Leaves ignore both arguments (the float ones are null), and unary nodes ignore the right one
 struct MathNode {
     MathNode() = default;
     virtual ~MathNode() = default;
-    [[nodiscard]] virtual mpz_class evaluate() const = 0;
-    virtual mpfr_t& evaluate_float() = 0;
+    [[nodiscard]] virtual mpz_class evaluate(mpz_class& left_value, mpz_class& right_value) const = 0;
+    virtual mpfr_t& evaluate_float(mpfr_srcptr left_value, mpfr_srcptr right_value) = 0;
     std::unique_ptr<MathNode> m_left_child;
     std::unique_ptr<MathNode> m_right_child;
 };
 
 struct ValueMNode : public MathNode {
-    explicit ValueMNode(const std::string_view _value_mpz, const std::string_view _value_mpf);
-    explicit ValueMNode(const Token token);
-    ~ValueMNode() {
-        mpfr_clear(value_mpfr);
-        mpfr_free_cache();
-    }
+    explicit ValueMNode(const std::string_view _value_mpz, const std::string_view _value_mpf,
+                        const mpfr_prec_t precision);
+    explicit ValueMNode(const Token token, const mpfr_prec_t precision);
+    ~ValueMNode() { mpfr_clear(value_mpfr); }
 
-    [[nodiscard]] mpz_class evaluate() const override;
-    mpfr_t& evaluate_float() override;
+    [[nodiscard]] mpz_class evaluate(mpz_class& left_value, mpz_class& right_value) const override;
+    mpfr_t& evaluate_float(mpfr_srcptr left_value, mpfr_srcptr right_value) override;
     mpz_class value_mpz;
     mpfr_t value_mpfr;
 };
 
+// A variable or ANS. The value is copied when the tree is built, so the tree doesn't depend on the variable
+// afterwards. Floats keep the value's own precision, integers promoted to floats use the tree's precision
+struct VarMNode : public MathNode {
+    explicit VarMNode(const Value& value, const bool floating_point, const mpfr_prec_t precision);
+    ~VarMNode() {
+        if (m_floating_point) mpfr_clear(node_result);
+    }
+
+    [[nodiscard]] mpz_class evaluate(mpz_class& left_value, mpz_class& right_value) const override;
+    mpfr_t& evaluate_float(mpfr_srcptr left_value, mpfr_srcptr right_value) override;
+    mpz_class m_integer;
+    const bool m_floating_point;
+    mpfr_t node_result;
+};
+
 struct OperationMNode : public MathNode {
-    explicit OperationMNode(const Token token) : key(token) {
-        mpfr_init2(node_result, static_cast<mpfr_prec_t>(Startup::settings.at(Setting::PRECISION)));
+    explicit OperationMNode(const Token token, const mpfr_prec_t precision) : key(token) {
+        mpfr_init2(node_result, precision);
     }
     ~OperationMNode() { mpfr_clear(node_result); }
-    [[nodiscard]] mpz_class evaluate() const override;
-    mpfr_t& evaluate_float() override;
+    [[nodiscard]] mpz_class evaluate(mpz_class& left_value, mpz_class& right_value) const override;
+    mpfr_t& evaluate_float(mpfr_srcptr left_value, mpfr_srcptr right_value) override;
     mpfr_t node_result;
     const Token key;
 };
 
 struct TrigMNode : public MathNode {
-    explicit TrigMNode(const Token token) : key(token) {
-        mpfr_init2(node_result, static_cast<mpfr_prec_t>(Startup::settings.at(Setting::PRECISION)));
+    explicit TrigMNode(const Token token, const mpfr_prec_t precision, const bool degrees)
+        : key(token), use_degrees(degrees) {
+        mpfr_init2(node_result, precision);
     }
     ~TrigMNode() { mpfr_clear(node_result); }
-    [[nodiscard]] mpz_class evaluate() const override{ return 0; }
-    mpfr_t& evaluate_float() override;
+    [[nodiscard]] mpz_class evaluate(mpz_class&, mpz_class&) const override { return 0; }
+    mpfr_t& evaluate_float(mpfr_srcptr left_value, mpfr_srcptr right_value) override;
     mpfr_t node_result;
     const Token key;
+    const bool use_degrees;
 };
 
 struct FactorialNode : public MathNode {
-    explicit FactorialNode() {
-        mpfr_init2(node_result, static_cast<mpfr_prec_t>(Startup::settings.at(Setting::PRECISION)));
+    explicit FactorialNode(const mpfr_prec_t precision) {
+        mpfr_init2(node_result, precision);
     }
     ~FactorialNode() { mpfr_clear(node_result); }
-    [[nodiscard]] mpz_class evaluate() const override;
-    mpfr_t& evaluate_float() override;
+    [[nodiscard]] mpz_class evaluate(mpz_class& left_value, mpz_class& right_value) const override;
+    mpfr_t& evaluate_float(mpfr_srcptr left_value, mpfr_srcptr right_value) override;
     mpfr_t node_result;
 };
 
 struct UnaryMNode : public MathNode {
-    explicit UnaryMNode() {
-        mpfr_init2(node_result, static_cast<mpfr_prec_t>(Startup::settings.at(Setting::PRECISION)));
+    explicit UnaryMNode(const mpfr_prec_t precision) {
+        mpfr_init2(node_result, precision);
     }
     ~UnaryMNode() { mpfr_clear(node_result); }
-    [[nodiscard]] mpz_class evaluate() const override;
-    mpfr_t& evaluate_float() override;
+    [[nodiscard]] mpz_class evaluate(mpz_class& left_value, mpz_class& right_value) const override;
+    mpfr_t& evaluate_float(mpfr_srcptr left_value, mpfr_srcptr right_value) override;
     mpfr_t node_result;
 };
 
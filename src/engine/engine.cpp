@@ -4,27 +4,38 @@
 
 #include <algorithm>
 #include <cctype>
+#include <charconv>
+#include <cstdlib>
 #include <fstream>
-#include <gmpxx.h>
 #include <iostream>
 #include <memory>
 #include <mpfr.h>
 #include <optional>
 #include <readline/readline.h>
 #include <readline/history.h>
-#include <span>
+#include <string>
 #include <string_view>
-#include <unordered_map>
+#include <vector>
 
-#include "ast/ast.h"
+#include "engine/jobs.h"
 #include "engine/signal.h"
 #include "file/file.h"
+#include "file/journal.h"
+#include "file/shared_state.h"
+#include "history/history.h"
 #include "include/types.hpp"
 #include "include/util.hpp"
-#include "parser/parser.h"
+#include "include/value.hpp"
+#include "lib/ccalc.h"
+#include "logic/logic.h"
+#include "memory/memory.h"
+#include "metrics/metrics.h"
+#include "server/server.h"
 #include "startup/startup.h"
 #include "ui/ui.h"
 
+using namespace Types;
+
 namespace Engine {
 
 namespace {
@@ -40,6 +51,33 @@ namespace {
     return 0;
 }
 
+// Expects ccalc --metrics out.jsonl followed by the mode to record. Returns null after printing the error
+[[nodiscard]] std::unique_ptr<Metrics::Writer> open_metrics(const int argc, const char* const argv[]) {
+    if (argc < 4) {
+        UI::print_error("Expected a file and a mode: ccalc --metrics out.jsonl -f");
+        return nullptr;
+    }
+    const std::string_view mode = argv[3];
+    if (mode != "-f" && mode != "--file" && mode != "--serve") {
+        UI::print_error("--metrics only records file mode (-f) and server mode (--serve)");
+        return nullptr;
+    }
+    auto metrics = std::make_unique<Metrics::Writer>(argv[2]);
+    if (!metrics->ok()) {
+        UI::print_error("Unable to open " + std::string(argv[2]));
+        return nullptr;
+    }
+    Memory::track();
+    return metrics;
+}
+
+// The modes that evaluate on this thread, which is the only one the counters see
+[[nodiscard]] bool counted_mode(const std::string_view mode) {
+    if (mode == "-c" || mode == "--continuous" || mode == "-f" || mode == "--file" || mode == "--stats") return true;
+    // Anything else that starts with a dash is a flag, unless it's a negative number or expression
+    return mode.size() >= 2 && (mode[0] != '-' || std::isdigit(mode[1]) || mode[1] == '(');
+}
+
 inline void cleanup_history() {
     while (history_length) {
         HIST_ENTRY* entry = remove_history(0); 
@@ -53,30 +91,29 @@ inline void cleanup_history() {
     }
 }
 
-inline void shutdown(const std::vector<std::pair<std::string, std::string> >& history,
-                     const std::unordered_map<char, std::string>& var_map) {
-    std::ofstream output;
-    output.open(Startup::history_location, std::ios::trunc);
-    if(output.is_open()) File::write_history(history, output);
-    output.close();
-    output.open(Startup::var_map_location);
-    if(output.is_open()) File::write_vars(var_map, output);
+// The history is already in the journal, closing it only waits for a compaction and syncs the last records.
+// Assigned variables were saved as they were made, only ANS is left
+inline void shutdown(File::Journal& journal, File::SharedState& state, const VarMap& var_map) {
+    journal.close();
+    if (!state.publish(var_map, std::string_view("\0", 1))) [[unlikely]] {
+        UI::print_error("Unable to save variables");
+    }
     cleanup_history();
+    mpfr_free_cache();
 }
 
-bool check_signal_flags(const std::vector<std::pair<std::string, std::string> >& history,
-                        const std::unordered_map<char, std::string>& var_map) {
+bool check_signal_flags(File::Journal& journal, File::SharedState& state, const VarMap& var_map) {
     if (Signal::signal_received()) {
         rl_free_line_state();
         rl_cleanup_after_signal();
         std::cout << '\n';
-        shutdown(history, var_map);
+        shutdown(journal, state, var_map);
         return true;
     }
     return false;
 }
 
-[[nodiscard]] bool save_history(const std::vector<std::pair<std::string, std::string> >& history) {
+[[nodiscard]] bool save_history(const History::Ring& history) {
     // Get the file from the user, then output the history to it
     const std::optional<std::string> filename = Util::get_filename(true);
     if (!filename) [[unlikely]] {
@@ -93,7 +130,7 @@ bool check_signal_flags(const std::vector<std::pair<std::string, std::string> >&
     return true;
 }
 
-[[nodiscard]] bool is_empty_history(const std::vector<std::pair<std::string, std::string> >& history) {
+[[nodiscard]] bool is_empty_history(const History::Ring& history) {
     if (history.empty()) {
         UI::print_error("You haven't evaluated any expressions yet");
         return true;
@@ -101,7 +138,7 @@ bool check_signal_flags(const std::vector<std::pair<std::string, std::string> >&
     return false;
 }
 
-[[nodiscard]] bool is_empty_var_map(const std::unordered_map<char, std::string>& vars) {
+[[nodiscard]] bool is_empty_var_map(const VarMap& vars) {
     if (vars.empty()) {
         UI::print_error("There are no valid variables assigned");
         return true;
@@ -109,10 +146,33 @@ bool check_signal_flags(const std::vector<std::pair<std::string, std::string> >&
     return false;
 }
 
+// "history =value" looks up a result, anything else after "history" is searched for in the expressions
+void search_history(const History::Ring& history, const std::string_view pattern) {
+    const std::vector<std::size_t> matches = pattern.starts_with('=') ? history.find_result(pattern.substr(1))
+                                                                      : history.search(pattern);
+    if (matches.empty()) {
+        UI::print_error("No history entries match");
+        return;
+    }
+    UI::print_history(history, matches);
+}
+
+// "wait" and "kill" are followed by a job number, which wait can leave out. Returns nothing if the rest isn't one
+[[nodiscard]] std::optional<std::size_t> job_number(const std::string_view input, const std::string_view command,
+                                                    const bool optional) {
+    const std::string_view number = input.substr(command.size());
+    if (number.empty()) return optional ? std::optional<std::size_t>(0) : std::nullopt;
+    std::size_t id = 0;
+    const auto [end, error] = std::from_chars(number.data(), number.data() + number.size(), id);
+    if (error != std::errc() || end != number.data() + number.size() || id == 0) return std::nullopt;
+    return id;
+}
+
 // Determines the status of the program based on the user input, return an enum defined in Types.hpp 
 [[nodiscard]] InputResult handle_input(const std::string_view input_expression,
-                                       std::vector<std::pair<std::string, std::string> >& history,
-                                       const std::unordered_map<char, std::string>& vars) {
+                                       History::Ring& history,
+                                       const VarMap& vars, File::Journal& journal, bool& show_stats,
+                                       Jobs::Manager& jobs) {
     if (input_expression == "help") {
         UI::print_help_continuous();
         return InputResult::CONTINUE;
@@ -120,6 +180,9 @@ bool check_signal_flags(const std::vector<std::pair<std::string, std::string> >&
         if (is_empty_history(history)) return InputResult::CONTINUE;
         UI::print_history(history);
         return InputResult::CONTINUE;
+    } else if (input_expression.starts_with("history")) {
+        search_history(history, input_expression.substr(std::string_view("history").size()));
+        return InputResult::CONTINUE;
     } else if (input_expression == "vars" || input_expression == "variables") {
         if (is_empty_var_map(vars)) return InputResult::CONTINUE;
         UI::print_vars(vars);
@@ -135,8 +198,33 @@ bool check_signal_flags(const std::vector<std::pair<std::string, std::string> >&
     } else if (input_expression == "clear") {
         cleanup_history();
         history.clear();
+        journal.clear();
         std::cout << "History cleared\n";
         return InputResult::CONTINUE;
+    } else if (input_expression == "stats") {
+        show_stats = !show_stats;
+        std::cout << (show_stats ? "Stats on\n" : "Stats off\n");
+        return InputResult::CONTINUE;
+    } else if (input_expression == "jobs") {
+        const std::vector<Jobs::Running> running = jobs.running();
+        if (running.empty()) {
+            UI::print_error("There are no background jobs running");
+        } else {
+            UI::print_jobs(running);
+        }
+        return InputResult::CONTINUE;
+    } else if (input_expression.starts_with("wait")) {
+        if (const auto id = job_number(input_expression, "wait", true)) {
+            if (!jobs.wait(*id)) UI::print_error("There are no background jobs running with that number");
+            // Ctrl-C only stops the wait, the job keeps running
+            Signal::consume_interrupt();
+            return InputResult::CONTINUE;
+        }
+    } else if (input_expression.starts_with("kill")) {
+        if (const auto id = job_number(input_expression, "kill", false)) {
+            if (!jobs.kill(*id)) UI::print_error("There are no background jobs running with that number");
+            return InputResult::CONTINUE;
+        }
     } else if (input_expression == "quit" || input_expression == "exit" || input_expression == "q") {
         std::cout << "Exiting...\n";
         return InputResult::QUIT_SUCCESS;
@@ -145,205 +233,157 @@ bool check_signal_flags(const std::vector<std::pair<std::string, std::string> >&
     return InputResult::CONTINUE_TO_EVALUATE;
 }
 
-inline void add_to_history(std::string& orig_input, std::string&& final_value,
-                           std::vector<std::pair<std::string, std::string> >& history) {
-    if (history.size() + 1 > static_cast<std::size_t>(Startup::settings.at(Setting::MAX_HISTORY))) {
-        history.erase(history.begin());
-    }
-    add_history(orig_input.c_str());
-    history.emplace_back(std::make_pair(std::move(orig_input), std::move(final_value)));
-}
-
-inline void add_to_history(std::string& orig_input, std::string& final_value,
-                           std::vector<std::pair<std::string, std::string> >& history) {
-    if (history.size() + 1 > static_cast<std::size_t>(Startup::settings.at(Setting::MAX_HISTORY))) {
-        history.erase(history.begin());
+// What a finished background job's result is posted to. Readline's event hook takes no arguments, so
+// program_loop points g_session at its own state while it runs
+struct Session {
+    History::Ring& history;
+    CCalc::Context& context;
+    File::Journal& journal;
+    File::SharedState& state;
+    Jobs::Manager& jobs;
+};
+
+Session* g_session = nullptr;
+
+struct SessionScope {
+    explicit SessionScope(Session& session) { g_session = &session; }
+    ~SessionScope() { g_session = nullptr; }
+};
+
+// The input was already given to readline for recall when the job started
+void post_finished_jobs(Session& session) {
+    for (Jobs::Finished& job : session.jobs.take_finished()) {
+        // A huge result was never converted whole, what the history keeps of it is printed instead
+        if (job.result.streamed) History::shorten_streamed_result(job.result.text, job.result.digits);
+        UI::print_job_finished(job);
+        if (!job.value) continue;
+        session.context.variables().insert_or_assign(job.target, std::move(*job.value));
+        if (job.target != '\0' &&
+            !session.state.publish(session.context.variables(), std::string_view(&job.target, 1))) [[unlikely]] {
+            UI::print_error("Unable to save variables");
+        }
+        History::shorten_result(job.result.text);
+        session.journal.append(job.input, job.result.text);
+        session.history.add(std::move(job.input), std::move(job.result.text));
     }
-    add_history(orig_input.c_str());
-    history.emplace_back(std::make_pair(std::move(orig_input), std::move(final_value)));
 }
 
-inline std::string print_pi(std::string& orig_input, std::vector<std::pair<std::string, std::string> >& history) {
-    mpfr_t pi;
-    mpfr_init2(pi, static_cast<mpfr_prec_t>(Startup::settings.at(Setting::PRECISION)));
-    mpfr_const_pi(pi, MPFR_RNDN); 
-    std::string pi_str = UI::print_mpfr(pi, static_cast<mpfr_prec_t>(Startup::settings.at(Setting::DISPLAY_PREC)));
-    std::string pi_copy = pi_str;
-    add_to_history(orig_input, pi_str, history);
-    mpfr_free_cache();
-    mpfr_clear(pi);
-    return pi_copy;
-}
-
-inline std::string trim_euler() {
-    std::string euler_retval = std::string(euler);
-
-    // The "+ 2" is to keep the 2 and the decimal of e
-    euler_retval.erase(static_cast<std::size_t>(Startup::settings.at(Setting::DISPLAY_PREC) + 2), std::string::npos);
-    return euler_retval;
-}
-
-inline std::string print_euler(std::string& orig_input, std::vector<std::pair<std::string, std::string> >& history) {
-    std::string euler = trim_euler();
-    UI::print_result(euler);
-    const std::string euler_copy = euler;
-    add_to_history(orig_input, euler, history);
-    return euler_copy;
+// Readline calls this about ten times a second while it waits for input. Results of background jobs are printed
+// where the prompt was, and the prompt and the line being typed are put back below them
+int event_hook() {
+    Signal::check_signals_hook();
+    if (!g_session || !g_session->jobs.any_finished()) return 0;
+    const int point = rl_point;
+    char* const line = rl_copy_text(0, rl_end);
+    rl_save_prompt();
+    rl_replace_line("", 0);
+    rl_redisplay();
+    post_finished_jobs(*g_session);
+    std::cout.flush();
+    rl_restore_prompt();
+    rl_replace_line(line, 0);
+    rl_point = point;
+    rl_redisplay();
+    free(line);
+    return 0;
 }
 
-inline void print_ans(std::string& orig_input, std::vector<std::pair<std::string, std::string> >& history,
-                      const std::unordered_map<char, std::string>& var_map) {
-    if (!var_map.contains('\0')) {
-        UI::print_error("There is no ANS present");
+// A trailing & runs the expression on its own thread, the & is left out of the history
+void start_job(std::string& orig_input, std::string& expression, Session& session) {
+    expression.pop_back();
+    if (expression.empty()) {
+        UI::print_error("Expected an expression before &");
         return;
     }
-    std::string ans_copy = var_map.at('\0');
-    UI::print_result(ans_copy);
-    add_to_history(orig_input, ans_copy, history);
-}
-
-// Moving the strings into the map/history means that we have to remember to make copies
-[[nodiscard]] std::string check_num_input(std::string& orig_input, std::string& expression,
-                                          std::vector<std::pair<std::string, std::string> >& history,
-                                          std::unordered_map<char, std::string>& var_map) {
-    if (std::ranges::all_of(expression, ::isdigit)) {
-        UI::print_result(expression);
-        const std::string expr_copy = expression;
-        add_to_history(orig_input, expression, history);
-        return expr_copy;
-    } else if (expression == "E") {
-        return print_euler(orig_input, history);
-    } else if (expression == "PI") {
-        return print_pi(orig_input, history);
-    } else if (expression == "ANS") {
-        print_ans(orig_input, history, var_map); 
-        return "ANS";
-    } else if (expression.size() == 1 && var_map.contains(expression[0])) {
-        UI::print_result(var_map.at(expression[0]));
-        return var_map.at(expression[0]);
-    }
-    return "";
-}
-
-// Make the tree, evaluate, print the result, then add it to the history
-std::string math_float_procedure(std::string& orig_input, const std::span<const Token> prefix_input,
-                                 std::vector<std::pair<std::string, std::string> >& history) {
-    try {
-        const auto tree = std::make_unique<MathAST>();
-        tree->build_ast(prefix_input, true);
-        const mpfr_t& final_value = tree->evaluate_floating_point();
-        std::string final_val = UI::print_mpfr(final_value,
-                                           static_cast<mpfr_prec_t>(Startup::settings.at(Setting::DISPLAY_PREC)));
-        if (final_val.empty()) [[unlikely]] return "";
-        std::string final_val_copy = final_val;
-        add_to_history(orig_input, final_val, history);
-        return final_val_copy;
-    } catch (const std::exception& err) {
-        UI::print_error(err.what());
-    }
-    return "";
-}
-
-std::string math_int_procedure(std::string& orig_input, const std::span<const Token> prefix_input,
-                               std::vector<std::pair<std::string, std::string> >& history) {
-    try {
-        const auto tree = std::make_unique<MathAST>();
-        tree->build_ast(prefix_input, false);
-        const mpz_class final_value = tree->evaluate();
-        std::string final_val_copy = final_value.get_str();
-        UI::print_result(final_value.get_str());
-        add_to_history(orig_input, final_value.get_str(), history);
-        return final_val_copy;
-    } catch (const std::bad_alloc& err) {
-        UI::print_error("The number grew too big");
-    } catch (const std::exception& err) {
-        UI::print_error(err.what());
-    }
-    return "";
+    add_history(orig_input.c_str());
+    orig_input.erase(orig_input.find_last_not_of(" &") + 1);
+    const std::size_t id = session.jobs.start(std::move(orig_input), std::move(expression),
+                                              session.context.settings(), session.context.variables());
+    UI::print_job_started(id);
 }
 
-// Calls the float or int procedure based on float_point status
-std::string math_procedure(std::string& orig_input, const ParseResult& result,
-                           std::vector<std::pair<std::string, std::string> >& history) {
-    if (result.is_floating_point) {
-        return math_float_procedure(orig_input, result.result, history);
+void shorten_result(CCalc::Result& result) {
+    if (result.streamed) {
+        History::shorten_streamed_result(result.text, result.digits);
     } else {
-        return math_int_procedure(orig_input, result.result, history);
+        History::shorten_result(result.text);
     }
 }
 
-// Bool is easier than math, just solve and add to history
-void bool_procedure(std::string& orig_input, const std::span<const Token> prefix_input,
-                    std::vector<std::pair<std::string, std::string> >& history) {
-    const auto syntax_tree = std::make_unique<BoolAST>();
-    syntax_tree->build_ast(prefix_input);
-    if (syntax_tree->evaluate()) {
-        UI::print_result("True");
-        add_to_history(orig_input, "True", history);
-    } else {
-        UI::print_result("False");
-        add_to_history(orig_input, "False", history);
-    }
+inline void add_to_history(std::string& orig_input, CCalc::Result&& result,
+                           History::Ring& history, File::Journal& journal) {
+    add_history(orig_input.c_str());
+    shorten_result(result);
+    journal.append(orig_input, result.text);
+    history.add(std::move(orig_input), std::move(result.text));
 }
 
-[[nodiscard]] constexpr bool check_var_assign_error(const std::string_view expression, const char var_char) {
-    if (expression.empty()) {
-        UI::print_error("Empty input received");
-        return true;
-    } else if (var_char == 'E') {
-        UI::print_error("e is reserved for euler");
-        return true;
-    } else if (std::isdigit(var_char)) {
-        UI::print_error("You can't assign a number to another number");
-        return true;
-    } else if (Util::contains_bool_op(expression)) {
-        UI::print_error("Variables are for math expressions only");
-        return true;
-    }
-    return false;
+// Huge results are printed as they're converted, see CCalc::Context::set_sink. started is set by the first piece,
+// so the line can be finished even when the evaluation fails partway through
+[[nodiscard]] CCalc::Sink result_printer(bool& started) {
+    return [&started](const std::string_view piece) {
+        UI::print_result_piece(piece, !started);
+        started = true;
+    };
 }
 
-// \0 is what I decided to store ANS in. So we always need to save the answer in the var map to update ANS
-void evaluate_expression(std::string& orig_input, std::string& expression,
-                         std::vector<std::pair<std::string, std::string> >& history,
-                         std::unordered_map<char, std::string>& var_map) {
-    const char var_char = expression[1] == '=' ? static_cast<char>(expression[0]) : '\0';
-    if (var_char != '\0') expression = expression.substr(2);
-    if (var_char != '\0' && check_var_assign_error(expression, var_char)) return;
-
-    std::string num_check = check_num_input(orig_input, expression, history, var_map);
-    if (num_check == "ANS") return;
-    if (!num_check.empty()) {
-        var_map.insert_or_assign(var_char, std::move(num_check));
-        return;
-    }
-    const ParseResult result = Parse::create_prefix_expression(expression, var_map);
+// Everything but a streamed result, which is already out
+void print_outcome(const CCalc::Result& result, const bool started) {
+    if (started) UI::print_result_end();
     if (!result.success) {
-        UI::print_error(result.error_msg);
-        return;
+        UI::print_error(result.text);
+    } else if (!result.streamed) {
+        UI::print_result(result.text);
     }
-    if(result.is_math) {
-        std::string result_copy = math_procedure(orig_input, result, history);
-        if (!result_copy.empty()) var_map.insert_or_assign(var_char, std::move(result_copy));
-    } else {
-        bool_procedure(orig_input, result.result, history);
+}
+
+// \0 is what I decided to store ANS in, the context updates it along with any assigned variable.
+// An assignment is saved straight away so other running processes see it
+void evaluate_expression(std::string& orig_input, const std::string_view expression,
+                         History::Ring& history, CCalc::Context& context,
+                         File::Journal& journal, File::SharedState& state, const bool show_stats,
+                         Metrics::PhaseCounters* const counters) {
+    CCalc::Stats stats;
+    bool started = false;
+    const CCalc::Sink sink = result_printer(started);
+    context.set_sink(&sink);
+    CCalc::Result result = counters     ? counters->evaluate(context, expression, stats)
+                           : show_stats ? context.evaluate(expression, stats)
+                                        : context.evaluate(expression);
+    context.set_sink(nullptr);
+    print_outcome(result, started);
+    if (!result.success) return;
+    if (show_stats) UI::print_stats(stats);
+    const char target = CCalc::variable_use(expression).target;
+    if (target != '\0' && !state.publish(context.variables(), std::string_view(&target, 1))) [[unlikely]] {
+        UI::print_error("Unable to save variables");
     }
+    add_to_history(orig_input, std::move(result), history, journal);
 }
 
-[[nodiscard]] int program_loop() {
-    std::vector<std::pair<std::string, std::string> > history;
-    history.reserve(static_cast<std::size_t>(Startup::settings.at(Setting::MAX_HISTORY)));
-    std::unordered_map<char, std::string> var_map;
-    Startup::startup(history, var_map);
+[[nodiscard]] int program_loop(Metrics::PhaseCounters* const counters) {
+    History::Ring history(static_cast<std::size_t>(Startup::settings().at(Setting::MAX_HISTORY)));
+    CCalc::Context context(Startup::calculator_settings());
+    File::Journal journal(Startup::history_location, static_cast<std::size_t>(Startup::settings().at(Setting::MAX_HISTORY)),
+                          Startup::state_location);
+    File::SharedState state(Startup::state_location, Startup::var_map_location);
+    Startup::startup(history, context.variables(), journal);
+    context.set_cancel_flag(Signal::cancel_flag());
+    bool show_stats = false;
+    Jobs::Manager jobs;
+    Session session{history, context, journal, state, jobs};
+    const SessionScope session_scope(session);
+    rl_event_hook = event_hook;
 
     while (true) {
+        post_finished_jobs(session);
         char* const input_expression = readline("Please enter your expression, or enter help to see all available commands: ");
-        if (check_signal_flags(history, var_map)) return 1;
+        if (check_signal_flags(journal, state, context.variables())) return 1;
 
         // If the input fails
         if (!input_expression) [[unlikely]] {
             std::cerr << "Unknown error ocurred in receiving input. Aborting...\n";
-            shutdown(history, var_map);
+            shutdown(journal, state, context.variables());
             return 1;
         }
 
@@ -355,57 +395,89 @@ void evaluate_expression(std::string& orig_input, std::string& expression,
             continue;
         }
         std::string orig_input = input_expression_string;
+        if (Logic::is_logic_command(input_expression_string)) {
+            add_history(orig_input.c_str());
+            Logic::run_logic_command(input_expression_string, context.settings().threads);
+            // Ctrl-C while it ran only stopped the command, the next one at the prompt exits
+            Signal::consume_interrupt();
+            continue;
+        }
 
+        state.refresh(context.variables());
         // Remove spaces from the user's input
         input_expression_string.erase(remove(input_expression_string.begin(), input_expression_string.end(), ' '), input_expression_string.end());
-        const Engine::InputResult result = handle_input(input_expression_string, history, var_map);
+        const Engine::InputResult result = handle_input(input_expression_string, history, context.variables(), journal,
+                                                        show_stats, jobs);
 
         // Based upon the input the program exits, continues, or evaluates the expression
         switch (result) {
             case Engine::InputResult::QUIT_SUCCESS:
-                shutdown(history, var_map);
+                shutdown(journal, state, context.variables());
+                if (counters) UI::print_phase_counters(*counters);
                 return 0;
             case Engine::InputResult::QUIT_FAILURE:
-                shutdown(history, var_map);
+                shutdown(journal, state, context.variables());
                 return 1;
             case Engine::InputResult::CONTINUE:
                 continue;
             default:
-                std::ranges::transform(input_expression_string, input_expression_string.begin(), [](const auto c){ return std::toupper(c); });
-                evaluate_expression(orig_input, input_expression_string, history, var_map);
+                if (input_expression_string.ends_with('&')) {
+                    start_job(orig_input, input_expression_string, session);
+                    continue;
+                }
+                evaluate_expression(orig_input, input_expression_string, history, context, journal, state,
+                                    show_stats, counters);
+                Signal::consume_interrupt();
         }
     }
     
 }
 
-// Non continuous mode
-void evaluate_expression(std::string& expression) {
-    std::vector<std::pair<std::string, std::string> > history;
-    history.reserve(static_cast<std::size_t>(Startup::settings.at(Setting::MAX_HISTORY)));
-    std::unordered_map<char, std::string> var_map;
-    Startup::startup(history, var_map);
-
-    std::string orig_input = expression;
-    expression.erase(remove(expression.begin(), expression.end(), ' '), expression.end());
-    if (expression.empty()) {
-        UI::print_error("Empty input received");
+// Non continuous mode. Readline, the signal handlers, and the history aren't needed for one expression, and the
+// variables are only read if the expression uses them. Unless save_oneshot is set, only an assignment is saved,
+// and it's merged with the saved variables rather than replacing them
+void evaluate_expression(const std::string& expression, const bool show_stats,
+                         Metrics::PhaseCounters* const counters) {
+    const bool save_oneshot = Startup::settings().at(Setting::SAVE_ONESHOT) == 1;
+    const CCalc::VariableUse use = CCalc::variable_use(expression);
+    std::string saved_names;
+    if (use.target != '\0') saved_names.push_back(use.target);
+    if (save_oneshot) saved_names.push_back('\0');
+    CCalc::Context context(Startup::calculator_settings());
+    if (!use.reads.empty()) File::read_vars(context.variables(), Startup::var_map_location);
+
+    CCalc::Stats stats;
+    bool started = false;
+    const CCalc::Sink sink = result_printer(started);
+    context.set_sink(&sink);
+    CCalc::Result result = counters     ? counters->evaluate(context, expression, stats)
+                           : show_stats ? context.evaluate(expression, stats)
+                                        : context.evaluate(expression);
+    print_outcome(result, started);
+    if (!result.success) {
+        if (counters) UI::print_phase_counters(*counters);
+        mpfr_free_cache();
         return;
     }
-
-    std::ranges::transform(expression, expression.begin(), [](const auto c){ return std::toupper(c); });
-    evaluate_expression(orig_input, expression, history, var_map);
-    shutdown(history, var_map);
+    if (show_stats) UI::print_stats(stats);
+    if (counters) UI::print_phase_counters(*counters);
+    if (save_oneshot) shorten_result(result);
+    if (save_oneshot && !File::append_history(expression, result.text, Startup::history_location,
+                                              Startup::state_location)) [[unlikely]] {
+        UI::print_error("Unable to save history");
+    }
+    if (!saved_names.empty()) {
+        File::SharedState state(Startup::state_location, Startup::var_map_location);
+        if (!state.publish(context.variables(), saved_names)) [[unlikely]] UI::print_error("Unable to save variables");
+    }
+    mpfr_free_cache();
 }
 
 void history_flag() {
-    std::vector<std::pair<std::string, std::string> > history;
-    history.reserve(static_cast<std::size_t>(Startup::settings.at(Setting::MAX_HISTORY)));
+    History::Ring history(static_cast<std::size_t>(Startup::settings().at(Setting::MAX_HISTORY)));
     using_history();
-    stifle_history(static_cast<int>(Startup::settings.at(Setting::MAX_HISTORY)));
-
-    std::ifstream file;
-    file.open(Startup::history_location);
-    if(file.is_open()) File::read_history(history, file);
+    stifle_history(static_cast<int>(std::min(history.max_entries(), History::recall_limit)));
+    File::read_history(history, Startup::history_location);
 
     if (!is_empty_history(history)) UI::print_history(history);
     cleanup_history();
@@ -413,17 +485,58 @@ void history_flag() {
 
 }
 
-[[nodiscard]] int start_engine(const int argc, const char* const argv[]) {
+[[nodiscard]] int start_engine(int argc, const char* const argv[]) {
+    // The pool is opt in until ccalc_bench --allocator shows a repeatable gain. It's installed before anything makes
+    // a number, the pool can't take back blocks that came from malloc
+    const bool pool = argc >= 2 && std::string_view(argv[1]) == "--pool";
+    if (pool) {
+        --argc;
+        ++argv;
+    }
+    Memory::track(pool ? Memory::Allocator::POOL : Memory::Allocator::MALLOC);
+    // The mode after --counters, or after --metrics and its file, is read like any other
+    std::unique_ptr<Metrics::PhaseCounters> counters;
+    if (argc >= 2 && std::string_view(argv[1]) == "--counters") {
+        if (argc < 3 || !counted_mode(argv[2])) {
+            UI::print_error("--counters goes in front of -c, -f, --stats, or an expression");
+            return 1;
+        }
+        counters = std::make_unique<Metrics::PhaseCounters>();
+        --argc;
+        ++argv;
+    }
+    std::unique_ptr<Metrics::Writer> metrics;
+    if (argc >= 2 && std::string_view(argv[1]) == "--metrics") {
+        metrics = open_metrics(argc, argv);
+        if (!metrics) return 1;
+        argc -= 2;
+        argv += 2;
+    }
+    if (argc >= 2 && std::string_view(argv[1]) == "--serve") {
+        if (argc != 3) {
+            UI::print_error("Expected a socket path: ccalc --serve /path/to/socket");
+            return 1;
+        }
+        return Server::serve(argv[2], metrics.get());
+    }
+    if (argc >= 2 && std::string_view(argv[1]) == "--stats") {
+        if (argc != 3) {
+            UI::print_error("Expected an expression: ccalc --stats 'expression'");
+            return 1;
+        }
+        evaluate_expression(argv[2], true, counters.get());
+        return 0;
+    }
     if (check_argc(argc)) return 1;
 
     std::string expression = argv[1];
     if (expression == "-c" || expression == "--continuous") {
-        return program_loop();
+        return program_loop(counters.get());
     } else if (expression == "-v" || expression == "--version") {
         UI::print_version();
         return 0;
     } else if (expression == "-f" || expression == "--file") {
-        File::initiate_file_mode();
+        File::initiate_file_mode(metrics.get(), counters.get());
         return 0;
     } else if (expression == "-h" || expression == "--help") {
         UI::print_help();
@@ -437,7 +550,10 @@ void history_flag() {
         return 1;
     }
 
-    evaluate_expression(expression);
+    if (Logic::is_logic_command(expression)) {
+        return Logic::run_logic_command(expression, Startup::calculator_settings().threads) ? 0 : 1;
+    }
+    evaluate_expression(expression, false, counters.get());
     return 0;
 }
 
@@ -0,0 +1,159 @@
+// Author: Caden LeCluyse
+
+#include "engine/jobs.h"
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <mpfr.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "engine/signal.h"
+#include "include/value.hpp"
+#include "lib/ccalc.h"
+
+namespace Jobs {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// How often a wait looks for a signal, the same as readline's event hook
+inline constexpr auto signal_check_interval = std::chrono::milliseconds(100);
+
+}  // namespace
+
+struct Manager::Job {
+    Job(const std::size_t _id, std::string _input, std::string _expression, const CCalc::Settings& settings,
+        const Types::VarMap& vars)
+        : id(_id), input(std::move(_input)), expression(std::move(_expression)), context(settings) {
+        context.variables() = vars;
+        context.set_cancel_flag(&cancel);
+        context.set_sink(&summary);
+    }
+
+    const std::size_t id;
+    const std::string input;
+    const std::string expression;
+    const Clock::time_point started = Clock::now();
+    // Empty, so a huge result is only kept as its start and digit count, and the value is left in ANS or its variable
+    const CCalc::Sink summary;
+    CCalc::Context context;
+    std::atomic<bool> cancel{false};
+    std::thread thread;
+    // Guarded by the manager's mutex
+    bool done = false;
+    std::size_t finish_order = 0;
+    CCalc::Result result;
+};
+
+Manager::Manager() = default;
+
+Manager::~Manager() {
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& job : m_jobs) job->cancel.store(true, std::memory_order_relaxed);
+    }
+    for (const auto& job : m_jobs) {
+        if (job->thread.joinable()) job->thread.join();
+    }
+}
+
+std::size_t Manager::start(std::string input, std::string expression, const CCalc::Settings& settings,
+                           const Types::VarMap& vars) {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    const std::size_t id = m_next_id++;
+    auto& job = *m_jobs.emplace_back(
+        std::make_unique<Job>(id, std::move(input), std::move(expression), settings, vars));
+
+    // Ctrl-C is for the expression in the foreground, so the signals go to the main thread
+    sigset_t signals;
+    sigset_t previous;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, &previous);
+    job.thread = std::thread([this, &job] {
+        CCalc::Result result = job.context.evaluate(job.expression);
+        // MPFR caches constants like pi per thread
+        mpfr_free_cache();
+        const std::lock_guard<std::mutex> job_lock(m_mutex);
+        job.result = std::move(result);
+        job.done = true;
+        job.finish_order = m_finish_count++;
+        m_finished.notify_all();
+    });
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    return id;
+}
+
+std::vector<Finished> Manager::take_finished() {
+    std::vector<std::unique_ptr<Job> > done_jobs;
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& job : m_jobs) {
+            if (job->done) done_jobs.push_back(std::move(job));
+        }
+        std::erase(m_jobs, nullptr);
+    }
+    std::ranges::sort(done_jobs, {}, [](const auto& job) { return job->finish_order; });
+
+    std::vector<Finished> finished;
+    for (const auto& job : done_jobs) {
+        job->thread.join();
+        Finished& taken = finished.emplace_back();
+        taken.id = job->id;
+        taken.input = job->input;
+        taken.result = std::move(job->result);
+        taken.killed = !taken.result.success && job->cancel.load(std::memory_order_relaxed);
+        taken.target = CCalc::variable_use(job->expression).target;
+        if (!taken.result.success) continue;
+        auto& vars = job->context.variables();
+        const auto value = vars.find(taken.target);
+        if (value != vars.end()) taken.value.emplace(std::move(value->second));
+    }
+    return finished;
+}
+
+bool Manager::any_finished() const {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return std::ranges::any_of(m_jobs, [](const auto& job) { return job->done; });
+}
+
+std::vector<Running> Manager::running() const {
+    const Clock::time_point now = Clock::now();
+    std::vector<Running> jobs;
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& job : m_jobs) {
+        if (job->done) continue;
+        jobs.push_back(Running{job->id, job->input, std::chrono::duration<double>(now - job->started).count()});
+    }
+    return jobs;
+}
+
+bool Manager::kill(const std::size_t id) {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    const auto found = std::ranges::find_if(m_jobs, [id](const auto& job) { return job->id == id && !job->done; });
+    if (found == m_jobs.end()) return false;
+    (*found)->cancel.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+bool Manager::wait(const std::size_t id) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const auto waiting = [this, id] {
+        return std::ranges::any_of(m_jobs, [id](const auto& job) { return (id == 0 || job->id == id) && !job->done; });
+    };
+    if (!waiting()) return false;
+    while (waiting() && !Signal::signal_received()) m_finished.wait_for(lock, signal_check_interval);
+    return true;
+}
+
+}  // namespace Jobs
@@ -0,0 +1,72 @@
+// Author: Caden LeCluyse
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "include/value.hpp"
+#include "lib/ccalc.h"
+
+// Expressions evaluated in the background in continuous mode, each on its own thread with its own context.
+// A job starts with a copy of the variables, and its result is handed back to the main thread when it's taken,
+// so the history, ANS, and the variables are only ever touched by the main thread
+namespace Jobs {
+
+struct Finished {
+    std::size_t id = 0;
+    std::string input; // As it was typed, without the &
+    CCalc::Result result;
+    bool killed = false;
+    char target = '\0'; // The variable the result goes in, '\0' is ANS
+    std::optional<Types::Value> value; // Set if it succeeded
+};
+
+struct Running {
+    std::size_t id;
+    std::string input;
+    double seconds;
+};
+
+class Manager {
+   public:
+    Manager();
+    // Running jobs are killed, and their threads joined
+    ~Manager();
+    Manager(const Manager&) = delete;
+    Manager& operator=(const Manager&) = delete;
+
+    // Starts evaluating expression, which is already stripped of spaces, and returns the job number
+    std::size_t start(std::string input, std::string expression, const CCalc::Settings& settings,
+                      const Types::VarMap& vars);
+    // The jobs that finished since the last call, in the order they finished
+    [[nodiscard]] std::vector<Finished> take_finished();
+    [[nodiscard]] bool any_finished() const;
+    [[nodiscard]] std::vector<Running> running() const;
+    // Stops a running job at its next check. Returns false if no job with that number is running
+    bool kill(std::size_t id);
+    // Blocks until the job finishes, or every job if id is 0. Stops waiting early if a signal arrives.
+    // Returns false if no job with that number is running
+    bool wait(std::size_t id);
+
+   private:
+    struct Job;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_finished;
+    std::vector<std::unique_ptr<Job> > m_jobs; // Running, and finished but not taken yet
+    std::size_t m_next_id = 1;
+    std::size_t m_finish_count = 0;
+};
+
+}  // namespace Jobs
+
+#endif
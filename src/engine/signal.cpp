@@ -1,5 +1,6 @@
 #include "engine/signal.h"
 
+#include <atomic>
 #include <csignal>
 #include <fstream>
 #include <readline/readline.h>
@@ -13,12 +14,17 @@ namespace {
 
 volatile sig_atomic_t g_got_sigint = 0;
 volatile sig_atomic_t g_got_sigterm = 0;
+// Lock free, so it's safe to set in a handler
+std::atomic<bool> g_cancel{false};
+static_assert(std::atomic<bool>::is_always_lock_free);
 
 void sigint_handler([[maybe_unused]] int sig) {
     g_got_sigint = 1;
+    g_cancel.store(true, std::memory_order_relaxed);
 }
 void sigterm_handler([[maybe_unused]] int sig) {
     g_got_sigterm = 1;
+    g_cancel.store(true, std::memory_order_relaxed);
 }
 
 }
@@ -27,6 +33,17 @@ void sigterm_handler([[maybe_unused]] int sig) {
     return g_got_sigint || g_got_sigterm;
 }
 
+const std::atomic<bool>* cancel_flag() {
+    return &g_cancel;
+}
+
+bool consume_interrupt() {
+    if (!g_got_sigint || g_got_sigterm) return false;
+    g_got_sigint = 0;
+    g_cancel.store(false, std::memory_order_relaxed);
+    return true;
+}
+
 int check_signals_hook() {
     if (signal_received()) {
         rl_done = 1;
@@ -1,9 +1,16 @@
 #ifndef SIGNAL_H
 #define SIGNAL_H
 
+#include <atomic>
+
 namespace Signal {
 
 [[nodiscard]] bool signal_received();
+// Set by both signals, for contexts to watch so evaluations stop part way through
+[[nodiscard]] const std::atomic<bool>* cancel_flag();
+// A SIGINT while an expression is evaluated only stops that expression. Clears it and returns true, unless a
+// SIGTERM came too
+bool consume_interrupt();
 int check_signals_hook();
 void register_handlers();
 
@@ -3,23 +3,26 @@
 #include "file/file.h"
 
 #include <algorithm>
+#include <array>
 #include <cstdio>
+#include <filesystem>
 #include <fstream>
 #include <gmpxx.h>
 #include <iostream>
 #include <mpfr.h>
 #include <optional>
-#include <readline/history.h>
 #include <span>
 #include <string>
+#include <string_view>
 #include <stdio.h>
+#include <unistd.h>
 #include <unordered_map>
 #include <vector>
 
-#include "ast/ast.h"
 #include "include/types.hpp"
 #include "include/util.hpp"
-#include "parser/parser.h"
+#include "include/value.hpp"
+#include "lib/ccalc.h"
 #include "startup/startup.h"
 #include "ui/ui.h"
 
@@ -28,52 +31,105 @@ using namespace Types;
 // We have to use C style file output here since mpfr is a C library
 namespace File {
 
-void read_history(std::vector<std::pair<std::string, std::string> >& history, std::ifstream& input_file) {
+namespace {
+
+// The variables file starts with this, followed by one record per variable until the end of the file.
+// A record is the name ('\0' for ANS), then Z and an integer in GMP's raw format, or F and a float in MPFR's
+// portable format. Both formats are independent of the machine that wrote them
+inline constexpr std::string_view vars_magic = "CCVARS1\n";
+
+// Before the binary format, variables were stored as a line with the name and a line with the printed result
+void read_text_vars(VarMap& vars, std::ifstream& input_file) {
     std::string line;
     std::string line2;
 
-    while (std::getline(input_file, line)) {
-        std::getline(input_file,line2);
-        add_history(line.data());
-        history.emplace_back(std::move(line), std::move(line2));
+    while (std::getline(input_file, line) && std::getline(input_file, line2)) {
+        if (line.empty() || line2.empty()) continue;
+        const char name = line == "ANS" ? '\0' : line[0];
+        if (line2.find('.') == std::string::npos) {
+            mpz_class integer;
+            if (integer.set_str(line2, 10) == 0) vars.insert_or_assign(name, Value(std::move(integer)));
+            continue;
+        }
+        mpfr_t floating_point;
+        mpfr_init2(floating_point, static_cast<mpfr_prec_t>(Startup::settings().at(Setting::PRECISION)));
+        if (mpfr_set_str(floating_point, line2.c_str(), 10, MPFR_RNDN) == 0) {
+            vars.insert_or_assign(name, Value(floating_point));
+        }
+        mpfr_clear(floating_point);
     }
 }
 
-void read_vars(std::unordered_map<char, std::string>& vars, std::ifstream& input_file) {
-    std::string line;
-    std::string line2;
+}  // namespace
+
+void read_vars(VarMap& vars, const std::string& path) {
+    FILE* const input_file = fopen(path.c_str(), "rb");
+    if (!input_file) return;
 
-    while (std::getline(input_file, line)) {
-        std::getline(input_file,line2);
-        if (line == "ANS") vars.emplace('\0', std::move(line2));
-        else vars.emplace(line[0], std::move(line2));
+    std::array<char, vars_magic.size()> magic{};
+    if (fread(magic.data(), 1, magic.size(), input_file) != magic.size() ||
+        std::string_view(magic.data(), magic.size()) != vars_magic) {
+        fclose(input_file);
+        std::ifstream text_file(path);
+        if (text_file.is_open()) read_text_vars(vars, text_file);
+        return;
     }
-}
 
-// Utility function for outputting to a file
-void write_history(const std::span<const std::pair<std::string, std::string> > history, 
-                    std::ofstream& output_file) {
-    std::ranges::for_each(history, [&output_file](const auto& expression_result) {
-        const auto& [expression, result] = expression_result;
-        output_file << expression << "\n" << result << '\n';
-    });
+    // A truncated record ends the file, everything before it is kept
+    int name;
+    while ((name = fgetc(input_file)) != EOF) {
+        const int kind = fgetc(input_file);
+        if (kind == 'Z') {
+            mpz_class integer;
+            if (!mpz_inp_raw(integer.get_mpz_t(), input_file)) break;
+            vars.insert_or_assign(static_cast<char>(name), Value(std::move(integer)));
+        } else if (kind == 'F') {
+            mpfr_t floating_point;
+            mpfr_init2(floating_point, MPFR_PREC_MIN); // The import sets the stored precision
+            const bool imported = mpfr_fpif_import(floating_point, input_file) == 0;
+            if (imported) vars.insert_or_assign(static_cast<char>(name), Value(floating_point));
+            mpfr_clear(floating_point);
+            if (!imported) break;
+        } else {
+            break;
+        }
+    }
+    fclose(input_file);
 }
 
 // Utility function for outputting to a file for a user
-void output_history(const std::span<const std::pair<std::string, std::string> > history, 
-                    std::ofstream& output_file) {
-    std::ranges::for_each(history, [&output_file](const auto& expression_result) {
-        const auto& [expression, result] = expression_result;
+void output_history(const History::Ring& history, std::ofstream& output_file) {
+    for (std::size_t i = 0; i < history.size(); ++i) {
+        const auto& [expression, result] = history[i];
         output_file << "Expression: " << expression << "\nResult: " << result << '\n';
-    });
+    }
 }
 
-void write_vars(const std::unordered_map<char, std::string>& vars, std::ofstream& output_file) {
-    std::ranges::for_each(vars, [&output_file](const auto& expression_result) {
-        const auto& [var, result] = expression_result;
-        if (var == '\0') output_file << "ANS\n" << result << '\n';
-        else output_file << var << '\n' << result << '\n';
-    });
+// The variables are written to a new file that replaces the old one, so a process reading it never sees half of it
+bool write_vars(const VarMap& vars, const std::string& path) {
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    const std::string temp_path = path + ".tmp" + std::to_string(getpid());
+    FILE* const output_file = fopen(temp_path.c_str(), "wb");
+    if (!output_file) return false;
+
+    bool written = fwrite(vars_magic.data(), 1, vars_magic.size(), output_file) == vars_magic.size();
+    for (const auto& [name, value] : vars) {
+        if (!written) break;
+        written = fputc(name, output_file) != EOF && fputc(value.is_floating_point() ? 'F' : 'Z', output_file) != EOF;
+        if (!written) break;
+        if (value.is_floating_point()) {
+            // mpfr_fpif_export only reads the value, it just isn't declared const
+            written = mpfr_fpif_export(output_file, const_cast<mpfr_ptr>(value.floating_point())) == 0;
+        } else {
+            written = mpz_out_raw(output_file, value.integer().get_mpz_t()) != 0;
+        }
+    }
+    if (fclose(output_file) != 0 || !written || rename(temp_path.c_str(), path.c_str()) != 0) {
+        remove(temp_path.c_str());
+        return false;
+    }
+    return true;
 }
 
 namespace {
@@ -97,82 +153,37 @@ namespace {
     return expressions;
 }
 
-bool mpfr_to_file(FILE*& output_file, const mpfr_t& final_value, const mpfr_prec_t display_precision) {
-    std::string buffer;
-    buffer.reserve(Util::buffer_size);
-    if(!Util::convert_mpfr_string(buffer, final_value, display_precision)) [[unlikely]] return false;
-    fprintf(output_file, "Result: %s\n", buffer.c_str());
-    return true;
-}
-
-void math_float_procedure(FILE*& output_file, const std::span<const Token> result) {
-    try {
-        const auto tree = std::make_unique<MathAST>();
-        tree->build_ast(result, true);
-        const mpfr_t& final_value = tree->evaluate_floating_point();
-        if (mpfr_integer_p(final_value)) {
-            mpfr_fprintf(output_file, "Result: %.0Rf\n", final_value);
-        } else {
-            if(!mpfr_to_file(output_file, final_value,
-                             static_cast<mpfr_prec_t>(Startup::settings.at(Setting::DISPLAY_PREC)))) [[unlikely]] return;
-        }
-    } catch (const std::exception& err) {
-        fprintf(output_file, "Error: %s\n", err.what()); 
-    }
-}
-
-void math_int_procedure(FILE*& output_file, const std::span<const Token> result) {
-    try {
-        const auto tree = std::make_unique<MathAST>();
-        tree->build_ast(result, false);
-        const mpz_class final_value = tree->evaluate();
-        gmp_fprintf(output_file, "Result: %Zd\n", final_value.get_mpz_t());
-    } catch (const std::bad_alloc& err) {
-        fprintf(output_file, "Error: The number grew too big!\n"); 
-    } catch (const std::exception& err) {
-        fprintf(output_file, "Error: %s\n", err.what()); 
-    }
-}
-
-void math_procedure(FILE*& output_file, const ParseResult& result) {
-    if (result.is_floating_point) {
-        math_float_procedure(output_file, result.result);
-    } else {
-        math_int_procedure(output_file, result.result);
-    }
-}
-
-void bool_procedure(FILE*& output_file, const std::span<const Token> result) {
-    const auto syntax_tree = std::make_unique<BoolAST>();
-    syntax_tree->build_ast(result);
-    if (syntax_tree->evaluate()) {
-        fprintf(output_file, "Result: True\n");
-    } else {
-        fprintf(output_file, "Result: False\n");
-    }
-}
-
-void main_loop(FILE*& output_file, std::string& expression, const std::unordered_map<char, std::string>& var_map) {
-    const std::string orig_expression = expression;
-    expression.erase(remove(expression.begin(), expression.end(), ' '), expression.end());
-    std::ranges::transform(expression, expression.begin(), [](const auto c){ return std::toupper(c); });
-    const ParseResult result = Parse::create_prefix_expression(expression, var_map);
-
-    fprintf(output_file, "Expression: %s\n", orig_expression.c_str());
+void main_loop(FILE*& output_file, const std::string& expression, CCalc::Context& context,
+               Metrics::Writer* const metrics, Metrics::PhaseCounters* const counters) {
+    CCalc::Stats stats;
+    fprintf(output_file, "Expression: %s\n", expression.c_str());
+    // Huge results are written as they're converted, a piece at a time, see CCalc::Context::set_sink
+    bool started = false;
+    const CCalc::Sink sink = [output_file, &started](const std::string_view piece) {
+        if (!started) fputs("Result: ", output_file);
+        started = true;
+        fwrite(piece.data(), 1, piece.size(), output_file);
+    };
+    context.set_sink(&sink);
+    const CCalc::Result result = metrics    ? metrics->evaluate(context, expression)
+                                 : counters ? counters->evaluate(context, expression, stats)
+                                            : context.evaluate(expression);
+    context.set_sink(nullptr);
+    if (started) fputc('\n', output_file);
     if (!result.success) {
-        fprintf(output_file, "Error: %s\n", result.error_msg.c_str());
+        fprintf(output_file, "Error: %s\n", result.text.c_str());
         return;
     }
-    if(result.is_math) {
-        math_procedure(output_file, result);
-    } else {
-        bool_procedure(output_file, result.result);
-    }
+    if (result.streamed) return;
+    // Written as is, fprintf would go over a million digit result again to find its length
+    fputs("Result: ", output_file);
+    fwrite(result.text.data(), 1, result.text.size(), output_file);
+    fputc('\n', output_file);
 }
 
 }  // namespace
 
-void initiate_file_mode() {
+void initiate_file_mode(Metrics::Writer* const metrics, Metrics::PhaseCounters* const counters) {
     std::vector<std::string> expressions = get_expressions();
     if (expressions.empty()) [[unlikely]] return;
     const std::optional<std::string> output_file_name = Util::get_filename(true);
@@ -184,14 +195,14 @@ void initiate_file_mode() {
         return;
     }
 
-    std::unordered_map<char, std::string> var_map;
-    std::ifstream vars;
-    vars.open(Startup::var_map_location);
-    read_vars(var_map, vars);
-    for (auto& expression : expressions) {
-        main_loop(output_file, expression, var_map);
+    CCalc::Context context(Startup::calculator_settings());
+    read_vars(context.variables(), Startup::var_map_location);
+    for (const auto& expression : expressions) {
+        main_loop(output_file, expression, context, metrics, counters);
     }
     fclose(output_file);
+    if (counters) UI::print_phase_counters(*counters);
+    mpfr_free_cache();
 }
 
 }  // namespace File
@@ -4,22 +4,23 @@
 #define FILE_H
 
 #include <fstream>
-#include <readline/history.h>
 #include <span>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "history/history.h"
+#include "include/value.hpp"
+#include "metrics/metrics.h"
+
 namespace File {
 
-void read_history(std::vector<std::pair<std::string, std::string> >& history, std::ifstream& input_file);
-void read_vars(std::unordered_map<char, std::string>&  history, std::ifstream& input_file);
-void write_history(const std::span<const std::pair<std::string, std::string> > history, 
-                    std::ofstream& output_file);
-void output_history(const std::span<const std::pair<std::string, std::string> > history, 
-                    std::ofstream& output_file);
-void write_vars(const std::unordered_map<char, std::string>& vars, std::ofstream& output_file);
-void initiate_file_mode();
+// Missing or unreadable files leave vars as they are
+void read_vars(Types::VarMap& vars, const std::string& path);
+void output_history(const History::Ring& history, std::ofstream& output_file);
+[[nodiscard]] bool write_vars(const Types::VarMap& vars, const std::string& path);
+// Records every expression in metrics, or counts its phases in counters, if they aren't null
+void initiate_file_mode(Metrics::Writer* const metrics, Metrics::PhaseCounters* const counters);
 
 }  // namespace File
 
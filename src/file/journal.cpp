@@ -0,0 +1,353 @@
+// Author: Caden LeCluyse
+
+#include "file/journal.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <mutex>
+#include <readline/history.h>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "file/shared_state.h"
+
+namespace File {
+
+namespace {
+
+// Losing at most this many entries, or this much time, to a crash is the price of not syncing every record
+inline constexpr std::size_t sync_batch_records = 16;
+inline constexpr std::chrono::seconds sync_interval{1};
+// Compacting is a full rewrite, so small histories are left to grow a little past twice their size first
+inline constexpr std::size_t min_compaction_records = 64;
+
+using EntryView = std::pair<std::string_view, std::string_view>;
+
+[[nodiscard]] bool write_all(const int fd, const std::string_view data) {
+    std::size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t result = write(fd, data.data() + written, data.size() - written);
+        if (result == -1) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        written += static_cast<std::size_t>(result);
+    }
+    return true;
+}
+
+// The separators and newlines are replaced so an entry can never break the framing
+void append_field(std::string& buffer, const std::string_view field) {
+    for (const char c : field) {
+        buffer.push_back(c == record_separator || c == unit_separator || c == '\n' ? ' ' : c);
+    }
+}
+
+void append_record(std::string& buffer, const std::string_view expression, const std::string_view result) {
+    buffer.push_back(record_separator);
+    append_field(buffer, expression);
+    buffer.push_back(unit_separator);
+    append_field(buffer, result);
+    buffer.push_back('\n');
+}
+
+// Before the journal, the history was an expression line followed by a result line
+void parse_legacy(std::string_view data, std::vector<EntryView>& entries) {
+    while (!data.empty()) {
+        const std::size_t expression_end = data.find('\n');
+        if (expression_end == std::string_view::npos) break;
+        const std::size_t result_end = data.find('\n', expression_end + 1);
+        if (result_end == std::string_view::npos) break;
+        entries.emplace_back(data.substr(0, expression_end),
+                             data.substr(expression_end + 1, result_end - expression_end - 1));
+        data.remove_prefix(result_end + 1);
+    }
+}
+
+// Returns whether the data starts in the old format. Incomplete records are skipped
+bool parse_journal(std::string_view data, std::vector<EntryView>& entries) {
+    const std::size_t first_record = data.find(record_separator);
+    const bool legacy = !data.empty() && first_record != 0;
+    if (legacy) parse_legacy(data.substr(0, first_record), entries);
+    if (first_record == std::string_view::npos) return legacy;
+    data.remove_prefix(first_record);
+
+    while (!data.empty()) {
+        const std::size_t next_record = data.find(record_separator, 1);
+        const std::string_view record = data.substr(1, next_record == std::string_view::npos ? std::string_view::npos
+                                                                                                : next_record - 1);
+        const std::size_t unit = record.find(unit_separator);
+        if (unit != std::string_view::npos && !record.empty() && record.back() == '\n') {
+            entries.emplace_back(record.substr(0, unit), record.substr(unit + 1, record.size() - unit - 2));
+        }
+        if (next_record == std::string_view::npos) break;
+        data.remove_prefix(next_record);
+    }
+    return legacy;
+}
+
+// Maps the first size bytes of the file, or the whole file if size is 0, and parses it
+class MappedJournal {
+   public:
+    explicit MappedJournal(const std::string& path, const std::size_t size = 0) {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1) return;
+        struct stat status;
+        if (fstat(fd, &status) == 0 && status.st_size > 0) {
+            m_size = size == 0 ? static_cast<std::size_t>(status.st_size)
+                               : std::min(size, static_cast<std::size_t>(status.st_size));
+            m_data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m_data == MAP_FAILED) {
+                m_data = nullptr;
+            } else {
+                madvise(m_data, m_size, MADV_SEQUENTIAL);
+                legacy = parse_journal(std::string_view(static_cast<const char*>(m_data), m_size), entries);
+            }
+        }
+        close(fd);
+    }
+    ~MappedJournal() {
+        if (m_data) munmap(m_data, m_size);
+    }
+    MappedJournal(const MappedJournal&) = delete;
+    MappedJournal& operator=(const MappedJournal&) = delete;
+
+    // The views point into the mapping, so they only live as long as this
+    std::vector<EntryView> entries;
+    bool legacy = false;
+
+   private:
+    void* m_data = nullptr;
+    std::size_t m_size = 0;
+};
+
+[[nodiscard]] bool same_file(const int fd, const std::string& path) {
+    struct stat open_status;
+    struct stat path_status;
+    return fstat(fd, &open_status) == 0 && stat(path.c_str(), &path_status) == 0 &&
+           open_status.st_dev == path_status.st_dev && open_status.st_ino == path_status.st_ino;
+}
+
+void sync_directory(const std::string& path) {
+    const int fd = open(std::filesystem::path(path).parent_path().c_str(), O_RDONLY);
+    if (fd == -1) return;
+    fsync(fd);
+    close(fd);
+}
+
+}  // namespace
+
+HistoryFile read_history(History::Ring& history, const std::string& path) {
+    const MappedJournal journal(path);
+    const std::size_t kept = std::min(journal.entries.size(), history.max_entries());
+    const std::size_t recalled = std::min(kept, History::recall_limit);
+    for (auto itr = journal.entries.end() - static_cast<std::ptrdiff_t>(kept); itr != journal.entries.end(); ++itr) {
+        if (journal.entries.end() - itr <= static_cast<std::ptrdiff_t>(recalled)) {
+            add_history(std::string(itr->first).c_str());
+        }
+        history.add(std::string(itr->first), std::string(itr->second));
+    }
+    return HistoryFile{journal.entries.size(), journal.legacy};
+}
+
+bool append_history(const std::string_view expression, const std::string_view result, const std::string& path,
+                    const std::string& state_path) {
+    std::string record;
+    append_record(record, expression, result);
+    const int lock_fd = open_state_file(state_path);
+    bool written;
+    {
+        // Opened under the lock, so a compaction can't swap the file between the open and the write
+        const FileLock lock(lock_fd, false);
+        const int fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+        written = fd != -1 && write_all(fd, record);
+        if (fd != -1 && close(fd) != 0) written = false;
+    }
+    if (lock_fd != -1) close(lock_fd);
+    return written;
+}
+
+Journal::Journal(std::string path, const std::size_t max_entries, const std::string& state_path)
+    : m_path(std::move(path)), m_max_entries(max_entries), m_lock_fd(open_state_file(state_path)),
+      m_last_sync(std::chrono::steady_clock::now()) {}
+
+Journal::~Journal() {
+    close();
+    if (m_lock_fd != -1) ::close(m_lock_fd);
+}
+
+void Journal::open_for_append() {
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(m_path).parent_path(), error);
+    m_fd = open(m_path.c_str(), O_RDWR | O_APPEND | O_CREAT, 0644);
+}
+
+// Called with the mutex and a lock on the state file held. Another process compacted the journal if the path
+// no longer leads to the open file
+void Journal::reopen_if_replaced() {
+    if (m_fd == -1 || same_file(m_fd, m_path)) return;
+    ::close(m_fd);
+    open_for_append();
+}
+
+void Journal::load(History::Ring& history) {
+    const HistoryFile file = read_history(history, m_path);
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_records = file.records;
+        open_for_append();
+        if (m_fd == -1) return;
+        if (!file.legacy) {
+            if (m_records > std::max(m_max_entries * 2, min_compaction_records)) start_compaction();
+            return;
+        }
+    }
+    // Appending records to the old format would make it unreadable, so it's converted before anything else
+    [[maybe_unused]] const bool compacted = compact();
+}
+
+void Journal::sync_locked() {
+    if (m_fd == -1 || m_unsynced == 0) return;
+    fsync(m_fd);
+    m_unsynced = 0;
+    m_last_sync = std::chrono::steady_clock::now();
+}
+
+void Journal::append(const std::string_view expression, const std::string_view result) {
+    std::string record;
+    append_record(record, expression, result);
+
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    {
+        const FileLock file_lock(m_lock_fd, false);
+        reopen_if_replaced();
+        if (m_fd == -1 || !write_all(m_fd, record)) return;
+    }
+    ++m_records;
+    ++m_unsynced;
+    if (m_unsynced >= sync_batch_records || std::chrono::steady_clock::now() - m_last_sync >= sync_interval) {
+        sync_locked();
+    }
+    if (m_records > std::max(m_max_entries * 2, min_compaction_records)) start_compaction();
+}
+
+// An empty file is renamed over the journal rather than truncating it in place, so a compaction in another
+// process finds the file replaced instead of copying a snapshot of the cleared entries back
+void Journal::clear() {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_generation;
+    m_records = 0;
+    const FileLock file_lock(m_lock_fd, true);
+    if (m_fd == -1) return;
+    const std::string temp_path = m_path + ".clear" + std::to_string(getpid());
+    const int temp_fd = open(temp_path.c_str(), O_RDWR | O_APPEND | O_CREAT | O_TRUNC, 0644);
+    if (temp_fd == -1) return;
+    if (rename(temp_path.c_str(), m_path.c_str()) == -1) {
+        ::close(temp_fd);
+        unlink(temp_path.c_str());
+        return;
+    }
+    sync_directory(m_path);
+    ::close(m_fd);
+    m_fd = temp_fd;
+    m_unsynced = 0;
+    m_last_sync = std::chrono::steady_clock::now();
+}
+
+void Journal::close() {
+    if (m_compactor.joinable()) m_compactor.join();
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fd == -1) return;
+    sync_locked();
+    ::close(m_fd);
+    m_fd = -1;
+}
+
+// Called with the mutex held
+void Journal::start_compaction() {
+    if (m_compacting.exchange(true)) return;
+    // The last compaction has finished, so this doesn't wait
+    if (m_compactor.joinable()) m_compactor.join();
+    m_compactor = std::thread([this] {
+        [[maybe_unused]] const bool compacted = compact();
+        m_compacting.store(false);
+    });
+}
+
+// Writes the newest entries to a new file and renames it over the journal. Only the snapshot and the swap hold
+// the mutex, records appended while the new file is written are copied over before the swap
+bool Journal::compact() {
+    std::size_t snapshot_size;
+    std::size_t snapshot_records;
+    std::size_t generation;
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        const FileLock file_lock(m_lock_fd, false);
+        reopen_if_replaced();
+        struct stat status;
+        if (m_fd == -1 || fstat(m_fd, &status) == -1) return false;
+        snapshot_size = static_cast<std::size_t>(status.st_size);
+        snapshot_records = m_records;
+        generation = m_generation;
+    }
+
+    const std::string temp_path = m_path + ".compact" + std::to_string(getpid());
+    const int temp_fd = open(temp_path.c_str(), O_RDWR | O_APPEND | O_CREAT | O_TRUNC, 0644);
+    if (temp_fd == -1) return false;
+
+    std::size_t kept = 0;
+    bool written = true;
+    if (snapshot_size != 0) {
+        const MappedJournal journal(m_path, snapshot_size);
+        kept = std::min(journal.entries.size(), m_max_entries);
+        std::string buffer;
+        for (auto itr = journal.entries.end() - static_cast<std::ptrdiff_t>(kept); itr != journal.entries.end();
+             ++itr) {
+            append_record(buffer, itr->first, itr->second);
+        }
+        written = write_all(temp_fd, buffer);
+    }
+
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    const FileLock file_lock(m_lock_fd, true);
+    struct stat status;
+    // Another process may have compacted or cleared the journal first, this snapshot is then of a file that's
+    // gone. A file shorter than the snapshot was never written by this format, which only appends
+    if (!written || generation != m_generation || m_fd == -1 || !same_file(m_fd, m_path) ||
+        fstat(m_fd, &status) == -1 || static_cast<std::size_t>(status.st_size) < snapshot_size) {
+        ::close(temp_fd);
+        unlink(temp_path.c_str());
+        return false;
+    }
+    // Records are only ever appended whole, so the tail starts and ends on a record boundary
+    std::string tail(static_cast<std::size_t>(status.st_size) - snapshot_size, '\0');
+    if (!tail.empty() && pread(m_fd, tail.data(), tail.size(), static_cast<off_t>(snapshot_size)) !=
+                             static_cast<ssize_t>(tail.size())) {
+        written = false;
+    }
+    if (!written || !write_all(temp_fd, tail) || fsync(temp_fd) == -1 ||
+        rename(temp_path.c_str(), m_path.c_str()) == -1) {
+        ::close(temp_fd);
+        unlink(temp_path.c_str());
+        return false;
+    }
+    sync_directory(m_path);
+    ::close(m_fd);
+    m_fd = temp_fd;
+    m_records = kept + (m_records - snapshot_records);
+    m_unsynced = 0;
+    m_last_sync = std::chrono::steady_clock::now();
+    return true;
+}
+
+}  // namespace File
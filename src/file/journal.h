@@ -0,0 +1,78 @@
+// Author: Caden LeCluyse
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "history/history.h"
+
+namespace File {
+
+// The history file is an append only journal. Each entry is one record, a record separator byte, the expression,
+// a unit separator byte, the result, and a newline. A record torn by a crash is skipped when reading, since the
+// next record starts with its own separator. Neither separator can appear in an expression that evaluated
+inline constexpr char record_separator = '\x1e';
+inline constexpr char unit_separator = '\x1f';
+
+struct HistoryFile {
+    std::size_t records = 0; // Every complete record in the file, not just the ones kept
+    bool legacy = false;     // The file starts in the line based format from before the journal
+};
+
+// Fills the history ring, and readline's history with the newest entries, from a single mmap of the file
+HistoryFile read_history(History::Ring& history, const std::string& path);
+// Appends one record without reading the file. Returns false if it couldn't be written
+bool append_history(std::string_view expression, std::string_view result, const std::string& path,
+                    const std::string& state_path);
+
+// The history journal for continuous mode. Every evaluation is appended as one write, the file is synced every
+// few records instead of every one, and once the file holds twice max_entries records it's compacted down to
+// the newest max_entries on a background thread.
+// Several processes can share the journal. Appends hold a shared lock on the state file, and the compaction takes
+// an exclusive one to copy the last records and swap the file, so a process that finds the file replaced reopens it
+class Journal {
+   public:
+    Journal(std::string path, std::size_t max_entries, const std::string& state_path);
+    ~Journal();
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // Reads the history and opens the journal for appending. A file in the old format is rewritten first
+    void load(History::Ring& history);
+    void append(std::string_view expression, std::string_view result);
+    void clear();
+    // Waits for a running compaction and syncs the file. Nothing is appended afterwards
+    void close();
+
+   private:
+    void open_for_append();
+    void reopen_if_replaced();
+    void sync_locked();
+    void start_compaction();
+    [[nodiscard]] bool compact();
+
+    const std::string m_path;
+    const std::size_t m_max_entries;
+    int m_fd = -1;
+    int m_lock_fd = -1;
+    std::size_t m_records = 0;
+    std::size_t m_unsynced = 0;
+    std::chrono::steady_clock::time_point m_last_sync;
+    std::size_t m_generation = 0; // Bumped by clear, so a compaction that started before it is dropped
+    std::mutex m_mutex;
+    std::thread m_compactor;
+    std::atomic<bool> m_compacting{false};
+};
+
+}  // namespace File
+
+#endif
@@ -0,0 +1,99 @@
+// Author: Caden LeCluyse
+
+#include "file/shared_state.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "file/file.h"
+#include "include/value.hpp"
+
+using namespace Types;
+
+namespace File {
+
+namespace {
+
+inline constexpr char state_magic[8] = {'C', 'C', 'S', 'T', 'A', 'T', 'E', '1'};
+// The header only needs a few bytes, but a page is what gets mapped anyway
+inline constexpr off_t state_file_size = 4096;
+
+}  // namespace
+
+FileLock::FileLock(const int fd, const bool exclusive) : m_fd(fd) {
+    while (m_fd != -1 && flock(m_fd, exclusive ? LOCK_EX : LOCK_SH) == -1) {
+        if (errno != EINTR) m_fd = -1;
+    }
+}
+
+FileLock::~FileLock() {
+    if (m_fd != -1) flock(m_fd, LOCK_UN);
+}
+
+int open_state_file(const std::string& state_path) {
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(state_path).parent_path(), error);
+    return open(state_path.c_str(), O_RDWR | O_CREAT, 0644);
+}
+
+SharedState::SharedState(const std::string& state_path, std::string vars_path) : m_vars_path(std::move(vars_path)) {
+    m_fd = open_state_file(state_path);
+    if (m_fd == -1) return;
+
+    {
+        // The first process to get here sizes the file, the zeroed counter is a valid starting value
+        const FileLock lock(m_fd, true);
+        struct stat status;
+        if (fstat(m_fd, &status) == -1 || (status.st_size < state_file_size && ftruncate(m_fd, state_file_size) == -1)) {
+            return;
+        }
+        void* const mapping = mmap(nullptr, sizeof(Header), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (mapping == MAP_FAILED) return;
+        m_header = static_cast<Header*>(mapping);
+        if (std::memcmp(m_header->magic, state_magic, sizeof(state_magic)) != 0) {
+            std::memcpy(m_header->magic, state_magic, sizeof(state_magic));
+        }
+    }
+    m_seen = m_header->vars_generation.load(std::memory_order_acquire);
+}
+
+SharedState::~SharedState() {
+    if (m_header) munmap(m_header, sizeof(Header));
+    if (m_fd != -1) close(m_fd);
+}
+
+void SharedState::refresh(VarMap& vars) {
+    if (!m_header) return;
+    const std::uint64_t generation = m_header->vars_generation.load(std::memory_order_acquire);
+    if (generation == m_seen) return;
+    m_seen = generation;
+
+    VarMap saved;
+    read_vars(saved, m_vars_path);
+    for (auto& [name, value] : saved) {
+        if (name != '\0') vars.insert_or_assign(name, std::move(value));
+    }
+}
+
+bool SharedState::publish(const VarMap& vars, const std::string_view names) {
+    const FileLock lock(m_fd, true);
+    VarMap saved;
+    read_vars(saved, m_vars_path);
+    for (const char name : names) {
+        const auto variable = vars.find(name);
+        if (variable != vars.end()) saved.insert_or_assign(name, Value(variable->second));
+    }
+    if (!write_vars(saved, m_vars_path)) return false;
+    if (m_header) m_header->vars_generation.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+}  // namespace File
@@ -0,0 +1,61 @@
+// Author: Caden LeCluyse
+
+#ifndef SHARED_STATE_H
+#define SHARED_STATE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "include/value.hpp"
+
+namespace File {
+
+// Holds an flock on the state file for as long as it lives. Locks are taken on separate opens of the file,
+// so two of them exclude each other even within one process. If the file couldn't be opened nothing is locked
+class FileLock {
+   public:
+    FileLock(int fd, bool exclusive);
+    ~FileLock();
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+   private:
+    int m_fd;
+};
+
+// Opens the state file for locking, creating it if needed. Returns -1 on failure
+[[nodiscard]] int open_state_file(const std::string& state_path);
+
+// Variables shared between every ccalc process of the user. Assignments are merged into the variables file
+// under an exclusive lock on the state file, and a counter in a shared mapping of that file tells the other
+// processes to read it again. ANS stays private to each process until it exits
+class SharedState {
+   public:
+    SharedState(const std::string& state_path, std::string vars_path);
+    ~SharedState();
+    SharedState(const SharedState&) = delete;
+    SharedState& operator=(const SharedState&) = delete;
+
+    // Picks up the variables other processes saved since the last call. Costs one atomic load if there are none
+    void refresh(Types::VarMap& vars);
+    // Saves the named variables ('\0' for ANS) from vars, keeping everything other processes saved
+    [[nodiscard]] bool publish(const Types::VarMap& vars, std::string_view names);
+
+   private:
+    struct Header {
+        char magic[8];
+        std::atomic<std::uint64_t> vars_generation;
+    };
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "The counter is shared between processes");
+
+    const std::string m_vars_path;
+    int m_fd = -1;
+    Header* m_header = nullptr;
+    std::uint64_t m_seen = 0;
+};
+
+}  // namespace File
+
+#endif
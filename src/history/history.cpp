@@ -0,0 +1,184 @@
+// Author: Caden LeCluyse
+
+#include "history/history.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace History {
+
+namespace {
+
+// Expressions are matched the way the calculator reads them, without spaces and in uppercase
+void normalize(const std::string_view expression, std::string& output) {
+    output.clear();
+    for (const char c : expression) {
+        if (c != ' ') output.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(c))));
+    }
+}
+
+void trigrams(const std::string_view normalized, std::vector<std::uint32_t>& keys) {
+    keys.clear();
+    for (std::size_t i = 0; i + 3 <= normalized.size(); ++i) {
+        keys.push_back(static_cast<std::uint32_t>(static_cast<unsigned char>(normalized[i])) << 16 |
+                       static_cast<std::uint32_t>(static_cast<unsigned char>(normalized[i + 1])) << 8 |
+                       static_cast<std::uint32_t>(static_cast<unsigned char>(normalized[i + 2])));
+    }
+    std::ranges::sort(keys);
+    const auto duplicates = std::ranges::unique(keys);
+    keys.erase(duplicates.begin(), duplicates.end());
+}
+
+[[nodiscard]] std::size_t hash_result(const std::string_view result) { return std::hash<std::string_view>{}(result); }
+
+}  // namespace
+
+std::size_t count_digits(const std::string_view result) {
+    const std::size_t sign = result.starts_with('-') ? 1 : 0;
+    const std::string_view prefix = result.substr(sign, 2);
+    // Only a result that isn't in decimal has letters for digits, a decimal one can have an E for its exponent
+    if (prefix == "0x" || prefix == "0o" || prefix == "0b") {
+        return static_cast<std::size_t>(std::ranges::count_if(result.substr(sign + 2), ::isxdigit));
+    }
+    return static_cast<std::size_t>(std::ranges::count_if(result, ::isdigit));
+}
+
+void shorten_result(std::string& result) {
+    if (result.size() <= max_result_length) return;
+    shorten_streamed_result(result, count_digits(result));
+}
+
+void shorten_streamed_result(std::string& result, const std::size_t digits) {
+    result.resize(std::min(result.size(), stored_prefix));
+    result += "... (";
+    result += std::to_string(digits);
+    result += " digits)";
+    result.shrink_to_fit();
+}
+
+Ring::Ring(const std::size_t max_entries) : m_max_entries(max_entries) {}
+
+void Ring::add(std::string expression, std::string result) {
+    if (m_max_entries == 0) return;
+    const std::uint64_t id = m_next_id++;
+    if (m_entries.size() < m_max_entries) {
+        m_entries.emplace_back(std::move(expression), std::move(result));
+    } else {
+        m_entries[id % m_max_entries] = Entry(std::move(expression), std::move(result));
+        ++m_first_id;
+        ++m_evicted;
+    }
+    if (m_indexed) {
+        std::string normalized;
+        std::vector<std::uint32_t> keys;
+        index(by_id(id), id, normalized, keys);
+    }
+    // Pruning is a pass over every posting, so it waits until a full ring's worth of entries has been evicted
+    if (m_evicted >= m_max_entries) {
+        if (m_indexed) prune();
+        m_evicted = 0;
+    }
+}
+
+void Ring::clear() {
+    m_entries.clear();
+    m_first_id = 0;
+    m_next_id = 0;
+    m_evicted = 0;
+    m_indexed = false;
+    m_trigrams.clear();
+    m_results.clear();
+}
+
+void Ring::index(const Entry& entry, const std::uint64_t id, std::string& normalized,
+                 std::vector<std::uint32_t>& keys) const {
+    normalize(entry.first, normalized);
+    trigrams(normalized, keys);
+    for (const std::uint32_t key : keys) m_trigrams[key].push_back(id);
+    m_results[hash_result(entry.second)].push_back(id);
+}
+
+void Ring::build_index() const {
+    if (m_indexed) return;
+    std::string normalized;
+    std::vector<std::uint32_t> keys;
+    for (std::uint64_t id = m_first_id; id < m_next_id; ++id) index(by_id(id), id, normalized, keys);
+    m_indexed = true;
+}
+
+// Ids only grow, so the evicted ones are always at the front of a posting list
+void Ring::prune() {
+    const auto prune_postings = [this](auto& postings) {
+        for (auto itr = postings.begin(); itr != postings.end();) {
+            auto& ids = itr->second;
+            ids.erase(ids.begin(), std::ranges::lower_bound(ids, m_first_id));
+            itr = ids.empty() ? postings.erase(itr) : std::next(itr);
+        }
+    };
+    prune_postings(m_trigrams);
+    prune_postings(m_results);
+}
+
+std::vector<std::size_t> Ring::search(const std::string_view pattern) const {
+    std::string normalized_pattern;
+    normalize(pattern, normalized_pattern);
+    std::vector<std::size_t> positions;
+    if (normalized_pattern.empty()) return positions;
+
+    std::string normalized;
+    const auto matches = [&](const std::uint64_t id) {
+        normalize(by_id(id).first, normalized);
+        return normalized.find(normalized_pattern) != std::string::npos;
+    };
+
+    // Patterns too short for a trigram are checked against every entry
+    if (normalized_pattern.size() < 3) {
+        for (std::uint64_t id = m_first_id; id < m_next_id; ++id) {
+            if (matches(id)) positions.push_back(id - m_first_id);
+        }
+        return positions;
+    }
+
+    build_index();
+    // Every match contains all of the pattern's trigrams, so the rarest one gives the fewest candidates to check
+    const Postings* candidates = nullptr;
+    std::size_t fewest = 0;
+    std::vector<std::uint32_t> keys;
+    trigrams(normalized_pattern, keys);
+    for (const std::uint32_t key : keys) {
+        const auto postings = m_trigrams.find(key);
+        if (postings == m_trigrams.end()) return positions;
+        const auto& ids = postings->second;
+        const auto live = static_cast<std::size_t>(ids.end() - std::ranges::lower_bound(ids, m_first_id));
+        if (!candidates || live < fewest) {
+            candidates = &ids;
+            fewest = live;
+        }
+    }
+    for (auto itr = std::ranges::lower_bound(*candidates, m_first_id); itr != candidates->end(); ++itr) {
+        if (matches(*itr)) positions.push_back(*itr - m_first_id);
+    }
+    return positions;
+}
+
+std::vector<std::size_t> Ring::find_result(const std::string_view value) const {
+    build_index();
+    std::vector<std::size_t> positions;
+    const auto postings = m_results.find(hash_result(value));
+    if (postings == m_results.end()) return positions;
+    const auto& ids = postings->second;
+    for (auto itr = std::ranges::lower_bound(ids, m_first_id); itr != ids.end(); ++itr) {
+        if (by_id(*itr).second == value) positions.push_back(*itr - m_first_id);
+    }
+    return positions;
+}
+
+}  // namespace History
@@ -0,0 +1,82 @@
+// Author: Caden LeCluyse
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace History {
+
+// Readline keeps its own copy of every line it can recall with the arrow keys, so it's only given the newest ones
+inline constexpr std::size_t recall_limit = 1000;
+
+using Entry = std::pair<std::string, std::string>; // Expression, result
+
+// Results longer than this are kept in the history and its file as their first stored_prefix digits and how
+// many digits there are. The whole value is still in ANS or the assigned variable, and a million digit result
+// isn't copied into the ring and written to the journal
+inline constexpr std::size_t max_result_length = 4096;
+inline constexpr std::size_t stored_prefix = 64;
+
+// How many digits a result has, past its sign and the 0x, 0o or 0b of a result that isn't in decimal
+[[nodiscard]] std::size_t count_digits(const std::string_view result);
+// Shortens the result to what the history keeps, in place, and frees the rest
+void shorten_result(std::string& result);
+// The same for a result that was printed as it was converted and never held whole, see CCalc::Context::set_sink.
+// result is its start, and digits how many it had
+void shorten_streamed_result(std::string& result, const std::size_t digits);
+
+// The program history, a ring of the newest max_entries entries. Adding an entry is O(1), the oldest one is
+// overwritten once the ring is full. Expressions are indexed by trigram and results by hash, so searching
+// doesn't scan the whole history. The index is built by the first search, so loading a long history stays fast
+class Ring {
+   public:
+    explicit Ring(std::size_t max_entries);
+
+    void add(std::string expression, std::string result);
+    void clear();
+
+    [[nodiscard]] std::size_t size() const noexcept { return m_entries.size(); }
+    [[nodiscard]] bool empty() const noexcept { return m_entries.empty(); }
+    [[nodiscard]] std::size_t max_entries() const noexcept { return m_max_entries; }
+    // 0 is the oldest entry
+    [[nodiscard]] const Entry& operator[](const std::size_t position) const {
+        return m_entries[(m_first_id + position) % m_max_entries];
+    }
+
+    // Positions of the entries whose expression contains the pattern, ignoring spaces and case, oldest first
+    [[nodiscard]] std::vector<std::size_t> search(std::string_view pattern) const;
+    // Positions of the entries whose result is exactly the value, oldest first
+    [[nodiscard]] std::vector<std::size_t> find_result(std::string_view value) const;
+
+   private:
+    using Postings = std::vector<std::uint64_t>; // Entry ids in the order they were added
+
+    // normalized and keys are scratch space, so indexing a whole history doesn't allocate for every entry
+    void index(const Entry& entry, std::uint64_t id, std::string& normalized, std::vector<std::uint32_t>& keys) const;
+    void build_index() const;
+    void prune();
+    [[nodiscard]] const Entry& by_id(const std::uint64_t id) const { return m_entries[id % m_max_entries]; }
+
+    const std::size_t m_max_entries;
+    std::vector<Entry> m_entries;
+    // Every entry gets the next id, the live ones are m_first_id up to m_next_id
+    std::uint64_t m_first_id = 0;
+    std::uint64_t m_next_id = 0;
+    // Evicted ids are left in the postings until enough of them pile up
+    std::size_t m_evicted = 0;
+    // Searching builds the index, it doesn't change the entries
+    mutable bool m_indexed = false;
+    mutable std::unordered_map<std::uint32_t, Postings> m_trigrams;
+    mutable std::unordered_map<std::size_t, Postings> m_results;
+};
+
+}  // namespace History
+
+#endif
@@ -20,41 +20,31 @@ namespace Error {
 // Declare helper functions in an anonymous namespace
 namespace {
 
+// The boundary checks look at the first and last tokens the lexer produced
 [[nodiscard]] inline
-constexpr std::optional<std::string> check_leading(const std::string_view infix_expression, const bool math) {
-    if (infix_expression.size() == 1) {
-        return std::optional<std::string>("Expression is only one character long");
-    }
-    if (math && is_math_operator(static_cast<Token>(infix_expression[0])) && infix_expression[0] != '-') {
+constexpr std::optional<std::string> check_leading(const Token first, const bool math) {
+    if (math && is_math_operator(first) && first != Token::SUB) {
         return std::optional<std::string>("Math expression begins with an operator");
     }
-    if (!math && is_bool_operator(static_cast<Token>(infix_expression[0]))) {
+    if (!math && is_bool_operator(first)) {
         return std::optional<std::string>("Boolean expression begins with an operator");
     }
-    if (infix_expression[0] == ')') {
+    if (first == Token::RIGHT_PAREN) {
         return std::optional<std::string>("Expression begins with closed parentheses");
-    } else if (infix_expression[0] == '!' && math) {
-        return std::optional<std::string>("Expression begins with factorial");
-    }
-    for (const auto i : infix_expression) {
-        if (!math && std::isdigit(i)) {
-            return std::optional<std::string>("Boolean expression contains a number");
-        }
     }
 
     return std::nullopt;
 }
 
 [[nodiscard]] inline
-constexpr std::optional<std::string> check_trailing(const std::string_view infix_expression, const bool math) {
-    const Token rbegin = static_cast<Token>(*infix_expression.rbegin());
-    if (isnot(rbegin) && !math) {
+constexpr std::optional<std::string> check_trailing(const Token last, const bool math) {
+    if (isnot(last) && !math) {
         return std::optional<std::string>("Expression ends with NOT");
-    } else if (math && is_math_operator(rbegin) && rbegin != Token::FAC) {
+    } else if (math && is_math_operator(last) && last != Token::FAC) {
         return std::optional<std::string>("Math expression ends with an operator");
-    } else if (!math && is_bool_operator(rbegin)) {
+    } else if (!math && is_bool_operator(last)) {
         return std::optional<std::string>("Boolean expression ends with an operator");
-    } else if (rbegin == Token::LEFT_PAREN) {
+    } else if (last == Token::LEFT_PAREN) {
         return std::optional<std::string>("Expression ends with open parentheses");
     }
 
@@ -92,7 +82,8 @@ constexpr std::optional<std::string> check_consecutive_operands(const Token curr
 
 [[nodiscard]] inline
 constexpr std::optional<std::string> check_not_after_value(const Token current_token, const Token previous_token) {
-    if (isnot(current_token) && (isoperator(previous_token) || previous_token == Token::RIGHT_PAREN)) {
+    if (isnot(current_token) && ((isoperator(previous_token) && !isnot(previous_token)) ||
+                                 previous_token == Token::RIGHT_PAREN)) {
         return std::optional<std::string>("NOT applied after value");
     }
 
@@ -145,6 +136,7 @@ static inline constexpr std::initializer_list<Token> invalid_tokens = {
 static inline constexpr
 std::array<std::pair<Token, std::initializer_list<Token> >, 7 > invalid_math_operator_sequences {
     std::make_pair(Token::ADD, invalid_tokens_no_add_sub),
+    std::make_pair(Token::UNARY, invalid_tokens_no_add_sub),
     std::make_pair(Token::SUB, invalid_tokens_no_add_sub),
     std::make_pair(Token::MULT, invalid_tokens),
     std::make_pair(Token::DIV, invalid_tokens),
@@ -181,9 +173,9 @@ constexpr std::optional<std::string> check_missing_operand_bool(const Token curr
 
 [[nodiscard]] inline
 constexpr std::optional<std::string> check_for_factorial_error(const Token current_token, const Token previous_token) {
-    if (current_token == Token::FAC && std::isdigit(static_cast<char>(previous_token))) {
+    if (current_token == Token::FAC && is_number(previous_token)) {
         return std::optional<std::string>("Digit following factorial");
-    } else if(!std::isdigit(static_cast<char>(current_token)) && current_token != Token::RIGHT_PAREN &&
+    } else if(!is_number(current_token) && current_token != Token::RIGHT_PAREN &&
                current_token != Token::FAC && previous_token == Token::FAC) {
         return std::optional<std::string>("Factorial follows a non-number value");
     } else if(current_token == Token::FAC && previous_token == Token::FAC) {
@@ -196,11 +188,11 @@ constexpr std::optional<std::string> check_for_factorial_error(const Token curre
 }  // namespace
 
 [[nodiscard]] inline
-constexpr std::optional<std::string> initial_checks(const std::string_view infix_expression, const bool math) {
-    const auto leading = check_leading(infix_expression, math);
+constexpr std::optional<std::string> initial_checks(const Token first, const Token last, const bool math) {
+    const auto leading = check_leading(first, math);
     if (leading) return leading;
     
-    const auto trailing = check_trailing(infix_expression, math);
+    const auto trailing = check_trailing(last, math);
     if (trailing) return trailing;
 
     return std::nullopt;
@@ -210,7 +202,7 @@ constexpr std::optional<std::string> initial_checks(const std::string_view infix
 constexpr std::optional<std::string> variable_error(const Token previous_token) {
     if (previous_token == Token::DOT) {
         return std::optional<std::string>("Decimal point detected after variable");
-    } else if (std::isdigit(static_cast<char>(previous_token))) {
+    } else if (is_number(previous_token)) {
         return std::optional<std::string>("Digit detected after variable");
     }
 
@@ -0,0 +1,78 @@
+// Author: Caden LeCluyse
+
+#ifndef TIMING_HPP
+#define TIMING_HPP
+
+#include <chrono>
+#include <ctime>
+
+#include "perf/counters.h"
+
+namespace Timing {
+
+// Time spent in one phase, in seconds. cpu only counts the time the thread was running, and stays 0 if the
+// stopwatch wasn't reading the CPU clock. counts stays 0 unless it was reading hardware counters
+struct Phase {
+    double wall = 0;
+    double cpu = 0;
+    Perf::Counts counts;
+
+    Phase& operator+=(const Phase& other) noexcept {
+        wall += other.wall;
+        cpu += other.cpu;
+        counts += other.counts;
+        return *this;
+    }
+    Phase& operator-=(const Phase& other) noexcept {
+        wall -= other.wall;
+        cpu -= other.cpu;
+        counts -= other.counts;
+        return *this;
+    }
+};
+
+// Each lap ends the current phase and starts the next, so back to back phases share their clock reads.
+// A stopwatch that isn't running reads no clocks, so callers that only sometimes time can always have one.
+// The wall clock is read without entering the kernel, but the thread's CPU clock and the counters are
+// system calls. The counters are read before the clocks, so they don't count the clock reads
+class Stopwatch {
+   public:
+    explicit Stopwatch(const bool running, const bool cpu = true,
+                       const Perf::Counters* const counters = nullptr) noexcept
+        : m_read_cpu(running && cpu), m_counters(running ? counters : nullptr) {
+        if (m_counters) m_counts = m_counters->read();
+        if (running) m_wall = Clock::now();
+        if (m_read_cpu) m_cpu = cpu_now();
+    }
+
+    [[nodiscard]] Phase lap() noexcept {
+        const Perf::Counts counts = m_counters ? m_counters->read() : Perf::Counts{};
+        const Clock::time_point wall = Clock::now();
+        const double cpu = m_read_cpu ? cpu_now() : 0;
+        Phase phase{std::chrono::duration<double>(wall - m_wall).count(), cpu - m_cpu, counts};
+        phase.counts -= m_counts;
+        m_wall = wall;
+        m_cpu = cpu;
+        m_counts = counts;
+        return phase;
+    }
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    [[nodiscard]] static double cpu_now() noexcept {
+        timespec now{};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+        return static_cast<double>(now.tv_sec) + static_cast<double>(now.tv_nsec) * 1e-9;
+    }
+
+    const bool m_read_cpu;
+    const Perf::Counters* const m_counters;
+    Clock::time_point m_wall;
+    double m_cpu = 0;
+    Perf::Counts m_counts;
+};
+
+}  // namespace Timing
+
+#endif
@@ -4,6 +4,7 @@
 #define TYPES_HPP
 
 #include <cctype>
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -15,6 +16,7 @@ inline constexpr std::string_view euler =
 
 inline constexpr std::string_view history_file_name = ".local/share/.ccalc_history";
 inline constexpr std::string_view vars_filename = ".local/share/.ccalc_vars";
+inline constexpr std::string_view state_filename = ".local/share/.ccalc_state";
 
 enum struct Token : char {
     NULLCHAR = '\0',
@@ -55,79 +57,48 @@ enum struct Token : char {
     NAND = '@',
     NOR = '$',
     TRUE = 'T',
-    FALSE = 'F'
+    FALSE = 'F',
+    VAR = '#', // Variable, the offset of its TypedToken is the index for boolean ones and the name for math ones
+    NUMBER = 'D', // Numeric literal, the digits are in ParseResult::literals
+    IDENT = 'V' // Identifier that hasn't been resolved yet, the name is in ParseResult::literals
 };
 
-inline constexpr bool is_valid_math_token(const char c) {
-    switch (c) {
-        case '\0':
-        case '+':
-        case '-':
-        case '*':
-        case '/':
-        case '^':
-        case '~':
-        case '!':
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-        case '6':
-        case '7':
-        case '8':
-        case '9':
-        case '0':
-        case '(':
-        case ')':
-        case '.':
-        case ',':
-        case '%':
-        case '=':
-        case 'S':
-        case 'C':
-        case 'G':
-        case 'L':
-        case 'N':
-        case 'E':
-        case 'P':
-        case 'I':
-        case 'A':
-            return true;
-        default:
-            return false;
-    }
-}
-
-inline constexpr bool is_valid_bool_token(const char c) {
-    switch (c) {
-        case '!':
-        case '&':
-        case '|':
-        case '^':
-        case '@':
-        case '$':
-        case 'T':
-        case 'F':
-            return true;
-        default:
-            return false;
-    }
-}
+// One token of a parsed expression. Numbers and identifiers refer to their text in ParseResult::literals,
+// where each one is null terminated so it can go straight to GMP or MPFR. Variables are identified by their offset
+struct TypedToken {
+    Token kind = Token::NULLCHAR;
+    std::uint32_t offset = 0;
+    std::uint32_t length = 0;
+};
 
 struct ParseResult {
-    std::vector<Types::Token> result;
+    std::vector<TypedToken> result; // Postfix order
+    std::string literals;
+    std::vector<std::string> variables; // Only filled in for symbolic boolean expressions
     std::string error_msg;
     bool success = false;
     bool is_math = false;
     bool is_floating_point = false;
 };
 
+// What a math tree needs to know when its nodes are built. Passed in rather than read from the settings,
+// so trees with different settings can be built at the same time
+struct MathSettings {
+    long precision = 320; // In bits
+    bool degrees = false;
+    unsigned threads = 1; // How many threads one evaluation can use, 0 is one per core
+};
+
 enum struct Setting {
     PRECISION,
     DISPLAY_PREC,
     MAX_HISTORY,
     ANGLE,
+    SAVE_ONESHOT,
+    MAX_MEMORY,
+    TIMEOUT,
+    THREADS,
+    BASE,
     INVALID
 };
 
@@ -136,6 +107,11 @@ enum struct Setting {
     if (string == "display_digits") return Setting::DISPLAY_PREC;
     if (string == "max_history") return Setting::MAX_HISTORY;
     if (string == "angle") return Setting::ANGLE;
+    if (string == "save_oneshot") return Setting::SAVE_ONESHOT;
+    if (string == "max_memory") return Setting::MAX_MEMORY;
+    if (string == "timeout") return Setting::TIMEOUT;
+    if (string == "threads") return Setting::THREADS;
+    if (string == "base") return Setting::BASE;
     return Setting::INVALID;
 }
 
@@ -150,17 +126,6 @@ enum struct Setting {
     }
 }
 
-[[nodiscard]] inline constexpr bool is_trig(const char token) noexcept {
-    switch (token) {
-        case 'S':
-        case 'C':
-        case 'T': 
-            return true;
-        default:
-            return false;
-    }
-}
-
 [[nodiscard]] inline constexpr bool is_trig(const Token token) noexcept {
     switch (token) {
         case Token::SIN:
@@ -172,9 +137,12 @@ enum struct Setting {
     }
 }
 
+[[nodiscard]] inline constexpr bool is_number(const Token token) noexcept {
+    return token == Token::NUMBER || std::isdigit(static_cast<char>(token));
+}
+
 [[nodiscard]] inline constexpr bool is_math_operand(const Token token) noexcept {
-    return std::isdigit(static_cast<char>(token)) || token == Token::DOT ||
-           is_math_var(token);
+    return is_number(token) || token == Token::DOT || is_math_var(token);
 }
 
 [[nodiscard]] inline constexpr bool is_bool_operand(const Token token) noexcept {
@@ -1,62 +1,21 @@
 #ifndef UTIL_HPP
 #define UTIL_HPP
 
-#include <algorithm>
 #include <iostream>
 #include <limits>
-#include <mpfr.h>
 #include <optional>
 #include <readline/history.h>
 #include <string>
 
-#include "include/types.hpp"
 #include "ui/ui.h"
 
 namespace Util {
 
-inline constexpr std::size_t buffer_size = 128;
-
 inline void clear_input_stream() {
     std::cin.clear();
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 }
 
-// Remove the trailing zeros from a MPFR float in string form
-inline void trim_trailing_zero_mpfr(std::string& buffer) {
-    // If there is no decimal, return early
-    const auto find_decimal = std::ranges::find_if(buffer, [](const char c) {
-        return c == '.';
-    });
-    if (find_decimal == buffer.end()) return;
-
-    const auto last_non_zero = std::ranges::find_if(buffer.rbegin(), buffer.rend(), [](const char c) {
-        return c != '0' && c != '.';
-    });
-
-    if (last_non_zero != buffer.rend()) {
-        buffer.erase(last_non_zero.base(), buffer.end());
-    } else {
-        buffer.erase(find_decimal, buffer.end());
-    }
-    if (buffer.size() == 1 && buffer[0] == '-') buffer[0] = '0'; // Handle negative 0 case
-}
-
-// Convert an MPFR to a string 
-[[nodiscard]]
-inline bool convert_mpfr_string(std::string& out, const mpfr_t& val, const mpfr_prec_t display_precision) {
-    // If the float is an integer, don't worry about the precision
-    const int snprintf_result = mpfr_integer_p(val) ? mpfr_snprintf(out.data(), buffer_size, "%.0Rf", val)
-                                                    : mpfr_snprintf(out.data(), buffer_size, "%.*Rf", display_precision, val);
-    if (snprintf_result < 0) [[unlikely]] {
-        UI::print_error("mpfr_snprintf failure");
-        return false;
-    } else if (static_cast<std::size_t>(snprintf_result) >= buffer_size) {
-        UI::print_error("buffer too small for mpfr_snprintf, output may be truncated.\n");
-    }
-    trim_trailing_zero_mpfr(out);
-    return true; 
-}
-
 // This function grabs the filename the user wants to print to
 // write indicates if we are reading or writing
 [[nodiscard]] inline std::optional<std::string> get_filename(const bool write) {
@@ -95,35 +54,6 @@ inline bool convert_mpfr_string(std::string& out, const mpfr_t& val, const mpfr_
     return std::optional<std::string>(filename);
 }
 
-[[nodiscard]]
-constexpr bool pow_search(const std::string_view& infix_expression, auto current_itr) noexcept {
-    for (; current_itr != infix_expression.end(); ++current_itr) {
-        if (*current_itr == '(') continue;
-        if (*current_itr == 'F') return false;
-        else if (*current_itr == 'T') {
-            const std::string_view get_tan = infix_expression.substr(static_cast<std::size_t>(std::distance(infix_expression.begin(),
-                                                                                              current_itr)), 3);
-            if (get_tan == "TAN") return true;
-            return false;
-        }
-    }
-    
-    return true;
-}
-
-[[nodiscard]]
-constexpr bool contains_bool_op(const std::string_view& infix_expression) noexcept {
-    for (auto itr = infix_expression.begin(); itr != infix_expression.end(); ++itr) {
-        if (is_bool_operator(static_cast<Types::Token>(*itr))) {
-            if (*itr == '^' && !pow_search(infix_expression, itr)) {
-                return true;
-            } else if (*itr == '^') return false;
-            return true;
-        }
-    }
-
-    return false;
-}
 inline void free_history_entry(HIST_ENTRY*& entry) {
     if (entry->line) free(entry->line);
     if (entry->timestamp) free(entry->timestamp);
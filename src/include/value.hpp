@@ -0,0 +1,68 @@
+// Author: Caden LeCluyse
+
+#ifndef VALUE_HPP
+#define VALUE_HPP
+
+#include <gmpxx.h>
+#include <mpfr.h>
+#include <unordered_map>
+#include <utility>
+
+namespace Types {
+
+// A result kept at the precision it was computed with, so variables and ANS can be used again without being
+// rounded to display_digits and parsed a second time. Floating point values keep their own MPFR precision
+class Value {
+   public:
+    explicit Value(const mpz_class& integer) : m_integer(integer) {}
+    explicit Value(mpz_class&& integer) noexcept : m_integer(std::move(integer)) {}
+    explicit Value(mpfr_srcptr floating_point) : m_is_floating_point(true) {
+        mpfr_init2(m_floating_point, mpfr_get_prec(floating_point));
+        mpfr_set(m_floating_point, floating_point, MPFR_RNDN);
+    }
+
+    Value(const Value& other) : m_integer(other.m_integer), m_is_floating_point(other.m_is_floating_point) {
+        if (!m_is_floating_point) return;
+        mpfr_init2(m_floating_point, mpfr_get_prec(other.m_floating_point));
+        mpfr_set(m_floating_point, other.m_floating_point, MPFR_RNDN);
+    }
+
+    // The MPFR limbs change owner, so the moved from value must not clear them
+    Value(Value&& other) noexcept
+        : m_integer(std::move(other.m_integer)), m_is_floating_point(other.m_is_floating_point) {
+        if (!m_is_floating_point) return;
+        *m_floating_point = *other.m_floating_point;
+        other.m_is_floating_point = false;
+    }
+
+    Value& operator=(Value other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~Value() {
+        if (m_is_floating_point) mpfr_clear(m_floating_point);
+    }
+
+    void swap(Value& other) noexcept {
+        m_integer.swap(other.m_integer);
+        std::swap(*m_floating_point, *other.m_floating_point);
+        std::swap(m_is_floating_point, other.m_is_floating_point);
+    }
+
+    [[nodiscard]] bool is_floating_point() const noexcept { return m_is_floating_point; }
+    [[nodiscard]] const mpz_class& integer() const noexcept { return m_integer; }
+    [[nodiscard]] mpfr_srcptr floating_point() const noexcept { return m_floating_point; }
+
+   private:
+    mpz_class m_integer;
+    mpfr_t m_floating_point{};
+    bool m_is_floating_point = false;
+};
+
+// ANS is stored under '\0'
+using VarMap = std::unordered_map<char, Value>;
+
+}  // namespace Types
+
+#endif
@@ -0,0 +1,84 @@
+// Author: Caden LeCluyse
+
+#include "interrupt/interrupt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace Interrupt {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// About 25us of cheap nodes between clock reads, reading it after each one would add a third to their cost
+inline constexpr unsigned clock_check_interval = 256;
+
+struct ThreadLimits {
+    Clock::time_point deadline = Clock::time_point::max();
+    const Flag* flag = nullptr;
+    unsigned until_clock_check = clock_check_interval;
+};
+
+thread_local ThreadLimits limits;
+
+void check_limits(const ThreadLimits& state) {
+    if (state.flag && state.flag->load(std::memory_order_relaxed)) {
+        throw std::runtime_error("Expression was interrupted");
+    }
+    if (state.deadline != Clock::time_point::max() && Clock::now() >= state.deadline) {
+        throw std::runtime_error("Expression exceeds time limit");
+    }
+}
+
+}  // namespace
+
+Scope::Scope(const std::chrono::milliseconds timeout, const Flag* const flag) noexcept {
+    ThreadLimits& state = limits;
+    m_previous_deadline = state.deadline;
+    m_previous_flag = state.flag;
+    if (timeout.count() > 0) {
+        const Clock::time_point now = Clock::now();
+        // A timeout too long to add to the clock is as good as none
+        if (timeout < std::chrono::duration_cast<std::chrono::milliseconds>(Clock::time_point::max() - now)) {
+            state.deadline = std::min(state.deadline, now + timeout);
+        }
+    }
+    if (flag) state.flag = flag;
+    state.until_clock_check = clock_check_interval;
+}
+
+Scope::Scope(const Limits& outer) noexcept {
+    ThreadLimits& state = limits;
+    m_previous_deadline = state.deadline;
+    m_previous_flag = state.flag;
+    state.deadline = std::min(state.deadline, outer.deadline);
+    if (outer.flag) state.flag = outer.flag;
+    state.until_clock_check = clock_check_interval;
+}
+
+Scope::~Scope() {
+    ThreadLimits& state = limits;
+    state.deadline = m_previous_deadline;
+    state.flag = m_previous_flag;
+}
+
+Limits current() noexcept {
+    const ThreadLimits& state = limits;
+    return Limits{state.deadline, state.flag};
+}
+
+void check() {
+    ThreadLimits& state = limits;
+    if (state.flag && state.flag->load(std::memory_order_relaxed)) [[unlikely]] {
+        throw std::runtime_error("Expression was interrupted");
+    }
+    if (--state.until_clock_check != 0) [[likely]] return;
+    state.until_clock_check = clock_check_interval;
+    check_limits(state);
+}
+
+void check_now() { check_limits(limits); }
+
+}  // namespace Interrupt
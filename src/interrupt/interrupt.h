@@ -0,0 +1,53 @@
+// Author: Caden LeCluyse
+
+#ifndef INTERRUPT_H
+#define INTERRUPT_H
+
+#include <atomic>
+#include <chrono>
+
+// Stopping an evaluation part way through, when it runs past its time limit or is cancelled from outside.
+// Evaluation checks between operations, and the kernels that can run for a long time are split into steps
+// with a check between each. A single GMP or MPFR call can't be stopped, so the wait is at most one step
+namespace Interrupt {
+
+// Setting it stops the evaluations watching it at their next check. std::atomic<bool> is always lock free,
+// so it can be set from another thread or from a signal handler
+using Flag = std::atomic<bool>;
+static_assert(Flag::is_always_lock_free);
+
+// The deadline and flag this thread is checked against, so work handed to another thread can be held to them
+struct Limits {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    const Flag* flag = nullptr;
+};
+
+[[nodiscard]] Limits current() noexcept;
+
+// While it's alive, checks on this thread throw once the timeout has passed or the flag is set. A timeout of 0
+// is no limit, and without a flag only the timeout is checked. A scope inside another keeps the earlier deadline,
+// and its flag replaces the outer one if it has one
+class Scope {
+   public:
+    Scope(std::chrono::milliseconds timeout, const Flag* flag) noexcept;
+    // The limits of another thread, taken with current
+    explicit Scope(const Limits& limits) noexcept;
+    // The limits that were in place before this one are put back
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    std::chrono::steady_clock::time_point m_previous_deadline;
+    const Flag* m_previous_flag;
+};
+
+// Throws std::runtime_error if the evaluation on this thread should stop. Cheap enough to call after every node,
+// the clock is only read every few hundred calls
+void check();
+// Always reads the clock. For the steps of long kernels, where each step takes far longer than the clock read
+void check_now();
+
+}  // namespace Interrupt
+
+#endif
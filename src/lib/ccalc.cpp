@@ -0,0 +1,686 @@
+// Author: Caden LeCluyse
+
+#include "lib/ccalc.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <gmpxx.h>
+#include <memory>
+#include <mpfr.h>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ast/ast.h"
+#include "include/timing.hpp"
+#include "include/types.hpp"
+#include "include/value.hpp"
+#include "interrupt/interrupt.h"
+#include "memory/memory.h"
+#include "parallel/pool.h"
+#include "parser/lexer.h"
+#include "parser/parser.h"
+
+using namespace Types;
+
+namespace CCalc {
+
+namespace {
+
+inline constexpr std::size_t initial_buffer_size = 128;
+inline constexpr double log10_2 = 0.30102999566398120;
+// Below this many digits mpz_get_str, which is subquadratic already, is faster than splitting the integer up.
+// Past it the conversion can take longer than computing the number, so it's split between threads
+inline constexpr std::size_t split_conversion_digits = 1'000'000;
+inline constexpr std::size_t min_leaf_digits = 100'000;
+// Threads that finish early can take another leaf
+inline constexpr std::size_t leaves_per_thread = 4;
+// Streamed decimal results are converted this many digits at a time for each thread. Smaller pieces would hold
+// less text at once, but each halving is another pass of divisions over the whole number
+inline constexpr std::size_t stream_piece_digits = 4'000'000;
+
+void copy_counts(const NodeCounts& counts, Stats& stats) {
+    stats.values = counts.values;
+    stats.variables = counts.variables;
+    stats.operations = counts.operations;
+    stats.trig = counts.trig;
+    stats.factorials = counts.factorials;
+    stats.negations = counts.negations;
+}
+
+// Remove the trailing zeros from a MPFR float in string form. Only the ones after the decimal point, a value
+// that rounds up to 100.000 keeps the zeros before it
+void trim_trailing_zero_mpfr(std::string& buffer) {
+    // If there is no decimal, return early
+    const std::size_t decimal = buffer.find('.');
+    if (decimal == std::string::npos) return;
+
+    std::size_t last_kept = buffer.find_last_not_of('0');
+    if (last_kept == decimal) --last_kept;
+    buffer.erase(last_kept + 1);
+    if (buffer == "-0") buffer = "0"; // Handle negative 0 case
+}
+
+// Room for everything snprintf prints, so a big value is converted once instead of being printed again into a
+// bigger buffer. The integer part of a regular value has at most exponent * log10(2) + 1 digits
+[[nodiscard]] std::size_t formatted_length(mpfr_srcptr value, const bool integer, const long display_digits) {
+    std::size_t length = 3; // Sign, a leading 0, and the terminator
+    if (mpfr_regular_p(value) && mpfr_get_exp(value) > 0) {
+        length += static_cast<std::size_t>(static_cast<double>(mpfr_get_exp(value)) * log10_2) + 1;
+    }
+    if (!integer) length += static_cast<std::size_t>(display_digits) + 1;
+    return std::max(length, initial_buffer_size);
+}
+
+[[nodiscard]]
+constexpr bool pow_search(const std::string_view& infix_expression, auto current_itr) noexcept {
+    for (; current_itr != infix_expression.end(); ++current_itr) {
+        if (*current_itr == '(') continue;
+        if (*current_itr == 'F') return false;
+        else if (*current_itr == 'T') {
+            const std::string_view get_tan = infix_expression.substr(static_cast<std::size_t>(std::distance(infix_expression.begin(),
+                                                                                              current_itr)), 3);
+            if (get_tan == "TAN") return true;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+[[nodiscard]]
+constexpr bool contains_bool_op(const std::string_view& infix_expression) noexcept {
+    for (auto itr = infix_expression.begin(); itr != infix_expression.end(); ++itr) {
+        if (is_bool_operator(static_cast<Token>(*itr))) {
+            if (*itr == '^' && !pow_search(infix_expression, itr)) {
+                return true;
+            } else if (*itr == '^') return false;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+[[nodiscard]] constexpr std::optional<std::string> check_var_assign_error(const std::string_view expression,
+                                                                          const char target) {
+    if (expression.empty()) {
+        return std::optional<std::string>("Empty input received");
+    } else if (target == 'E') {
+        return std::optional<std::string>("e is reserved for euler");
+    } else if (std::isdigit(target)) {
+        return std::optional<std::string>("You can't assign a number to another number");
+    } else if (contains_bool_op(expression)) {
+        return std::optional<std::string>("Variables are for math expressions only");
+    }
+    return std::nullopt;
+}
+
+// Strips a trailing @HEX/@OCT/@BIN/@DEC and returns its base, 0 if there is none
+[[nodiscard]] unsigned take_base_suffix(std::string& input) {
+    static constexpr std::array<std::pair<std::string_view, unsigned>, 4> suffixes = {
+        {{"@HEX", 16}, {"@OCT", 8}, {"@BIN", 2}, {"@DEC", 10}}};
+    for (const auto& [suffix, base] : suffixes) {
+        if (input.ends_with(suffix)) {
+            input.resize(input.size() - suffix.size());
+            return base;
+        }
+    }
+    return 0;
+}
+
+// Copies the expression without spaces and in uppercase, and splits off an assignment and a base suffix.
+// Sets base to the suffix's base, 0 if there isn't one. Returns the assigned variable, or '\0' if there isn't one
+char normalize_expression(const std::string_view expression, std::string& output, unsigned& base) {
+    output.clear();
+    for (const char c : expression) {
+        if (c != ' ') output.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(c))));
+    }
+    base = take_base_suffix(output);
+    const char target = output.size() > 1 && output[1] == '=' ? output[0] : '\0';
+    if (target != '\0') output.erase(0, 2);
+    return target;
+}
+
+}  // namespace
+
+VariableUse variable_use(const std::string_view expression) {
+    static const VarMap no_vars;
+    std::string input;
+    unsigned base;
+    VariableUse use;
+    use.target = normalize_expression(expression, input, base);
+
+    std::vector<TypedToken> tokens;
+    std::string literals;
+    Lexer::LexSummary summary;
+    Lexer::lex(input, false, no_vars, tokens, literals, summary);
+    for (const auto& token : tokens) {
+        if (token.kind == Token::ANS) use.reads.push_back('\0');
+        if (token.kind == Token::IDENT) use.reads.push_back(literals[token.offset]);
+    }
+    return use;
+}
+
+std::string format_mpfr(mpfr_srcptr value, const long display_digits) {
+    // If the float is an integer, don't worry about the precision
+    const bool integer = mpfr_integer_p(value);
+    std::string buffer(formatted_length(value, integer, display_digits), '\0');
+    const auto print = [value, display_digits, integer, &buffer]() {
+        return integer ? mpfr_snprintf(buffer.data(), buffer.size(), "%.0Rf", value)
+                       : mpfr_snprintf(buffer.data(), buffer.size(), "%.*Rf", static_cast<int>(display_digits), value);
+    };
+
+    const int length = print();
+    if (length < 0) [[unlikely]] throw std::runtime_error("mpfr_snprintf failure");
+    // Only if the estimate was short, snprintf tells us how much room it needs
+    if (static_cast<std::size_t>(length) >= buffer.size()) [[unlikely]] {
+        buffer.resize(static_cast<std::size_t>(length) + 1);
+        print();
+    }
+    buffer.resize(static_cast<std::size_t>(length));
+    trim_trailing_zero_mpfr(buffer);
+    return buffer;
+}
+
+namespace {
+
+// mpz_sizeinbase can be one more than the number of digits, and there's room for a sign and the terminator
+[[nodiscard]] std::string convert_integer(const mpz_class& value) {
+    std::string buffer(mpz_sizeinbase(value.get_mpz_t(), 10) + 2, '\0');
+    mpz_get_str(buffer.data(), 10, value.get_mpz_t());
+    buffer.resize(std::strlen(buffer.data()));
+    return buffer;
+}
+
+// mpz_sizeinbase is exact for powers of 2. GMP writes the sign itself, so the digits go after where the prefix
+// ends up and the sign is moved in front of it
+[[nodiscard]] std::string convert_integer_power_of_two(const mpz_class& value, const unsigned base) {
+    const char prefix = base == 16 ? 'x' : base == 8 ? 'o' : 'b';
+    const bool negative = value < 0;
+    std::string buffer(mpz_sizeinbase(value.get_mpz_t(), static_cast<int>(base)) + 4, '\0');
+    mpz_get_str(buffer.data() + 2, static_cast<int>(base), value.get_mpz_t());
+    buffer.resize(std::strlen(buffer.data() + 2) + 2);
+    if (negative) buffer[0] = '-';
+    buffer[negative ? 1 : 0] = '0';
+    buffer[negative ? 2 : 1] = prefix;
+    return buffer;
+}
+
+// Divides the integer by 10^(leaf_digits * 2^j), from the largest power down, into 2^levels leaves of leaf_digits
+// digits each, most significant first. Both halves of every division are independent, so each level divides all
+// of its pieces at once on the pool, and then the leaves are converted at once into their place in the result.
+// The value has at most digits digits
+[[nodiscard]] std::string convert_integer_split(const mpz_class& value, const std::size_t digits,
+                                                const unsigned threads) {
+    unsigned levels = 0;
+    while ((std::size_t{1} << levels) < threads * leaves_per_thread && (digits >> (levels + 1)) >= min_leaf_digits) {
+        ++levels;
+    }
+    const std::size_t num_leaves = std::size_t{1} << levels;
+    const std::size_t leaf_digits = (digits + num_leaves - 1) / num_leaves;
+
+    // powers[j] is 10^(leaf_digits * 2^j), each the square of the one before
+    std::vector<mpz_class> powers(levels);
+    mpz_ui_pow_ui(powers[0].get_mpz_t(), 10, leaf_digits);
+    for (unsigned j = 1; j < levels; ++j) {
+        powers[j] = powers[j - 1] * powers[j - 1];
+        Interrupt::check_now();
+    }
+
+    std::vector<mpz_class> pieces(1);
+    mpz_abs(pieces[0].get_mpz_t(), value.get_mpz_t());
+    for (unsigned level = levels; level-- > 0;) {
+        std::vector<mpz_class> halves(pieces.size() * 2);
+        Parallel::run(pieces.size(), threads, [&pieces, &halves, &powers, level](const std::size_t i) {
+            mpz_tdiv_qr(halves[2 * i].get_mpz_t(), halves[2 * i + 1].get_mpz_t(), pieces[i].get_mpz_t(),
+                        powers[level].get_mpz_t());
+            Interrupt::check_now();
+        });
+        pieces = std::move(halves);
+    }
+
+    // The digits estimate can be high, so the leading leaves can be 0. The first one that isn't sets the length,
+    // and every leaf after it is padded to leaf_digits with zeros
+    const auto first = static_cast<std::size_t>(std::ranges::find_if(pieces, [](const mpz_class& piece) {
+                                                     return piece != 0;
+                                                 }) - pieces.begin());
+    std::string buffer = value < 0 ? "-" : "";
+    buffer += convert_integer(pieces[first]);
+    const std::size_t head = buffer.size();
+    buffer.resize(head + (num_leaves - first - 1) * leaf_digits, '0');
+    Parallel::run(num_leaves - first - 1, threads, [&pieces, &buffer, first, head, leaf_digits](const std::size_t i) {
+        const std::string leaf = convert_integer(pieces[first + 1 + i]);
+        std::memcpy(buffer.data() + head + (i + 1) * leaf_digits - leaf.size(), leaf.data(), leaf.size());
+        Interrupt::check_now();
+    });
+    return buffer;
+}
+
+}  // namespace
+
+std::string format_integer(const mpz_class& value, unsigned threads, const unsigned base) {
+    if (base != 10) return convert_integer_power_of_two(value, base);
+    if (threads == 0) threads = Parallel::hardware_threads();
+    const std::size_t digits = mpz_sizeinbase(value.get_mpz_t(), 10);
+    if (threads <= 1 || digits < split_conversion_digits) return convert_integer(value);
+    return convert_integer_split(value, digits, threads);
+}
+
+namespace {
+
+// A float that holds an integer, like 2.0^64, can be printed in any base exactly
+[[nodiscard]] std::string format_floating_point(mpfr_srcptr value, const long display_digits, const unsigned base) {
+    if (base == 10 || !mpfr_integer_p(value)) return format_mpfr(value, display_digits);
+    mpz_class integer;
+    mpfr_get_z(integer.get_mpz_t(), value, MPFR_RNDN);
+    return format_integer(integer, 1, base);
+}
+
+// Passes a streamed result on to the sink, and keeps its start and how many digits it had in the result
+class Stream {
+   public:
+    Stream(const Sink& sink, Result& result) : m_sink(sink), m_result(result) {
+        m_result = Result{true, "", true, 0};
+    }
+
+    void write(const std::string_view piece) {
+        if (m_result.text.size() < streamed_prefix) {
+            m_result.text += piece.substr(0, streamed_prefix - m_result.text.size());
+        }
+        if (m_sink) m_sink(piece);
+    }
+
+    // count is more than the piece when the digits after it were only counted
+    void digits(const std::string_view piece, const std::size_t count) {
+        m_result.digits += count;
+        write(piece);
+    }
+    void digits(const std::string_view piece) { digits(piece, piece.size()); }
+
+    void zeros(std::size_t count) {
+        static const std::string run(std::size_t{1} << 16, '0');
+        while (count > 0) {
+            const std::size_t length = std::min(count, run.size());
+            digits(std::string_view(run).substr(0, length));
+            count -= length;
+        }
+    }
+
+   private:
+    const Sink& m_sink;
+    Result& m_result;
+};
+
+// Splits the integer by 10^(piece_digits * 2^j), largest first, and converts the pieces from the most significant
+// on, so only one piece is ever held as text. Each is padded with zeros to piece_digits, except the first, which
+// sets the length
+class DecimalStream {
+   public:
+    DecimalStream(Stream& stream, const unsigned threads)
+        : m_stream(stream),
+          m_threads(threads == 0 ? Parallel::hardware_threads() : threads),
+          m_piece_digits(stream_piece_digits * m_threads) {}
+
+    void write(const mpz_class& value) {
+        const std::size_t digits = mpz_sizeinbase(value.get_mpz_t(), 10);
+        unsigned levels = 0;
+        while ((m_piece_digits << levels) < digits) ++levels;
+        m_powers.resize(levels);
+        if (levels > 0) mpz_ui_pow_ui(m_powers[0].get_mpz_t(), 10, m_piece_digits);
+        for (unsigned j = 1; j < levels; ++j) {
+            m_powers[j] = m_powers[j - 1] * m_powers[j - 1];
+            Interrupt::check_now();
+        }
+
+        if (value < 0) m_stream.write("-");
+        mpz_class remaining;
+        mpz_abs(remaining.get_mpz_t(), value.get_mpz_t());
+        split(remaining, levels);
+    }
+
+   private:
+    void split(mpz_class& value, const unsigned level) {
+        if (level == 0) {
+            piece(value);
+            return;
+        }
+        mpz_class low;
+        mpz_tdiv_qr(value.get_mpz_t(), low.get_mpz_t(), value.get_mpz_t(), m_powers[level - 1].get_mpz_t());
+        Interrupt::check_now();
+        split(value, level - 1);
+        mpz_class().swap(value);
+        split(low, level - 1);
+    }
+
+    // The digits estimate can be high, so the leading pieces can be 0
+    void piece(const mpz_class& value) {
+        if (!m_started && value == 0) return;
+        const std::string text = format_integer(value, m_threads);
+        if (m_started) m_stream.zeros(m_piece_digits - text.size());
+        m_stream.digits(text);
+        m_started = true;
+        Interrupt::check_now();
+    }
+
+    Stream& m_stream;
+    const unsigned m_threads;
+    const std::size_t m_piece_digits;
+    std::vector<mpz_class> m_powers;
+    bool m_started = false;
+};
+
+// Powers of 2 need no division, the pieces are runs of limbs read in place. Octal pieces are a multiple of 3 limbs,
+// so no digit straddles two of them
+void stream_power_of_two(const mpz_class& value, const unsigned base, Stream& stream) {
+    static constexpr std::size_t piece_limbs = 3 * 4096;
+    const unsigned digit_bits = base == 16 ? 4 : base == 8 ? 3 : 1;
+    const std::size_t piece_digits = piece_limbs * GMP_NUMB_BITS / digit_bits;
+    const mp_limb_t* const limbs = mpz_limbs_read(value.get_mpz_t());
+    const std::size_t size = mpz_size(value.get_mpz_t());
+
+    stream.write(value < 0 ? "-0" : "0");
+    stream.write(base == 16 ? "x" : base == 8 ? "o" : "b");
+    std::string text;
+    for (std::size_t first = (size - 1) / piece_limbs * piece_limbs;; first -= piece_limbs) {
+        mpz_t piece;
+        mpz_roinit_n(piece, limbs + first, static_cast<mp_size_t>(std::min(piece_limbs, size - first)));
+        text.resize(mpz_sizeinbase(piece, static_cast<int>(base)) + 1);
+        mpz_get_str(text.data(), static_cast<int>(base), piece);
+        text.resize(text.size() - 1);
+        if (first + piece_limbs < size) stream.zeros(piece_digits - text.size());
+        stream.digits(text);
+        Interrupt::check_now();
+        if (first == 0) break;
+    }
+}
+
+// For an empty sink only the start of the result and how many digits it has are kept, which takes one division by
+// a power of the base instead of converting every digit
+void summarize(const mpz_class& value, const unsigned base, Stream& stream) {
+    mpz_class leading;
+    mpz_abs(leading.get_mpz_t(), value.get_mpz_t());
+    // Exact for powers of 2, and at most one too many for 10, so one more digit than the prefix is kept to always
+    // fill it. The length of the leading digits makes up for the count either way
+    const std::size_t dropped = mpz_sizeinbase(leading.get_mpz_t(), static_cast<int>(base)) - streamed_prefix - 1;
+    if (base == 10) {
+        mpz_class scale;
+        mpz_ui_pow_ui(scale.get_mpz_t(), 10, dropped);
+        mpz_tdiv_q(leading.get_mpz_t(), leading.get_mpz_t(), scale.get_mpz_t());
+    } else {
+        const unsigned digit_bits = base == 16 ? 4 : base == 8 ? 3 : 1;
+        mpz_tdiv_q_2exp(leading.get_mpz_t(), leading.get_mpz_t(), dropped * digit_bits);
+    }
+    Interrupt::check_now();
+
+    if (value < 0) stream.write("-");
+    if (base != 10) stream.write(base == 16 ? "0x" : base == 8 ? "0o" : "0b");
+    const std::string text = leading.get_str(static_cast<int>(base));
+    stream.digits(text, text.size() + dropped);
+}
+
+// The whole result as text, or passed to the sink in pieces when it's long
+[[nodiscard]] Result integer_result(const mpz_class& value, const unsigned threads, const unsigned base,
+                                    const Sink* const sink) {
+    if (!sink || mpz_sizeinbase(value.get_mpz_t(), static_cast<int>(base)) <= stream_length) {
+        return Result{true, format_integer(value, threads, base)};
+    }
+    Result result;
+    Stream stream(*sink, result);
+    if (!*sink) {
+        summarize(value, base, stream);
+    } else if (base == 10) {
+        DecimalStream(stream, threads).write(value);
+    } else {
+        stream_power_of_two(value, base, stream);
+    }
+    return result;
+}
+
+// A float that holds a huge integer, like 2.0^10000000, is streamed as one
+[[nodiscard]] Result floating_point_result(mpfr_srcptr value, const long display_digits, const unsigned threads,
+                                           const unsigned base, const Sink* const sink) {
+    if (sink && mpfr_regular_p(value) && mpfr_integer_p(value) &&
+        static_cast<double>(mpfr_get_exp(value)) * log10_2 > static_cast<double>(stream_length)) {
+        mpz_class integer;
+        mpfr_get_z(integer.get_mpz_t(), value, MPFR_RNDN);
+        return integer_result(integer, threads, base, sink);
+    }
+    return Result{true, format_floating_point(value, display_digits, base)};
+}
+
+[[nodiscard]] Result value_result(const Value& value, const long display_digits, const unsigned threads,
+                                  const unsigned base, const Sink* const sink) {
+    if (!value.is_floating_point()) return integer_result(value.integer(), threads, base, sink);
+    return floating_point_result(value.floating_point(), display_digits, threads, base, sink);
+}
+
+}  // namespace
+
+std::string format_value(const Value& value, const long display_digits, const unsigned threads,
+                         const unsigned base) {
+    if (!value.is_floating_point()) return format_integer(value.integer(), threads, base);
+    return format_floating_point(value.floating_point(), display_digits, base);
+}
+
+Expression::Expression() = default;
+Expression::Expression(Expression&& other) noexcept = default;
+Expression& Expression::operator=(Expression&& other) noexcept = default;
+Expression::~Expression() = default;
+
+Context::Context(const Settings& settings) : m_settings(settings), m_parser(std::make_unique<Parse::Parser>()) {
+    if (m_settings.max_memory != 0) Memory::track();
+}
+Context::Context(Context&& other) noexcept = default;
+Context& Context::operator=(Context&& other) noexcept = default;
+Context::~Context() = default;
+
+void Context::set_settings(const Settings& settings) {
+    m_settings = settings;
+    if (m_settings.max_memory != 0) Memory::track();
+}
+
+std::optional<std::string> Context::normalize(const std::string_view expression, char& target) {
+    target = normalize_expression(expression, m_input, m_base);
+    if (m_base == 0) m_base = m_settings.base;
+    if (target == '\0') {
+        if (m_input.empty()) return std::optional<std::string>("Empty input received");
+        return std::nullopt;
+    }
+    return check_var_assign_error(m_input, target);
+}
+
+std::optional<std::string> Context::parse(const std::string_view expression) {
+    char target;
+    const auto error = normalize(expression, target);
+    if (error) return error;
+
+    const ParseResult& result = m_parser->parse(m_input, m_vars);
+    if (!result.success) return std::optional<std::string>(result.error_msg);
+    return std::nullopt;
+}
+
+Expression Context::build(const char target, Stats* const stats) {
+    Timing::Stopwatch stopwatch(stats != nullptr, stats && stats->cpu_time, stats ? stats->counters : nullptr);
+    Expression expression;
+    expression.m_target = target;
+    expression.m_base = m_base;
+    const ParseResult& result =
+        m_parser->parse(m_input, m_vars, stats ? &stopwatch : nullptr, stats ? &stats->lex : nullptr);
+    if (stats) stats->parse = stopwatch.lap();
+    if (!result.success) {
+        expression.m_error = result.error_msg;
+        return expression;
+    }
+
+    try {
+        if (result.is_math) {
+            expression.m_is_floating_point = result.is_floating_point;
+            expression.m_math = std::make_unique<MathAST>();
+            expression.m_math->build_ast(result.result, result.literals, m_vars, result.is_floating_point,
+                                         MathSettings{m_settings.precision, m_settings.degrees, m_settings.threads});
+        } else {
+            expression.m_bool = std::make_unique<BoolAST>();
+            expression.m_bool->build_ast(result.result);
+        }
+    } catch (const std::bad_alloc&) {
+        expression.m_math.reset();
+        expression.m_bool.reset();
+        expression.m_error = "The number grew too big";
+    } catch (const std::exception& err) {
+        expression.m_math.reset();
+        expression.m_bool.reset();
+        expression.m_error = err.what();
+    }
+    if (stats && expression.ok()) {
+        stats->build = stopwatch.lap();
+        stats->built = true;
+        stats->tokens = result.result.size();
+        stats->is_math = result.is_math;
+        stats->precision = result.is_math && result.is_floating_point ? m_settings.precision : 0;
+        copy_counts(result.is_math ? expression.m_math->count_nodes() : expression.m_bool->count_nodes(), *stats);
+    }
+    return expression;
+}
+
+Expression Context::compile(const std::string_view expression) {
+    char target;
+    const auto error = normalize(expression, target);
+    if (error) {
+        Expression failed;
+        failed.m_error = *error;
+        return failed;
+    }
+    return build(target, nullptr);
+}
+
+Result Context::evaluate(const Expression& expression) {
+    const Memory::Budget budget(m_settings.max_memory);
+    const Interrupt::Scope limits(std::chrono::milliseconds(m_settings.timeout), m_cancel);
+    return run(expression, nullptr);
+}
+
+Result Context::run(const Expression& expression, Stats* const stats) {
+    if (!expression.ok()) return Result{false, expression.error()};
+    Timing::Stopwatch stopwatch(stats != nullptr, stats && stats->cpu_time, stats ? stats->counters : nullptr);
+    try {
+        if (!expression.is_math()) {
+            const bool value = expression.m_bool->evaluate();
+            if (stats) stats->evaluate = stopwatch.lap();
+            return Result{true, value ? "True" : "False"};
+        }
+        if (expression.m_is_floating_point) {
+            const mpfr_t& final_value = expression.m_math->evaluate_floating_point();
+            if (stats) stats->evaluate = stopwatch.lap();
+            Result result = floating_point_result(final_value, m_settings.display_digits, m_settings.threads,
+                                                  expression.m_base, m_sink);
+            if (stats) stats->format = stopwatch.lap();
+            m_vars.insert_or_assign(expression.m_target, Value(final_value));
+            return result;
+        }
+        mpz_class final_value = expression.m_math->evaluate();
+        if (stats) stats->evaluate = stopwatch.lap();
+        Result result = integer_result(final_value, m_settings.threads, expression.m_base, m_sink);
+        if (stats) stats->format = stopwatch.lap();
+        m_vars.insert_or_assign(expression.m_target, Value(std::move(final_value)));
+        return result;
+    } catch (const std::bad_alloc&) {
+        return Result{false, "The number grew too big"};
+    } catch (const std::exception& err) {
+        return Result{false, err.what()};
+    }
+}
+
+// Expressions that are a single value skip the parser
+std::optional<Result> Context::evaluate_single_value(const char target) {
+    if (std::ranges::all_of(m_input, ::isdigit)) {
+        mpz_class integer(m_input);
+        Result result{true, m_base == 10 ? m_input : format_integer(integer, 1, m_base)};
+        m_vars.insert_or_assign(target, Value(std::move(integer)));
+        return result;
+    } else if (m_input == "E") {
+        mpfr_t euler_value;
+        mpfr_init2(euler_value, static_cast<mpfr_prec_t>(m_settings.precision));
+        mpfr_set_str(euler_value, euler.data(), 10, MPFR_RNDN);
+        m_vars.insert_or_assign(target, Value(euler_value));
+        mpfr_clear(euler_value);
+        // The "+ 2" is to keep the 2 and the decimal of e
+        return Result{true, std::string(euler.substr(0, static_cast<std::size_t>(m_settings.display_digits) + 2))};
+    } else if (m_input == "PI") {
+        mpfr_t pi;
+        mpfr_init2(pi, static_cast<mpfr_prec_t>(m_settings.precision));
+        mpfr_const_pi(pi, MPFR_RNDN);
+        Result result{true, format_mpfr(pi, m_settings.display_digits)};
+        m_vars.insert_or_assign(target, Value(pi));
+        mpfr_clear(pi);
+        return result;
+    } else if (m_input == "ANS") {
+        const auto ans = m_vars.find('\0');
+        if (ans == m_vars.end()) return Result{false, "There is no ANS present"};
+        Result result = value_result(ans->second, m_settings.display_digits, m_settings.threads, m_base, m_sink);
+        if (target != '\0') m_vars.insert_or_assign(target, Value(ans->second));
+        return result;
+    } else if (m_input.size() == 1 && m_vars.contains(m_input[0])) {
+        const Value& value = m_vars.at(m_input[0]);
+        Result result = value_result(value, m_settings.display_digits, m_settings.threads, m_base, m_sink);
+        m_vars.insert_or_assign(target, Value(value));
+        return result;
+    }
+    return std::nullopt;
+}
+
+Result Context::evaluate(const std::string_view expression) {
+    const Memory::Budget budget(m_settings.max_memory);
+    const Interrupt::Scope limits(std::chrono::milliseconds(m_settings.timeout), m_cancel);
+    return run(expression, nullptr);
+}
+
+Result Context::evaluate(const std::string_view expression, Stats& stats) {
+    const bool cpu_time = stats.cpu_time;
+    const Perf::Counters* const counters = stats.counters;
+    stats = Stats{};
+    stats.cpu_time = cpu_time;
+    stats.counters = counters;
+    const Memory::Budget budget(m_settings.max_memory);
+    const Interrupt::Scope limits(std::chrono::milliseconds(m_settings.timeout), m_cancel);
+    Result result = run(expression, &stats);
+    const Memory::Usage usage = budget.usage();
+    stats.allocated = usage.allocated;
+    stats.peak_memory = usage.peak;
+    return result;
+}
+
+Result Context::run(const std::string_view expression, Stats* const stats) {
+    Timing::Stopwatch stopwatch(stats != nullptr, stats && stats->cpu_time, stats ? stats->counters : nullptr);
+    char target;
+    const auto error = normalize(expression, target);
+    if (stats) stats->normalize = stopwatch.lap();
+    if (error) return Result{false, *error};
+
+    try {
+        auto single_value = evaluate_single_value(target);
+        if (stats) stats->evaluate = stopwatch.lap();
+        if (single_value) {
+            if (stats && single_value->success) {
+                const Value& value = m_vars.at(target);
+                stats->is_math = true;
+                stats->tokens = 1;
+                stats->values = 1;
+                stats->precision = value.is_floating_point() ? mpfr_get_prec(value.floating_point()) : 0;
+            }
+            return std::move(*single_value);
+        }
+    } catch (const std::exception& err) {
+        return Result{false, err.what()};
+    }
+    return run(build(target, stats), stats);
+}
+
+}  // namespace CCalc
@@ -0,0 +1,192 @@
+// Author: Caden LeCluyse
+
+#ifndef CCALC_H
+#define CCALC_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mpfr.h>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "include/timing.hpp"
+#include "include/value.hpp"
+
+class BoolAST;
+class MathAST;
+
+namespace Parse {
+class Parser;
+}
+
+// The calculator as a library. Nothing here reads the settings file, prints, or touches global state,
+// so each thread can evaluate with its own Context at the same time. A Context and the expressions it
+// compiles must only be used by one thread at a time. MPFR keeps constants like pi cached for each thread,
+// so later evaluations don't compute them again. Call mpfr_free_cache on a thread to release them
+namespace CCalc {
+
+struct Settings {
+    long precision = 320; // In bits
+    long display_digits = 15;
+    bool degrees = false;
+    // The most memory GMP and MPFR numbers can take up while one expression is evaluated, in bytes. 0 is no limit.
+    // A limit installs counting memory functions in GMP the first time it's set, see memory/memory.h. An
+    // expression is stopped at the first operation that goes over, so it can overshoot by one result
+    std::size_t max_memory = 0;
+    // In milliseconds, how long one expression can take from when evaluate is called. 0 is no limit. It's checked
+    // between operations, so one huge multiply or MPFR call finishes before the evaluation stops
+    long timeout = 0;
+    // How many threads one floating point expression can be split across, 0 is one per core. Only expressions
+    // that take long enough to be worth it are split, see MathAST::plan_parallel, and the result is the same.
+    // Integer results are converted to decimal on this many threads too, see format_integer
+    unsigned threads = 1;
+    // Integer results are printed in base 2, 8, 10 or 16. A trailing @bin, @oct, @dec or @hex on an expression
+    // picks the base for that expression only. Other bases are linear in the size of the number, decimal isn't
+    unsigned base = 10;
+};
+
+// Math results longer than stream_length characters are passed to a context's sink a piece at a time, see
+// Context::set_sink. A streamed result keeps its first streamed_prefix characters in Result::text
+inline constexpr std::size_t stream_length = 4096;
+inline constexpr std::size_t streamed_prefix = 64;
+using Sink = std::function<void(std::string_view piece)>;
+
+struct Result {
+    bool success = false;
+    std::string text; // The formatted result, or the error message if success is false
+    // The result went to the sink, text only has the start of it and digits is how many digits it had
+    bool streamed = false;
+    std::size_t digits = 0;
+};
+
+// Where the time went in one evaluation, and the shape of the tree. An expression that is a single value
+// skips the parser and the tree, so only normalize and evaluate are timed
+struct Stats {
+    // Set before evaluating. Leaving cpu_time off saves a system call for each phase, and the CPU times stay 0.
+    // If counters is set, each phase also gets the hardware events counted on this thread while it ran
+    bool cpu_time = true;
+    const Perf::Counters* counters = nullptr;
+
+    Timing::Phase normalize;
+    Timing::Phase lex;
+    Timing::Phase parse;
+    Timing::Phase build;
+    Timing::Phase evaluate;
+    Timing::Phase format;
+    bool built = false;
+    bool is_math = false;
+    long precision = 0; // In bits, 0 when the expression was evaluated with exact integers
+    std::size_t tokens = 0; // In the postfix expression, so without parentheses
+    // Bytes GMP and MPFR allocated in total, and the most they held at once. Only counted after Memory::track
+    std::size_t allocated = 0;
+    std::size_t peak_memory = 0;
+    // Nodes in the tree by kind. Each operator node is one MPFR or GMP call, or one boolean operation
+    std::size_t values = 0;
+    std::size_t variables = 0;
+    std::size_t operations = 0;
+    std::size_t trig = 0;
+    std::size_t factorials = 0;
+    std::size_t negations = 0;
+
+    [[nodiscard]] std::size_t operator_nodes() const noexcept { return operations + trig + factorials + negations; }
+    [[nodiscard]] std::size_t nodes() const noexcept { return values + variables + operator_nodes(); }
+};
+
+// A parsed and built expression, ready to be evaluated any number of times. Variables are copied in when it's
+// compiled. An assignment like X = 2 + 2 stores the result in X every time it is evaluated
+class Expression {
+   public:
+    Expression(Expression&& other) noexcept;
+    Expression& operator=(Expression&& other) noexcept;
+    ~Expression();
+
+    [[nodiscard]] bool ok() const noexcept { return m_error.empty(); }
+    [[nodiscard]] const std::string& error() const noexcept { return m_error; }
+    [[nodiscard]] bool is_math() const noexcept { return m_math != nullptr; }
+
+   private:
+    friend class Context;
+    Expression();
+
+    std::unique_ptr<MathAST> m_math;
+    std::unique_ptr<BoolAST> m_bool;
+    std::string m_error;
+    bool m_is_floating_point = false;
+    char m_target = '\0'; // The variable the result is stored in, '\0' is ANS
+    unsigned m_base = 10;
+};
+
+class Context {
+   public:
+    explicit Context(const Settings& settings = Settings{});
+    Context(Context&& other) noexcept;
+    Context& operator=(Context&& other) noexcept;
+    ~Context();
+
+    [[nodiscard]] const Settings& settings() const noexcept { return m_settings; }
+    // Expressions that were already compiled keep the settings they were built with
+    void set_settings(const Settings& settings);
+    // Evaluations stop with an error soon after flag becomes true, see interrupt/interrupt.h. It can be set from
+    // another thread or a signal handler, and it's never cleared here. nullptr stops watching
+    void set_cancel_flag(const std::atomic<bool>* const flag) noexcept { m_cancel = flag; }
+    // Long math results are converted a piece at a time and passed to sink as they're made, from the most
+    // significant digit, instead of being built whole in Result::text, so a huge result is never held as text.
+    // An error, like an interrupt, can come after some of the pieces. An empty sink only keeps the start and the
+    // digit count, without converting the rest. nullptr builds every result whole
+    void set_sink(const Sink* const sink) noexcept { m_sink = sink; }
+    // Only checks the syntax, returns the error message if there is one
+    [[nodiscard]] std::optional<std::string> parse(const std::string_view expression);
+    [[nodiscard]] Expression compile(const std::string_view expression);
+    // Math results are stored in ANS, or the assigned variable, at full precision
+    [[nodiscard]] Result evaluate(const Expression& expression);
+    [[nodiscard]] Result evaluate(const std::string_view expression);
+    // Also times each phase into stats, which costs a few clock reads for each phase
+    [[nodiscard]] Result evaluate(const std::string_view expression, Stats& stats);
+
+    // ANS is stored under '\0'
+    [[nodiscard]] Types::VarMap& variables() noexcept { return m_vars; }
+    [[nodiscard]] const Types::VarMap& variables() const noexcept { return m_vars; }
+
+   private:
+    // The expression is copied into m_input without spaces and in uppercase, and an assignment and a base
+    // suffix are split off. The base goes in m_base
+    [[nodiscard]] std::optional<std::string> normalize(const std::string_view expression, char& target);
+    [[nodiscard]] std::optional<Result> evaluate_single_value(const char target);
+    [[nodiscard]] Expression build(const char target, Stats* const stats);
+    [[nodiscard]] Result run(const std::string_view expression, Stats* const stats);
+    [[nodiscard]] Result run(const Expression& expression, Stats* const stats);
+
+    Settings m_settings;
+    Types::VarMap m_vars;
+    std::unique_ptr<Parse::Parser> m_parser;
+    std::string m_input;
+    unsigned m_base = 10;
+    const std::atomic<bool>* m_cancel = nullptr;
+    const Sink* m_sink = nullptr;
+};
+
+// The variables an expression reads ('\0' for ANS), and the one it assigns. Found with the lexer alone,
+// so callers can skip loading stored variables the expression doesn't use
+struct VariableUse {
+    std::string reads;
+    char target = '\0'; // '\0' if the expression doesn't assign a variable
+};
+[[nodiscard]] VariableUse variable_use(const std::string_view expression);
+
+// Formats a float with display_digits after the decimal point and the trailing zeros removed.
+// Integers are printed without a decimal point
+[[nodiscard]] std::string format_mpfr(mpfr_srcptr value, const long display_digits);
+// Converted straight into the returned string, GMP's get_str converts into a buffer of its own and copies it.
+// Integers of a million digits or more are split by powers of 10 and converted on up to threads threads,
+// 0 is one per core. Bases 2, 8 and 16 are read straight off the limbs and start with 0b, 0o or 0x
+[[nodiscard]] std::string format_integer(const mpz_class& value, unsigned threads = 1, const unsigned base = 10);
+// Floats are always decimal, unless they hold an integer
+[[nodiscard]] std::string format_value(const Types::Value& value, const long display_digits,
+                                       const unsigned threads = 1, const unsigned base = 10);
+
+}  // namespace CCalc
+
+#endif
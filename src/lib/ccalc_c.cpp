@@ -0,0 +1,170 @@
+// Author: Caden LeCluyse
+
+#include "lib/ccalc_c.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mpfr.h>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "include/types.hpp"
+#include "lib/ccalc.h"
+#include "parallel/pool.h"
+
+using namespace Types;
+
+struct ccalc_ctx {
+    CCalc::Context context;
+};
+
+struct ccalc_result {
+    std::string text;
+};
+
+namespace {
+
+// Exceptions can't cross into C, so every entry point runs its body through this
+template <typename Function>
+[[nodiscard]] int guard(Function&& function) noexcept {
+    try {
+        return function();
+    } catch (const std::bad_alloc&) {
+        return CCALC_OUT_OF_MEMORY;
+    } catch (...) {
+        return CCALC_EXPRESSION_ERROR;
+    }
+}
+
+[[nodiscard]] int store_result(CCalc::Result&& evaluated, ccalc_result* const result) {
+    result->text = std::move(evaluated.text);
+    return evaluated.success ? CCALC_OK : CCALC_EXPRESSION_ERROR;
+}
+
+}  // namespace
+
+extern "C" {
+
+unsigned ccalc_abi_version(void) { return CCALC_ABI_VERSION; }
+
+ccalc_ctx* ccalc_ctx_new(void) { return new (std::nothrow) ccalc_ctx{}; }
+
+void ccalc_ctx_free(ccalc_ctx* const ctx) { delete ctx; }
+
+int ccalc_ctx_set(ccalc_ctx* const ctx, const char* const name, const long value) {
+    if (!ctx || !name) return CCALC_INVALID_ARGUMENT;
+
+    CCalc::Settings settings = ctx->context.settings();
+    switch (string_to_settings_enum(name)) {
+        case Setting::PRECISION:
+            if (value < MPFR_PREC_MIN || value > MPFR_PREC_MAX) return CCALC_INVALID_ARGUMENT;
+            settings.precision = value;
+            break;
+        case Setting::DISPLAY_PREC:
+            if (value < 0) return CCALC_INVALID_ARGUMENT;
+            settings.display_digits = value;
+            break;
+        case Setting::ANGLE:
+            if (value != 0 && value != 1) return CCALC_INVALID_ARGUMENT;
+            settings.degrees = value == 1;
+            break;
+        case Setting::MAX_MEMORY:
+            if (value < 0 || static_cast<unsigned long>(value) > (SIZE_MAX >> 20)) return CCALC_INVALID_ARGUMENT;
+            settings.max_memory = static_cast<std::size_t>(value) << 20;
+            break;
+        case Setting::TIMEOUT:
+            if (value < 0) return CCALC_INVALID_ARGUMENT;
+            settings.timeout = value;
+            break;
+        case Setting::THREADS:
+            if (value < 0 || value > Parallel::max_threads) return CCALC_INVALID_ARGUMENT;
+            settings.threads = static_cast<unsigned>(value);
+            break;
+        case Setting::BASE:
+            if (value != 2 && value != 8 && value != 10 && value != 16) return CCALC_INVALID_ARGUMENT;
+            settings.base = static_cast<unsigned>(value);
+            break;
+        default:
+            return CCALC_INVALID_ARGUMENT;
+    }
+    ctx->context.set_settings(settings);
+    return CCALC_OK;
+}
+
+void ccalc_ctx_clear_vars(ccalc_ctx* const ctx) {
+    if (ctx) ctx->context.variables().clear();
+}
+
+ccalc_result* ccalc_result_new(void) { return new (std::nothrow) ccalc_result{}; }
+
+void ccalc_result_free(ccalc_result* const result) { delete result; }
+
+size_t ccalc_result_str(const ccalc_result* const result, char* const buffer, const size_t buffer_size) {
+    if (!result) return 0;
+    if (buffer && buffer_size != 0) {
+        const std::size_t copied = std::min(result->text.size(), buffer_size - 1);
+        std::memcpy(buffer, result->text.data(), copied);
+        buffer[copied] = '\0';
+    }
+    return result->text.size();
+}
+
+int ccalc_eval(ccalc_ctx* const ctx, const char* const expression, const size_t length, ccalc_result* const result) {
+    if (!ctx || (!expression && length != 0) || !result) return CCALC_INVALID_ARGUMENT;
+    result->text.clear();
+    return guard([&] {
+        return store_result(ctx->context.evaluate(std::string_view(expression, length)), result);
+    });
+}
+
+int ccalc_parse(ccalc_ctx* const ctx, const char* const expression, const size_t length, ccalc_result* const result) {
+    if (!ctx || (!expression && length != 0) || !result) return CCALC_INVALID_ARGUMENT;
+    result->text.clear();
+    return guard([&] {
+        const std::optional<std::string> error = ctx->context.parse(std::string_view(expression, length));
+        result->text = error.value_or("");
+        return error ? CCALC_EXPRESSION_ERROR : CCALC_OK;
+    });
+}
+
+int ccalc_eval_batch(ccalc_ctx* const ctx, ccalc_batch_item* const items, const size_t count, char* const buffer,
+                     const size_t buffer_size, size_t* const required) {
+    if (!ctx || (!items && count != 0) || (!buffer && buffer_size != 0)) return CCALC_INVALID_ARGUMENT;
+
+    // The crossing into the library and the buffer handoff are paid once for the whole batch
+    ccalc_result result;
+    std::size_t needed = 0;
+    std::size_t used = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        ccalc_batch_item& item = items[i];
+        result.text.clear();
+        if (!item.expression && item.length != 0) {
+            item.status = CCALC_INVALID_ARGUMENT;
+        } else {
+            item.status = guard([&] {
+                return store_result(ctx->context.evaluate(std::string_view(item.expression, item.length)),
+                                    &result);
+            });
+        }
+
+        item.text_length = result.text.size();
+        needed += result.text.size() + 1;
+        if (buffer_size - used < result.text.size() + 1) {
+            item.status = CCALC_BUFFER_TOO_SMALL;
+            item.offset = 0;
+            continue;
+        }
+        item.offset = used;
+        std::memcpy(buffer + used, result.text.data(), result.text.size());
+        buffer[used + result.text.size()] = '\0';
+        used += result.text.size() + 1;
+    }
+
+    if (required) *required = needed;
+    return needed > buffer_size ? CCALC_BUFFER_TOO_SMALL : CCALC_OK;
+}
+
+}  // extern "C"
@@ -0,0 +1,77 @@
+/* Author: Caden LeCluyse */
+
+#ifndef CCALC_C_H
+#define CCALC_C_H
+
+#include <stddef.h>
+
+/* A C interface to libccalc, for calling the calculator from other languages through their FFI.
+ * Contexts and results are opaque handles. Text is always copied into buffers the caller provides,
+ * so nothing allocated by the library has to be freed by the caller except the handles themselves.
+ * A context must only be used by one thread at a time, but any number of contexts can be used at once.
+ * Functions never throw, failures are reported through the returned status */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped whenever a function's signature or behaviour changes. Compare it with ccalc_abi_version()
+ * to make sure the library that was loaded matches the header that was compiled against */
+#define CCALC_ABI_VERSION 1
+
+typedef struct ccalc_ctx ccalc_ctx;
+typedef struct ccalc_result ccalc_result;
+
+enum ccalc_status {
+    CCALC_OK = 0,
+    CCALC_EXPRESSION_ERROR = 1, /* The expression couldn't be evaluated, the result holds the message */
+    CCALC_BUFFER_TOO_SMALL = 2,
+    CCALC_INVALID_ARGUMENT = 3,
+    CCALC_OUT_OF_MEMORY = 4
+};
+
+/* One expression of a batch. The caller fills in expression and length, the rest is filled in by
+ * ccalc_eval_batch. The text of the result (or error) is null terminated at buffer + offset */
+typedef struct ccalc_batch_item {
+    const char* expression;
+    size_t length;
+    int status;
+    size_t offset;
+    size_t text_length;
+} ccalc_batch_item;
+
+unsigned ccalc_abi_version(void);
+
+/* Returns NULL if there isn't enough memory. The context starts with the default settings:
+ * precision=320, display_digits=15, angle=0, threads=1, base=10, and no max_memory or timeout */
+ccalc_ctx* ccalc_ctx_new(void);
+void ccalc_ctx_free(ccalc_ctx* ctx);
+/* Takes the same names and values as settings.ini: precision, display_digits, angle, max_memory, timeout,
+ * threads, and base. Expressions that were already compiled keep the settings they were compiled with */
+int ccalc_ctx_set(ccalc_ctx* ctx, const char* name, long value);
+/* Removes every variable, including ANS */
+void ccalc_ctx_clear_vars(ccalc_ctx* ctx);
+
+ccalc_result* ccalc_result_new(void);
+void ccalc_result_free(ccalc_result* result);
+/* Copies the text of the result or error into buffer, truncated to fit and always null terminated
+ * if buffer_size isn't 0. Returns the full length without the terminator, like snprintf */
+size_t ccalc_result_str(const ccalc_result* result, char* buffer, size_t buffer_size);
+
+/* The expression doesn't have to be null terminated. Math results are stored in ANS or the assigned
+ * variable, the same as continuous mode */
+int ccalc_eval(ccalc_ctx* ctx, const char* expression, size_t length, ccalc_result* result);
+/* Only checks the syntax. CCALC_EXPRESSION_ERROR means the result holds the error message */
+int ccalc_parse(ccalc_ctx* ctx, const char* expression, size_t length, ccalc_result* result);
+/* Evaluates the items in order, as if ccalc_eval was called on each one, and packs their text into
+ * buffer. An item whose text doesn't fit gets CCALC_BUFFER_TOO_SMALL, but it was still evaluated, so a
+ * batch that assigns variables shouldn't simply be run again. Returns CCALC_BUFFER_TOO_SMALL if any item
+ * didn't fit, and sets required (if it isn't NULL) to the buffer size that would have fit all of them */
+int ccalc_eval_batch(ccalc_ctx* ctx, ccalc_batch_item* items, size_t count, char* buffer, size_t buffer_size,
+                     size_t* required);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+// Author: Caden LeCluyse
+
+#include "logic/anf.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include "parallel/pool.h"
+
+namespace Logic {
+
+namespace {
+
+// Bits whose index has bit i clear, used to fold the first six variables inside a word
+constexpr std::array<std::uint64_t, 6> low_masks = {
+    0x5555555555555555ULL, 0x3333333333333333ULL, 0x0F0F0F0F0F0F0F0FULL,
+    0x00FF00FF00FF00FFULL, 0x0000FFFF0000FFFFULL, 0x00000000FFFFFFFFULL
+};
+
+// Bit positions inside a word grouped by how many of the first six variables they contain
+constexpr std::array<std::uint64_t, 7> degree_masks = []() {
+    std::array<std::uint64_t, 7> masks{};
+    for (unsigned bit = 0; bit < 64; ++bit) masks[static_cast<std::size_t>(std::popcount(bit))] |= std::uint64_t{1} << bit;
+    return masks;
+}();
+
+// Number of word level variables handled while a block of words is still in cache (2^15 words = 256 KiB)
+constexpr std::size_t cache_block_vars = 15;
+
+// For every variable past the sixth, the upper half of each pair of runs gets the lower half xored in
+void fold_words(std::uint64_t* const words, const std::size_t num_words, const std::size_t first_var,
+                const std::size_t last_var) {
+    for (std::size_t var = first_var; var < last_var; ++var) {
+        const std::size_t stride = std::size_t{1} << var;
+        for (std::size_t run = 0; run < num_words; run += 2 * stride) {
+            for (std::size_t w = run; w < run + stride; ++w) words[w + stride] ^= words[w];
+        }
+    }
+}
+
+}  // namespace
+
+void mobius_transform(std::vector<std::uint64_t>& table, const std::size_t num_vars, const unsigned threads) {
+    const std::size_t word_vars = std::min<std::size_t>(num_vars, low_masks.size());
+    const std::size_t table_vars = num_vars - word_vars; // Variables that select the word
+    const std::size_t block_vars = std::min(table_vars, cache_block_vars);
+    const std::size_t block_size = std::size_t{1} << block_vars;
+
+    // Fold the in-word variables and the low word variables one cache sized block at a time
+    Parallel::run_ranges(table.size() / block_size, threads, [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t block = begin; block < end; ++block) {
+            std::uint64_t* const words = table.data() + block * block_size;
+            for (std::size_t w = 0; w < block_size; ++w) {
+                for (std::size_t var = 0; var < word_vars; ++var) {
+                    words[w] ^= (words[w] & low_masks[var]) << (std::size_t{1} << var);
+                }
+            }
+            fold_words(words, block_size, 0, block_vars);
+        }
+    });
+
+    // The remaining variables pair up words that are further apart than a block
+    for (std::size_t var = block_vars; var < table_vars; ++var) {
+        const std::size_t stride = std::size_t{1} << var;
+        const auto fold_pairs = [&table, stride](const std::size_t begin, const std::size_t end) {
+            for (std::size_t pair = begin; pair < end; ++pair) {
+                const std::size_t low = (pair / stride) * 2 * stride + pair % stride;
+                table[low + stride] ^= table[low];
+            }
+        };
+        Parallel::run_ranges(table.size() / 2, threads, fold_pairs);
+    }
+}
+
+[[nodiscard]] AnfSummary summarize_anf(const std::vector<std::uint64_t>& coefficients) {
+    AnfSummary summary;
+    for (std::size_t w = 0; w < coefficients.size(); ++w) {
+        const std::uint64_t word = coefficients[w];
+        if (!word) continue;
+        summary.monomials += static_cast<std::uint64_t>(std::popcount(word));
+        std::size_t bit_degree = degree_masks.size() - 1;
+        while (!(word & degree_masks[bit_degree])) --bit_degree;
+        summary.degree = std::max(summary.degree, static_cast<std::size_t>(std::popcount(w)) + bit_degree);
+    }
+    return summary;
+}
+
+}
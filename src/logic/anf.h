@@ -0,0 +1,24 @@
+// Author: Caden LeCluyse
+
+#ifndef ANF_H
+#define ANF_H
+
+#include <cstdint>
+#include <vector>
+
+namespace Logic {
+
+struct AnfSummary {
+    std::uint64_t monomials = 0;
+    std::size_t degree = 0;
+};
+
+// Turns a truth table into the coefficients of its algebraic normal form (Zhegalkin polynomial) in place.
+// Afterwards bit m is set when the monomial made of the variables in the bits of m is present. Split across threads
+// threads, 0 for one per core
+void mobius_transform(std::vector<std::uint64_t>& table, const std::size_t num_vars, const unsigned threads);
+[[nodiscard]] AnfSummary summarize_anf(const std::vector<std::uint64_t>& coefficients);
+
+}
+
+#endif
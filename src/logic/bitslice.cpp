@@ -0,0 +1,216 @@
+// Author: Caden LeCluyse
+
+#include "logic/bitslice.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ast/ast.h"
+#include "ast/bnode.h"
+#include "include/types.hpp"
+#include "parallel/pool.h"
+
+using namespace Types;
+
+namespace Logic {
+
+namespace {
+
+// Words evaluated together per instruction, small enough that the whole stack stays in cache
+constexpr std::size_t block_words = 256;
+
+// Truth table columns of the first six variables inside a single word
+constexpr std::array<std::uint64_t, 6> var_patterns = {
+    0xAAAAAAAAAAAAAAAAULL, 0xCCCCCCCCCCCCCCCCULL, 0xF0F0F0F0F0F0F0F0ULL,
+    0xFF00FF00FF00FF00ULL, 0xFFFF0000FFFF0000ULL, 0xFFFFFFFF00000000ULL
+};
+
+[[nodiscard]] BitProgram::Op to_op(const Token key) {
+    switch (key) {
+        case Token::AND:
+            return BitProgram::Op::AND;
+        case Token::OR:
+            return BitProgram::Op::OR;
+        case Token::NAND:
+            return BitProgram::Op::NAND;
+        case Token::NOR:
+            return BitProgram::Op::NOR;
+        case Token::POW_XOR:
+            return BitProgram::Op::XOR;
+        default:
+            throw std::runtime_error("Invalid opkey: " + std::string{static_cast<char>(key)});
+    }
+}
+
+[[nodiscard]] BitProgram::Instruction leaf_instruction(const BoolNodes::BoolNode& node) {
+    if (node.key == Token::VAR) {
+        const auto index = static_cast<const BoolNodes::VarBNode&>(node).index;
+        return BitProgram::Instruction{BitProgram::Op::LOAD_VAR, static_cast<std::uint32_t>(index)};
+    }
+    return BitProgram::Instruction{node.key == Token::TRUE ? BitProgram::Op::LOAD_TRUE : BitProgram::Op::LOAD_FALSE};
+}
+
+// The number of stack slots each subtree needs (its Strahler number)
+[[nodiscard]] std::unordered_map<const BoolNodes::BoolNode*, std::uint32_t>
+stack_needs(const BoolNodes::BoolNode* root) {
+    std::unordered_map<const BoolNodes::BoolNode*, std::uint32_t> needs;
+    std::vector<std::pair<const BoolNodes::BoolNode*, bool> > work;
+    work.emplace_back(root, false);
+    while (!work.empty()) {
+        const auto [node, expanded] = work.back();
+        work.pop_back();
+        if (!node->m_left_child) {
+            needs.emplace(node, 1);
+            continue;
+        }
+        if (!expanded) {
+            work.emplace_back(node, true);
+            if (node->m_right_child) work.emplace_back(node->m_right_child.get(), false);
+            work.emplace_back(node->m_left_child.get(), false);
+            continue;
+        }
+        const std::uint32_t left = needs.at(node->m_left_child.get());
+        if (!node->m_right_child) {
+            needs.emplace(node, left);
+            continue;
+        }
+        const std::uint32_t right = needs.at(node->m_right_child.get());
+        needs.emplace(node, left == right ? left + 1 : std::max(left, right));
+    }
+    return needs;
+}
+
+void load_var(std::uint64_t* const destination, const std::uint32_t var, const std::uint64_t first_word,
+              const std::size_t num_words) {
+    if (var < var_patterns.size()) {
+        std::fill_n(destination, num_words, var_patterns[var]);
+        return;
+    }
+    // Past the sixth variable, the value is constant across a word and follows the word index
+    const std::uint32_t shift = var - static_cast<std::uint32_t>(var_patterns.size());
+    for (std::size_t w = 0; w < num_words; ++w) {
+        destination[w] = ((first_word + w) >> shift) & 1 ? ~std::uint64_t{0} : 0;
+    }
+}
+
+template <typename Operation>
+void apply_binary(std::uint64_t* const left, const std::uint64_t* const right, const std::size_t num_words,
+                  Operation operation) {
+    for (std::size_t w = 0; w < num_words; ++w) left[w] = operation(left[w], right[w]);
+}
+
+void evaluate_block(const BitProgram& program, const std::uint64_t first_word, const std::size_t num_words,
+                    std::vector<std::uint64_t>& stack, std::uint64_t* const output) {
+    std::size_t top = 0;
+    const auto slot = [&stack](const std::size_t index) { return stack.data() + index * block_words; };
+    for (const auto& instruction : program.code) {
+        switch (instruction.op) {
+            case BitProgram::Op::LOAD_VAR:
+                load_var(slot(top), instruction.var, first_word, num_words);
+                ++top;
+                break;
+            case BitProgram::Op::LOAD_TRUE:
+                std::fill_n(slot(top), num_words, ~std::uint64_t{0});
+                ++top;
+                break;
+            case BitProgram::Op::LOAD_FALSE:
+                std::fill_n(slot(top), num_words, 0);
+                ++top;
+                break;
+            case BitProgram::Op::NOT: {
+                std::uint64_t* const value = slot(top - 1);
+                for (std::size_t w = 0; w < num_words; ++w) value[w] = ~value[w];
+                break;
+            }
+            case BitProgram::Op::AND:
+                apply_binary(slot(top - 2), slot(top - 1), num_words, [](auto a, auto b) { return a & b; });
+                --top;
+                break;
+            case BitProgram::Op::OR:
+                apply_binary(slot(top - 2), slot(top - 1), num_words, [](auto a, auto b) { return a | b; });
+                --top;
+                break;
+            case BitProgram::Op::NAND:
+                apply_binary(slot(top - 2), slot(top - 1), num_words, [](auto a, auto b) { return ~(a & b); });
+                --top;
+                break;
+            case BitProgram::Op::NOR:
+                apply_binary(slot(top - 2), slot(top - 1), num_words, [](auto a, auto b) { return ~(a | b); });
+                --top;
+                break;
+            case BitProgram::Op::XOR:
+                apply_binary(slot(top - 2), slot(top - 1), num_words, [](auto a, auto b) { return a ^ b; });
+                --top;
+                break;
+        }
+    }
+    std::copy_n(stack.data(), num_words, output);
+}
+
+}  // namespace
+
+[[nodiscard]] BitProgram compile_bitsliced(const BoolAST& tree, const std::size_t num_vars) {
+    BitProgram program;
+    program.num_vars = num_vars;
+    const BoolNodes::BoolNode* const root = tree.root();
+    if (!root) return program;
+
+    const auto needs = stack_needs(root);
+    std::vector<std::pair<const BoolNodes::BoolNode*, bool> > work;
+    std::size_t depth = 0;
+    work.emplace_back(root, false);
+    while (!work.empty()) {
+        const auto [node, expanded] = work.back();
+        work.pop_back();
+        if (!node->m_left_child) {
+            program.code.push_back(leaf_instruction(*node));
+            program.max_stack = std::max(program.max_stack, ++depth);
+            continue;
+        }
+        if (!expanded) {
+            work.emplace_back(node, true);
+            const BoolNodes::BoolNode* first = node->m_left_child.get();
+            const BoolNodes::BoolNode* second = node->m_right_child.get();
+            // Every operator is commutative, so the bigger side can go first
+            if (second && needs.at(second) > needs.at(first)) std::swap(first, second);
+            if (second) work.emplace_back(second, false);
+            work.emplace_back(first, false);
+            continue;
+        }
+        if (!node->m_right_child) {
+            program.code.push_back(BitProgram::Instruction{BitProgram::Op::NOT});
+            continue;
+        }
+        program.code.push_back(BitProgram::Instruction{to_op(node->key)});
+        --depth;
+    }
+
+    return program;
+}
+
+[[nodiscard]] std::vector<std::uint64_t> truth_table(const BitProgram& program, const unsigned threads) {
+    const std::size_t num_words = truth_table_words(program.num_vars);
+    std::vector<std::uint64_t> table(num_words);
+    const std::size_t num_blocks = (num_words + block_words - 1) / block_words;
+
+    const auto evaluate_blocks = [&program, &table, num_words](const std::size_t begin, const std::size_t end) {
+        std::vector<std::uint64_t> stack(program.max_stack * block_words);
+        for (std::size_t block = begin; block < end; ++block) {
+            const std::size_t first_word = block * block_words;
+            const std::size_t words = std::min(block_words, num_words - first_word);
+            evaluate_block(program, first_word, words, stack, table.data() + first_word);
+        }
+    };
+    Parallel::run_ranges(num_blocks, threads, evaluate_blocks);
+
+    if (program.num_vars < 6) table[0] &= (std::uint64_t{1} << (std::size_t{1} << program.num_vars)) - 1;
+    return table;
+}
+
+}
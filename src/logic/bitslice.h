@@ -0,0 +1,51 @@
+// Author: Caden LeCluyse
+
+#ifndef BITSLICE_H
+#define BITSLICE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "ast/ast.h"
+
+namespace Logic {
+
+// A truth table over n variables takes 2^n bits, so 34 variables is 2 GiB
+inline constexpr std::size_t max_truth_table_vars = 34;
+
+// A symbolic boolean tree flattened into stack code. Every value on the stack is a block of 64 bit words, so each
+// instruction evaluates 64 assignments per word at once. Children that need more stack are emitted first,
+// which keeps the stack depth logarithmic in the size of the tree
+struct BitProgram {
+    enum struct Op : std::uint8_t {
+        LOAD_VAR,
+        LOAD_TRUE,
+        LOAD_FALSE,
+        NOT,
+        AND,
+        OR,
+        NAND,
+        NOR,
+        XOR
+    };
+    struct Instruction {
+        Op op;
+        std::uint32_t var = 0;
+    };
+
+    std::vector<Instruction> code;
+    std::size_t num_vars = 0;
+    std::size_t max_stack = 0;
+};
+
+[[nodiscard]] BitProgram compile_bitsliced(const BoolAST& tree, const std::size_t num_vars);
+// Bit x of the result is the value of the expression when variable i is set to bit i of x.
+// Always at least one word, the bits past 2^n are zero. Split across threads threads, 0 for one per core
+[[nodiscard]] std::vector<std::uint64_t> truth_table(const BitProgram& program, const unsigned threads);
+[[nodiscard]] constexpr std::size_t truth_table_words(const std::size_t num_vars) noexcept {
+    return num_vars <= 6 ? 1 : std::size_t{1} << (num_vars - 6);
+}
+
+}
+
+#endif
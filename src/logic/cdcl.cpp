@@ -0,0 +1,442 @@
+// Author: Caden LeCluyse
+
+#include "logic/cdcl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "engine/signal.h"
+
+namespace Logic {
+
+namespace {
+
+constexpr double var_decay = 0.95;
+constexpr double clause_decay = 0.999;
+constexpr double restart_base = 100;
+constexpr double min_learnts = 2000;
+// The learnt clause limit grows by learnt_growth each time the conflict count passes a geometrically growing mark
+constexpr double learnt_growth = 1.1;
+constexpr double learnt_adjust_start = 100;
+constexpr double learnt_adjust_growth = 1.5;
+constexpr std::uint64_t signal_check_interval = 256;
+
+// Luby sequence scaled by y: 1 1 2 1 1 2 4 1 1 2 1 1 2 4 8 ...
+[[nodiscard]] double luby(const double y, std::uint64_t x) {
+    std::uint64_t size = 1;
+    int sequence = 0;
+    while (size < x + 1) {
+        ++sequence;
+        size = 2 * size + 1;
+    }
+    while (size - 1 != x) {
+        size = (size - 1) >> 1;
+        --sequence;
+        x = x % size;
+    }
+    return std::pow(y, sequence);
+}
+
+[[nodiscard]] std::uint32_t to_lit(const int dimacs) noexcept {
+    return static_cast<std::uint32_t>(std::abs(dimacs) - 1) * 2 + (dimacs < 0 ? 1 : 0);
+}
+
+}  // namespace
+
+Solver::Solver(const std::size_t num_vars) :
+    m_watches(2 * num_vars), m_values(2 * num_vars, 0), m_levels(num_vars, 0), m_reasons(num_vars, no_reason),
+    m_saved_phase(num_vars, false), m_activity(num_vars, 0), m_heap_index(num_vars, -1), m_seen(num_vars, false) {
+    m_heap.reserve(num_vars);
+    for (std::uint32_t v = 0; v < num_vars; ++v) heap_insert(v);
+}
+
+// Clauses are simplified against the level 0 assignment as they come in, so units propagate immediately
+bool Solver::add_clause(std::span<const int> clause) {
+    if (m_unsat) return false;
+
+    std::vector<Lit> lits;
+    lits.reserve(clause.size());
+    for (const int literal : clause) lits.push_back(to_lit(literal));
+    std::ranges::sort(lits);
+
+    std::size_t kept = 0;
+    Lit previous = UINT32_MAX;
+    for (const Lit lit : lits) {
+        if (lit == previous) continue;
+        // A variable and its negation are adjacent after sorting
+        if (previous != UINT32_MAX && lit == (previous ^ 1)) return true;
+        if (value(lit) == 1) return true;
+        previous = lit;
+        if (value(lit) == -1) continue;
+        lits[kept++] = lit;
+    }
+    lits.resize(kept);
+
+    if (lits.empty()) {
+        m_unsat = true;
+        return false;
+    }
+    if (lits.size() == 1) {
+        enqueue(lits[0], no_reason);
+        if (propagate() != no_reason) m_unsat = true;
+        return !m_unsat;
+    }
+    attach_clause(store_clause(std::move(lits), false));
+    return true;
+}
+
+[[nodiscard]] Solver::ClauseRef Solver::store_clause(std::vector<Lit>&& lits, const bool learnt) {
+    if (!m_free_refs.empty()) {
+        const ClauseRef cref = m_free_refs.back();
+        m_free_refs.pop_back();
+        m_clauses[cref] = Clause{std::move(lits), 0, learnt};
+        return cref;
+    }
+    m_clauses.push_back(Clause{std::move(lits), 0, learnt});
+    return static_cast<ClauseRef>(m_clauses.size() - 1);
+}
+
+void Solver::attach_clause(const ClauseRef cref) {
+    const std::vector<Lit>& lits = m_clauses[cref].lits;
+    m_watches[lits[0] ^ 1].push_back(Watcher{cref, lits[1]});
+    m_watches[lits[1] ^ 1].push_back(Watcher{cref, lits[0]});
+}
+
+void Solver::enqueue(const Lit lit, const ClauseRef reason) {
+    m_values[lit] = 1;
+    m_values[lit ^ 1] = -1;
+    m_levels[var(lit)] = decision_level();
+    m_reasons[var(lit)] = reason;
+    m_trail.push_back(lit);
+}
+
+// Returns the conflicting clause, or no_reason if propagation reached a fixpoint
+[[nodiscard]] Solver::ClauseRef Solver::propagate() {
+    ClauseRef conflict = no_reason;
+    while (m_queue_head < m_trail.size()) {
+        const Lit p = m_trail[m_queue_head++];
+        const Lit false_lit = p ^ 1;
+        std::vector<Watcher>& watchers = m_watches[p];
+        ++m_stats.propagations;
+
+        std::size_t i = 0;
+        std::size_t j = 0;
+        const std::size_t num_watchers = watchers.size();
+        while (i < num_watchers) {
+            const Watcher watcher = watchers[i++];
+            if (value(watcher.blocker) == 1) {
+                watchers[j++] = watcher;
+                continue;
+            }
+
+            // Keep the false literal in position 1
+            std::vector<Lit>& lits = m_clauses[watcher.cref].lits;
+            if (lits[0] == false_lit) std::swap(lits[0], lits[1]);
+            const Lit first = lits[0];
+            const Watcher updated{watcher.cref, first};
+            if (first != watcher.blocker && value(first) == 1) {
+                watchers[j++] = updated;
+                continue;
+            }
+
+            bool moved = false;
+            for (std::size_t k = 2; k < lits.size(); ++k) {
+                if (value(lits[k]) != -1) {
+                    lits[1] = lits[k];
+                    lits[k] = false_lit;
+                    m_watches[lits[1] ^ 1].push_back(updated);
+                    moved = true;
+                    break;
+                }
+            }
+            if (moved) continue;
+
+            // No new watch, so the clause is unit or conflicting
+            watchers[j++] = updated;
+            if (value(first) == -1) {
+                conflict = watcher.cref;
+                m_queue_head = m_trail.size();
+                while (i < num_watchers) watchers[j++] = watchers[i++];
+            } else {
+                enqueue(first, watcher.cref);
+            }
+        }
+        watchers.resize(j);
+    }
+
+    return conflict;
+}
+
+// First UIP conflict analysis. The asserting literal ends up in learnt[0] and the literal with the
+// backtrack level in learnt[1], so the clause can be watched on those two
+void Solver::analyze(ClauseRef conflict, std::vector<Lit>& learnt, std::uint32_t& backtrack_level) {
+    learnt.clear();
+    learnt.push_back(0);
+    std::uint32_t path_count = 0;
+    Lit p = UINT32_MAX;
+    std::size_t index = m_trail.size();
+
+    do {
+        Clause& clause = m_clauses[conflict];
+        if (clause.learnt) bump_clause(clause);
+        for (std::size_t k = (p == UINT32_MAX) ? 0 : 1; k < clause.lits.size(); ++k) {
+            const Lit q = clause.lits[k];
+            const std::uint32_t v = var(q);
+            if (m_seen[v] || m_levels[v] == 0) continue;
+            bump_var(v);
+            m_seen[v] = true;
+            if (m_levels[v] >= decision_level()) {
+                ++path_count;
+            } else {
+                learnt.push_back(q);
+            }
+        }
+
+        // Walk back to the next literal of the current level that took part in the conflict
+        while (!m_seen[var(m_trail[--index])]);
+        p = m_trail[index];
+        conflict = m_reasons[var(p)];
+        m_seen[var(p)] = false;
+        --path_count;
+    } while (path_count > 0);
+    learnt[0] = p ^ 1;
+
+    // Drop literals that are implied by the rest of the clause
+    const std::vector<Lit> analyzed = learnt;
+    std::size_t kept = 1;
+    for (std::size_t k = 1; k < learnt.size(); ++k) {
+        if (!is_redundant(learnt[k])) learnt[kept++] = learnt[k];
+    }
+    learnt.resize(kept);
+    for (const Lit lit : analyzed) m_seen[var(lit)] = false;
+
+    backtrack_level = 0;
+    if (learnt.size() > 1) {
+        std::size_t max_index = 1;
+        for (std::size_t k = 2; k < learnt.size(); ++k) {
+            if (m_levels[var(learnt[k])] > m_levels[var(learnt[max_index])]) max_index = k;
+        }
+        std::swap(learnt[1], learnt[max_index]);
+        backtrack_level = m_levels[var(learnt[1])];
+    }
+}
+
+[[nodiscard]] bool Solver::is_redundant(const Lit lit) const {
+    const ClauseRef reason = m_reasons[var(lit)];
+    if (reason == no_reason) return false;
+    const std::vector<Lit>& lits = m_clauses[reason].lits;
+    for (std::size_t k = 1; k < lits.size(); ++k) {
+        const std::uint32_t v = var(lits[k]);
+        if (!m_seen[v] && m_levels[v] > 0) return false;
+    }
+    return true;
+}
+
+void Solver::backtrack(const std::uint32_t level) {
+    if (decision_level() <= level) return;
+    for (std::size_t k = m_trail.size(); k-- > m_trail_lim[level];) {
+        const Lit lit = m_trail[k];
+        const std::uint32_t v = var(lit);
+        m_values[lit] = 0;
+        m_values[lit ^ 1] = 0;
+        m_reasons[v] = no_reason;
+        m_saved_phase[v] = (lit & 1) == 0;
+        heap_insert(v);
+    }
+    m_trail.resize(m_trail_lim[level]);
+    m_queue_head = m_trail.size();
+    m_trail_lim.resize(level);
+}
+
+// Returns false once every variable is assigned
+[[nodiscard]] bool Solver::decide() {
+    while (!m_heap.empty()) {
+        const std::uint32_t v = heap_pop();
+        if (m_values[2 * v] != 0) continue;
+        ++m_stats.decisions;
+        m_trail_lim.push_back(m_trail.size());
+        enqueue(m_saved_phase[v] ? 2 * v : 2 * v + 1, no_reason);
+        return true;
+    }
+    return false;
+}
+
+[[nodiscard]] bool Solver::is_locked(const ClauseRef cref) const {
+    const Lit first = m_clauses[cref].lits[0];
+    return value(first) == 1 && m_reasons[var(first)] == cref;
+}
+
+// Remove the less active half of the learnt clauses, keeping binary clauses and current reasons
+void Solver::reduce_learnts() {
+    std::ranges::sort(m_learnts, [this](const ClauseRef a, const ClauseRef b) {
+        const bool a_binary = m_clauses[a].lits.size() == 2;
+        const bool b_binary = m_clauses[b].lits.size() == 2;
+        if (a_binary != b_binary) return b_binary;
+        return m_clauses[a].activity < m_clauses[b].activity;
+    });
+
+    const double activity_limit = m_clause_inc / static_cast<double>(m_learnts.size());
+    std::vector<ClauseRef> removed;
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < m_learnts.size(); ++i) {
+        const ClauseRef cref = m_learnts[i];
+        const Clause& clause = m_clauses[cref];
+        if (clause.lits.size() > 2 && !is_locked(cref) &&
+            (i < m_learnts.size() / 2 || clause.activity < activity_limit)) {
+            removed.push_back(cref);
+        } else {
+            m_learnts[kept++] = cref;
+        }
+    }
+    m_learnts.resize(kept);
+
+    for (const ClauseRef cref : removed) m_clauses[cref].lits.clear();
+    for (auto& watchers : m_watches) {
+        std::erase_if(watchers, [this](const Watcher& watcher) { return m_clauses[watcher.cref].lits.empty(); });
+    }
+    m_free_refs.insert(m_free_refs.end(), removed.begin(), removed.end());
+}
+
+[[nodiscard]] SatResult Solver::solve() {
+    const auto start = std::chrono::steady_clock::now();
+    const auto finish = [this, &start](const SatResult result) {
+        m_stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    };
+    if (m_unsat || propagate() != no_reason) {
+        m_unsat = true;
+        return finish(SatResult::UNSATISFIABLE);
+    }
+
+    std::vector<Lit> learnt;
+    std::uint32_t backtrack_level = 0;
+    double max_learnts = std::max(static_cast<double>(m_clauses.size()) / 3, min_learnts);
+    double learnt_adjust = learnt_adjust_start;
+    std::uint64_t restart_number = 0;
+    auto conflicts_until_restart = static_cast<std::uint64_t>(luby(2, restart_number) * restart_base);
+
+    while (true) {
+        const ClauseRef conflict = propagate();
+        if (conflict != no_reason) {
+            ++m_stats.conflicts;
+            if (decision_level() == 0) {
+                m_unsat = true;
+                return finish(SatResult::UNSATISFIABLE);
+            }
+            analyze(conflict, learnt, backtrack_level);
+            backtrack(backtrack_level);
+            if (learnt.size() == 1) {
+                enqueue(learnt[0], no_reason);
+            } else {
+                const ClauseRef cref = store_clause(std::vector<Lit>(learnt), true);
+                attach_clause(cref);
+                m_learnts.push_back(cref);
+                bump_clause(m_clauses[cref]);
+                enqueue(learnt[0], cref);
+                ++m_stats.learnt_clauses;
+            }
+            m_var_inc /= var_decay;
+            m_clause_inc /= clause_decay;
+            if (conflicts_until_restart > 0) --conflicts_until_restart;
+            if (static_cast<double>(m_stats.conflicts) >= learnt_adjust) {
+                learnt_adjust *= learnt_adjust_growth;
+                max_learnts *= learnt_growth;
+            }
+
+            if (m_stats.conflicts % signal_check_interval == 0 && Signal::signal_received()) {
+                backtrack(0);
+                return finish(SatResult::INTERRUPTED);
+            }
+            continue;
+        }
+
+        if (conflicts_until_restart == 0) {
+            ++m_stats.restarts;
+            backtrack(0);
+            conflicts_until_restart = static_cast<std::uint64_t>(luby(2, ++restart_number) * restart_base);
+            continue;
+        }
+        if (static_cast<double>(m_learnts.size()) >= max_learnts + static_cast<double>(m_trail.size())) {
+            reduce_learnts();
+        }
+        if (!decide()) {
+            m_model.assign(m_levels.size(), false);
+            for (std::size_t v = 0; v < m_model.size(); ++v) m_model[v] = m_values[2 * v] == 1;
+            backtrack(0);
+            return finish(SatResult::SATISFIABLE);
+        }
+    }
+}
+
+void Solver::bump_var(const std::uint32_t v) {
+    m_activity[v] += m_var_inc;
+    if (m_activity[v] > 1e100) {
+        for (auto& activity : m_activity) activity *= 1e-100;
+        m_var_inc *= 1e-100;
+    }
+    if (m_heap_index[v] >= 0) heap_up(static_cast<std::size_t>(m_heap_index[v]));
+}
+
+void Solver::bump_clause(Clause& clause) {
+    clause.activity += m_clause_inc;
+    if (clause.activity > 1e20) {
+        for (const ClauseRef cref : m_learnts) m_clauses[cref].activity *= 1e-20;
+        m_clause_inc *= 1e-20;
+    }
+}
+
+void Solver::heap_insert(const std::uint32_t v) {
+    if (m_heap_index[v] >= 0) return;
+    m_heap_index[v] = static_cast<std::int64_t>(m_heap.size());
+    m_heap.push_back(v);
+    heap_up(m_heap.size() - 1);
+}
+
+void Solver::heap_up(std::size_t pos) {
+    const std::uint32_t v = m_heap[pos];
+    while (pos > 0) {
+        const std::size_t parent = (pos - 1) / 2;
+        if (m_activity[m_heap[parent]] >= m_activity[v]) break;
+        m_heap[pos] = m_heap[parent];
+        m_heap_index[m_heap[pos]] = static_cast<std::int64_t>(pos);
+        pos = parent;
+    }
+    m_heap[pos] = v;
+    m_heap_index[v] = static_cast<std::int64_t>(pos);
+}
+
+void Solver::heap_down(std::size_t pos) {
+    const std::uint32_t v = m_heap[pos];
+    while (true) {
+        std::size_t child = 2 * pos + 1;
+        if (child >= m_heap.size()) break;
+        if (child + 1 < m_heap.size() && m_activity[m_heap[child + 1]] > m_activity[m_heap[child]]) ++child;
+        if (m_activity[m_heap[child]] <= m_activity[v]) break;
+        m_heap[pos] = m_heap[child];
+        m_heap_index[m_heap[pos]] = static_cast<std::int64_t>(pos);
+        pos = child;
+    }
+    m_heap[pos] = v;
+    m_heap_index[v] = static_cast<std::int64_t>(pos);
+}
+
+[[nodiscard]] std::uint32_t Solver::heap_pop() {
+    const std::uint32_t top = m_heap[0];
+    m_heap_index[top] = -1;
+    const std::uint32_t last = m_heap.back();
+    m_heap.pop_back();
+    if (!m_heap.empty()) {
+        m_heap[0] = last;
+        m_heap_index[last] = 0;
+        heap_down(0);
+    }
+    return top;
+}
+
+}
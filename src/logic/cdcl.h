@@ -0,0 +1,105 @@
+// Author: Caden LeCluyse
+
+#ifndef CDCL_H
+#define CDCL_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Logic {
+
+enum struct SatResult {
+    SATISFIABLE,
+    UNSATISFIABLE,
+    INTERRUPTED
+};
+
+struct SolverStats {
+    std::uint64_t conflicts = 0;
+    std::uint64_t decisions = 0;
+    std::uint64_t propagations = 0;
+    std::uint64_t restarts = 0;
+    std::uint64_t learnt_clauses = 0;
+    double seconds = 0;
+};
+
+// Conflict driven clause learning solver. Uses two watched literals with blocking literals, first UIP learning with
+// clause minimization, VSIDS branching with phase saving, Luby restarts, and activity based learnt clause deletion
+class Solver {
+   public:
+    explicit Solver(const std::size_t num_vars);
+    // Takes DIMACS literals. Returns false if the formula is already known to be unsatisfiable
+    bool add_clause(std::span<const int> clause);
+    [[nodiscard]] SatResult solve();
+    // Only valid after solve returns SATISFIABLE, indexed by variable
+    [[nodiscard]] const std::vector<bool>& model() const noexcept { return m_model; }
+    [[nodiscard]] const SolverStats& stats() const noexcept { return m_stats; }
+
+   private:
+    using Lit = std::uint32_t;
+    using ClauseRef = std::uint32_t;
+    static constexpr ClauseRef no_reason = UINT32_MAX;
+
+    struct Clause {
+        std::vector<Lit> lits;
+        double activity = 0;
+        bool learnt = false;
+    };
+
+    struct Watcher {
+        ClauseRef cref;
+        Lit blocker;
+    };
+
+    [[nodiscard]] static constexpr std::uint32_t var(const Lit lit) noexcept { return lit >> 1; }
+    [[nodiscard]] std::int8_t value(const Lit lit) const noexcept { return m_values[lit]; }
+    [[nodiscard]] std::uint32_t decision_level() const noexcept {
+        return static_cast<std::uint32_t>(m_trail_lim.size());
+    }
+
+    [[nodiscard]] ClauseRef store_clause(std::vector<Lit>&& lits, const bool learnt);
+    void attach_clause(const ClauseRef cref);
+    void enqueue(const Lit lit, const ClauseRef reason);
+    [[nodiscard]] ClauseRef propagate();
+    void analyze(ClauseRef conflict, std::vector<Lit>& learnt, std::uint32_t& backtrack_level);
+    [[nodiscard]] bool is_redundant(const Lit lit) const;
+    void backtrack(const std::uint32_t level);
+    [[nodiscard]] bool decide();
+    void reduce_learnts();
+    [[nodiscard]] bool is_locked(const ClauseRef cref) const;
+
+    void bump_var(const std::uint32_t v);
+    void bump_clause(Clause& clause);
+    void heap_insert(const std::uint32_t v);
+    void heap_up(std::size_t pos);
+    void heap_down(std::size_t pos);
+    [[nodiscard]] std::uint32_t heap_pop();
+
+    std::vector<Clause> m_clauses;
+    std::vector<ClauseRef> m_free_refs;
+    std::vector<ClauseRef> m_learnts;
+    std::vector<std::vector<Watcher> > m_watches; // Indexed by literal, holds clauses watching its negation
+    std::vector<std::int8_t> m_values;            // Indexed by literal: 1 true, -1 false, 0 unassigned
+    std::vector<std::uint32_t> m_levels;
+    std::vector<ClauseRef> m_reasons;
+    std::vector<bool> m_saved_phase;
+    std::vector<Lit> m_trail;
+    std::vector<std::size_t> m_trail_lim;
+    std::size_t m_queue_head = 0;
+
+    std::vector<double> m_activity;
+    std::vector<std::uint32_t> m_heap;
+    std::vector<std::int64_t> m_heap_index; // -1 when the variable is not in the heap
+    double m_var_inc = 1;
+    double m_clause_inc = 1;
+
+    mutable std::vector<bool> m_seen;
+    std::vector<bool> m_model;
+    SolverStats m_stats;
+    bool m_unsat = false;
+};
+
+}
+
+#endif
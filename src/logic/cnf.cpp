@@ -0,0 +1,189 @@
+// Author: Caden LeCluyse
+
+#include "logic/cnf.h"
+
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <istream>
+#include <iterator>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ast/ast.h"
+#include "ast/bnode.h"
+#include "include/types.hpp"
+
+using namespace Types;
+
+namespace Logic {
+
+namespace {
+
+class TseitinEncoder {
+   public:
+    explicit TseitinEncoder(Cnf& cnf) : m_cnf(cnf) {}
+
+    [[nodiscard]] int leaf(const BoolNodes::BoolNode& node) {
+        if (node.key == Token::VAR) {
+            return static_cast<int>(static_cast<const BoolNodes::VarBNode&>(node).index + 1);
+        }
+        // Constants share a single variable that is forced true
+        if (m_true_literal == 0) {
+            m_true_literal = new_var();
+            m_cnf.clauses.push_back({m_true_literal});
+        }
+        return node.key == Token::TRUE ? m_true_literal : -m_true_literal;
+    }
+
+    // Introduce g <-> (a op b). NAND and NOR reuse AND and OR and negate the output literal
+    [[nodiscard]] int gate(const Token key, const int a, const int b) {
+        const int g = new_var();
+        switch (key) {
+            case Token::AND:
+            case Token::NAND:
+                m_cnf.clauses.push_back({-g, a});
+                m_cnf.clauses.push_back({-g, b});
+                m_cnf.clauses.push_back({g, -a, -b});
+                return key == Token::AND ? g : -g;
+            case Token::OR:
+            case Token::NOR:
+                m_cnf.clauses.push_back({g, -a});
+                m_cnf.clauses.push_back({g, -b});
+                m_cnf.clauses.push_back({-g, a, b});
+                return key == Token::OR ? g : -g;
+            case Token::POW_XOR:
+                m_cnf.clauses.push_back({-g, a, b});
+                m_cnf.clauses.push_back({-g, -a, -b});
+                m_cnf.clauses.push_back({g, -a, b});
+                m_cnf.clauses.push_back({g, a, -b});
+                return g;
+            default:
+                throw std::runtime_error("Invalid opkey: " + std::string{static_cast<char>(key)});
+        }
+    }
+
+   private:
+    [[nodiscard]] int new_var() { return static_cast<int>(++m_cnf.num_vars); }
+
+    Cnf& m_cnf;
+    int m_true_literal = 0;
+};
+
+void skip_line(const char*& itr, const char* const end) {
+    while (itr != end && *itr != '\n') ++itr;
+}
+
+[[nodiscard]] std::optional<std::string> read_header(const char*& itr, const char* const end, Cnf& cnf) {
+    const char* const line_start = itr;
+    skip_line(itr, end);
+    std::istringstream header(std::string(line_start, itr));
+    std::string p;
+    std::string format;
+    long num_vars = -1;
+    long num_clauses = -1;
+    header >> p >> format >> num_vars >> num_clauses;
+    if (!header || p != "p" || format != "cnf" || num_vars < 0 || num_clauses < 0) {
+        return std::optional<std::string>("Invalid DIMACS header: " + std::string(line_start, itr));
+    }
+    cnf.num_vars = static_cast<std::size_t>(num_vars);
+    cnf.clauses.reserve(static_cast<std::size_t>(num_clauses));
+    return std::nullopt;
+}
+
+}  // namespace
+
+// Walk the tree with an explicit stack, keeping the literal for each finished subtree on a second stack
+[[nodiscard]] Cnf tseitin_encode(const BoolAST& tree, const std::size_t num_inputs) {
+    Cnf cnf;
+    cnf.num_vars = num_inputs;
+    if (!tree.root()) return cnf;
+
+    TseitinEncoder encoder(cnf);
+    std::vector<std::pair<const BoolNodes::BoolNode*, bool> > work;
+    std::vector<int> literals;
+    work.emplace_back(tree.root(), false);
+    while (!work.empty()) {
+        const auto [node, expanded] = work.back();
+        work.pop_back();
+        if (!node->m_left_child) {
+            literals.push_back(encoder.leaf(*node));
+            continue;
+        }
+        if (!expanded) {
+            work.emplace_back(node, true);
+            if (node->m_right_child) work.emplace_back(node->m_right_child.get(), false);
+            work.emplace_back(node->m_left_child.get(), false);
+            continue;
+        }
+
+        // NOT doesn't need a gate, just flip the literal
+        if (!node->m_right_child) {
+            literals.back() = -literals.back();
+            continue;
+        }
+        const int right = literals.back();
+        literals.pop_back();
+        literals.back() = encoder.gate(node->key, literals.back(), right);
+    }
+    cnf.clauses.push_back({literals.back()});
+
+    return cnf;
+}
+
+[[nodiscard]] std::optional<std::string> read_dimacs(std::istream& input, Cnf& cnf) {
+    const std::string contents{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+    const char* itr = contents.data();
+    const char* const end = itr + contents.size();
+    bool header_found = false;
+    std::vector<int> clause;
+
+    while (itr != end) {
+        if (std::isspace(static_cast<unsigned char>(*itr))) {
+            ++itr;
+            continue;
+        }
+        if (*itr == 'c') {
+            skip_line(itr, end);
+            continue;
+        }
+        if (*itr == '%') break; // SATLIB benchmarks end with a % line
+        if (*itr == 'p') {
+            if (header_found) return std::optional<std::string>("Duplicate DIMACS header");
+            const auto header_error = read_header(itr, end, cnf);
+            if (header_error) return header_error;
+            header_found = true;
+            continue;
+        }
+        if (!header_found) return std::optional<std::string>("Clause found before the DIMACS header");
+
+        int literal = 0;
+        const auto [next, error] = std::from_chars(itr, end, literal);
+        if (error != std::errc()) {
+            const char* line_end = itr;
+            skip_line(line_end, end);
+            return std::optional<std::string>("Invalid literal in DIMACS file: " + std::string(itr, line_end));
+        }
+        itr = next;
+        if (literal == 0) {
+            cnf.clauses.push_back(std::move(clause));
+            clause.clear();
+            continue;
+        }
+        if (static_cast<std::size_t>(std::labs(literal)) > cnf.num_vars) {
+            return std::optional<std::string>("Literal " + std::to_string(literal) +
+                                              " exceeds the variable count in the header");
+        }
+        clause.push_back(literal);
+    }
+
+    if (!header_found) return std::optional<std::string>("Missing DIMACS header");
+    if (!clause.empty()) cnf.clauses.push_back(std::move(clause)); // Tolerate a missing final 0
+    return std::nullopt;
+}
+
+}
@@ -0,0 +1,28 @@
+// Author: Caden LeCluyse
+
+#ifndef CNF_H
+#define CNF_H
+
+#include <istream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ast/ast.h"
+
+namespace Logic {
+
+// Literals use the DIMACS convention: variable v is v + 1, and its negation is -(v + 1)
+struct Cnf {
+    std::size_t num_vars = 0;
+    std::vector<std::vector<int> > clauses;
+};
+
+// Converts a symbolic boolean tree into an equisatisfiable CNF. The first num_inputs variables of the result are
+// the variables of the expression, the rest are gate variables introduced by the encoding
+[[nodiscard]] Cnf tseitin_encode(const BoolAST& tree, const std::size_t num_inputs);
+[[nodiscard]] std::optional<std::string> read_dimacs(std::istream& input, Cnf& cnf);
+
+}
+
+#endif
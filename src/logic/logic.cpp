@@ -0,0 +1,364 @@
+// Author: Caden LeCluyse
+
+#include "logic/logic.h"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast/ast.h"
+#include "include/types.hpp"
+#include "logic/anf.h"
+#include "logic/bitslice.h"
+#include "logic/cdcl.h"
+#include "logic/cnf.h"
+#include "logic/minimize.h"
+#include "parser/parser.h"
+#include "ui/ui.h"
+
+using namespace Types;
+
+namespace Logic {
+
+namespace {
+
+struct Command {
+    std::string_view name;
+    std::string_view argument;
+};
+
+[[nodiscard]] constexpr std::string_view trim(std::string_view input) noexcept {
+    while (!input.empty() && std::isspace(static_cast<unsigned char>(input.front()))) input.remove_prefix(1);
+    while (!input.empty() && std::isspace(static_cast<unsigned char>(input.back()))) input.remove_suffix(1);
+    return input;
+}
+
+[[nodiscard]] constexpr Command split_command(const std::string_view input) noexcept {
+    const std::string_view trimmed = trim(input);
+    const auto space = trimmed.find(' ');
+    if (space == std::string_view::npos) return Command{trimmed, ""};
+    return Command{trimmed.substr(0, space), trim(trimmed.substr(space + 1))};
+}
+
+[[nodiscard]] bool iequals(const std::string_view left, const std::string_view right) noexcept {
+    return std::ranges::equal(left, right, [](const char a, const char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+    });
+}
+
+[[nodiscard]] bool is_dimacs_path(const std::string_view argument) noexcept {
+    return argument.ends_with(".cnf") || argument.ends_with(".dimacs");
+}
+
+// Strip the spaces and uppercase the expression, the same way the engine normalizes its input
+[[nodiscard]] std::string normalize(const std::string_view argument) {
+    std::string expression(argument);
+    std::erase(expression, ' ');
+    std::ranges::transform(expression, expression.begin(), [](const auto c) { return std::toupper(c); });
+    return expression;
+}
+
+void print_time(const double seconds) {
+    std::ostringstream output;
+    output.setf(std::ios::fixed);
+    output.precision(3);
+    output << "Time: " << seconds * 1000 << " ms\n";
+    std::cout << output.str();
+}
+
+void print_solver_stats(const Cnf& cnf, const SolverStats& stats) {
+    const double conflict_rate = stats.seconds > 0 ? static_cast<double>(stats.conflicts) / stats.seconds : 0;
+    std::ostringstream output;
+    output.setf(std::ios::fixed);
+    output.precision(0);
+    output << "Variables: " << cnf.num_vars << ", Clauses: " << cnf.clauses.size() << '\n'
+           << "Conflicts: " << stats.conflicts << " (" << conflict_rate << "/s), Decisions: " << stats.decisions
+           << ", Propagations: " << stats.propagations << ", Restarts: " << stats.restarts
+           << ", Learnt clauses: " << stats.learnt_clauses << '\n';
+    std::cout << output.str();
+    print_time(stats.seconds);
+}
+
+[[nodiscard]] SatResult solve_cnf(const Cnf& cnf, Solver& solver) {
+    for (const auto& clause : cnf.clauses) {
+        if (!solver.add_clause(clause)) break;
+    }
+    const SatResult result = solver.solve();
+    switch (result) {
+        case SatResult::SATISFIABLE:
+            UI::print_result("Satisfiable");
+            break;
+        case SatResult::UNSATISFIABLE:
+            UI::print_result("Unsatisfiable");
+            break;
+        case SatResult::INTERRUPTED:
+            UI::print_error("SAT solver interrupted");
+            break;
+    }
+    print_solver_stats(cnf, solver.stats());
+    return result;
+}
+
+bool sat_expression(const std::string_view argument) {
+    const std::string expression = normalize(argument);
+    const ParseResult result = Parse::create_symbolic_postfix(expression);
+    if (!result.success) {
+        UI::print_error(result.error_msg);
+        return false;
+    }
+
+    BoolAST tree;
+    tree.build_ast(result.result);
+    const Cnf cnf = tseitin_encode(tree, result.variables.size());
+    Solver solver(cnf.num_vars);
+    const SatResult sat_result = solve_cnf(cnf, solver);
+    if (sat_result == SatResult::INTERRUPTED) return false;
+    if (sat_result == SatResult::SATISFIABLE) {
+        // Only report the variables of the expression, not the gates from the encoding
+        for (std::size_t i = 0; i < result.variables.size(); ++i) {
+            std::cout << result.variables[i] << ": " << (solver.model()[i] ? "True" : "False") << '\n';
+        }
+    }
+    return true;
+}
+
+// Models for DIMACS input use the competition format: v lines of literals terminated by 0
+bool sat_dimacs(const std::string_view path) {
+    std::ifstream input_file{std::string(path)};
+    if (!input_file.is_open()) {
+        UI::print_error("Couldn't open " + std::string(path));
+        return false;
+    }
+    Cnf cnf;
+    const auto read_error = read_dimacs(input_file, cnf);
+    if (read_error) {
+        UI::print_error(*read_error);
+        return false;
+    }
+
+    Solver solver(cnf.num_vars);
+    const SatResult sat_result = solve_cnf(cnf, solver);
+    if (sat_result == SatResult::INTERRUPTED) return false;
+    if (sat_result == SatResult::SATISFIABLE) {
+        static constexpr std::size_t literals_per_line = 16;
+        std::ostringstream output;
+        output << 'v';
+        for (std::size_t v = 0; v < cnf.num_vars; ++v) {
+            if (v && v % literals_per_line == 0) output << "\nv";
+            output << ' ' << (solver.model()[v] ? "" : "-") << v + 1;
+        }
+        output << " 0\n";
+        std::cout << output.str();
+    }
+    return true;
+}
+
+// Writes the polynomial with & for multiplication and ^ for addition, T being the constant term. AND and XOR share
+// a precedence level in the parser, so products are parenthesized whenever there's more than one monomial
+[[nodiscard]] std::string format_anf(const std::vector<std::uint64_t>& coefficients,
+                                     const std::vector<std::string>& variables, const AnfSummary& summary) {
+    static constexpr std::uint64_t max_printed_monomials = 64;
+    if (summary.monomials == 0) return "F";
+
+    std::string polynomial;
+    std::uint64_t printed = 0;
+    for (std::size_t w = 0; w < coefficients.size() && printed < max_printed_monomials; ++w) {
+        std::uint64_t word = coefficients[w];
+        while (word && printed < max_printed_monomials) {
+            std::uint64_t monomial = w * 64 + static_cast<std::uint64_t>(std::countr_zero(word));
+            word &= word - 1;
+            if (printed++) polynomial += " ^ ";
+            if (!monomial) {
+                polynomial += 'T';
+                continue;
+            }
+            const bool parenthesize = summary.monomials > 1 && std::popcount(monomial) > 1;
+            if (parenthesize) polynomial += '(';
+            for (bool first = true; monomial; monomial &= monomial - 1, first = false) {
+                if (!first) polynomial += '&';
+                polynomial += variables[static_cast<std::size_t>(std::countr_zero(monomial))];
+            }
+            if (parenthesize) polynomial += ')';
+        }
+    }
+    if (summary.monomials > printed) {
+        polynomial += " ^ ... (" + std::to_string(summary.monomials - printed) + " more monomials)";
+    }
+    return polynomial;
+}
+
+// The truth table is built with the bit sliced evaluator, then transformed into the ANF in place
+bool anf_expression(const std::string_view argument, const unsigned threads) {
+    const std::string expression = normalize(argument);
+    const ParseResult result = Parse::create_symbolic_postfix(expression);
+    if (!result.success) {
+        UI::print_error(result.error_msg);
+        return false;
+    }
+    const std::size_t num_vars = result.variables.size();
+    if (num_vars > max_truth_table_vars) {
+        UI::print_error("anf supports at most " + std::to_string(max_truth_table_vars) + " variables, received " +
+                        std::to_string(num_vars));
+        return false;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    BoolAST tree;
+    tree.build_ast(result.result);
+    try {
+        std::vector<std::uint64_t> table = truth_table(compile_bitsliced(tree, num_vars), threads);
+        mobius_transform(table, num_vars, threads);
+        const AnfSummary summary = summarize_anf(table);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        UI::print_result(format_anf(table, result.variables, summary));
+        std::cout << "Degree: " << summary.degree << ", Monomials: " << summary.monomials << '\n';
+        print_time(seconds);
+    } catch (const std::bad_alloc&) {
+        UI::print_error("Not enough memory for a truth table over " + std::to_string(num_vars) + " variables");
+        return false;
+    }
+    return true;
+}
+
+// Products are joined with & and sums with |. AND and OR share a precedence level in the parser,
+// so products are parenthesized whenever there's more than one of them
+[[nodiscard]] std::string format_sop(const std::vector<Cube>& cubes, const std::vector<std::string>& variables) {
+    if (cubes.empty()) return "F";
+
+    std::string sop;
+    for (std::size_t i = 0; i < cubes.size(); ++i) {
+        std::string product;
+        std::size_t literals = 0;
+        for (std::size_t var = 0; var < variables.size(); ++var) {
+            const std::uint32_t bit = std::uint32_t{1} << var;
+            if (cubes[i].mask & bit) continue;
+            if (literals++) product += '&';
+            if (!(cubes[i].value & bit)) product += '!';
+            product += variables[var];
+        }
+        if (!literals) product = "T";
+
+        if (i) sop += " | ";
+        sop += cubes.size() > 1 && literals > 1 ? '(' + product + ')' : product;
+    }
+    return sop;
+}
+
+[[nodiscard]] std::size_t count_literals(const std::vector<Cube>& cubes, const std::size_t num_vars) {
+    std::size_t literals = 0;
+    for (const Cube cube : cubes) literals += num_vars - static_cast<std::size_t>(std::popcount(cube.mask));
+    return literals;
+}
+
+[[nodiscard]] std::size_t count_literals(const BitProgram& program) {
+    return static_cast<std::size_t>(std::ranges::count_if(program.code, [](const BitProgram::Instruction& instruction) {
+        return instruction.op == BitProgram::Op::LOAD_VAR;
+    }));
+}
+
+// The best of a few runs, since the two times are compared
+[[nodiscard]] double time_truth_table(const BitProgram& program, const unsigned threads) {
+    static constexpr int runs = 3;
+    double best = std::numeric_limits<double>::infinity();
+    for (int run = 0; run < runs; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        [[maybe_unused]] const auto table = truth_table(program, threads);
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+// The cover is checked against the truth table of the input before it is printed, and both are timed
+// on the bit sliced evaluator. The cover is only a heuristic, and a sum of products can take far more literals
+// than a factored input, so the input is kept when the cover has more literals or evaluates slower
+bool minimize_expression(const std::string_view argument, const unsigned threads) {
+    const std::string expression = normalize(argument);
+    const ParseResult result = Parse::create_symbolic_postfix(expression);
+    if (!result.success) {
+        UI::print_error(result.error_msg);
+        return false;
+    }
+    const std::size_t num_vars = result.variables.size();
+    if (num_vars > max_minimize_vars) {
+        UI::print_error("minimize supports at most " + std::to_string(max_minimize_vars) + " variables, received " +
+                        std::to_string(num_vars));
+        return false;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    BoolAST tree;
+    tree.build_ast(result.result);
+    try {
+        const BitProgram original = compile_bitsliced(tree, num_vars);
+        const std::vector<std::uint64_t> table = truth_table(original, threads);
+        const Cover cover = minimize(table, num_vars, threads);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const BitProgram minimized = compile_sop(cover.cubes, num_vars);
+        if (truth_table(minimized, threads) != table) {
+            UI::print_error("Minimized expression doesn't match the input");
+            return false;
+        }
+
+        const std::size_t original_literals = count_literals(original);
+        const std::size_t cover_literals = count_literals(cover.cubes, num_vars);
+        const double original_seconds = time_truth_table(original, threads);
+        const double cover_seconds = time_truth_table(minimized, threads);
+        // Tiny truth tables take a few microseconds either way, so only a clear slowdown counts
+        static constexpr double slowdown_ratio = 1.25;
+        static constexpr double slowdown_seconds = 1e-4;
+        const bool slower = cover_seconds > original_seconds * slowdown_ratio &&
+                            cover_seconds - original_seconds > slowdown_seconds;
+        const bool keep_input = cover_literals > original_literals || slower;
+
+        std::ostringstream output;
+        output.setf(std::ios::fixed);
+        output.precision(3);
+        output << "Minterms: " << cover.num_minterms << ", Prime implicants: " << cover.num_primes
+               << ", Terms: " << cover.cubes.size() << '\n'
+               << "Literals: " << original_literals << " -> " << cover_literals << '\n'
+               << "Evaluation: " << original_seconds * 1000 << " ms -> " << cover_seconds * 1000 << " ms\n";
+        if (keep_input) {
+            output << "The sum of products " << (cover_literals > original_literals ? "has more literals" : "is slower")
+                   << " than the input, so the input is kept\n";
+        }
+        UI::print_result(keep_input ? expression : format_sop(cover.cubes, result.variables));
+        std::cout << output.str();
+        print_time(seconds);
+    } catch (const std::bad_alloc&) {
+        UI::print_error("Not enough memory to minimize over " + std::to_string(num_vars) + " variables");
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+[[nodiscard]] bool is_logic_command(const std::string_view input) {
+    const std::string_view name = split_command(input).name;
+    return iequals(name, "sat") || iequals(name, "anf") || iequals(name, "minimize");
+}
+
+bool run_logic_command(const std::string_view input, const unsigned threads) {
+    const Command command = split_command(input);
+    if (command.argument.empty()) {
+        UI::print_error("Expected an expression after " + std::string(command.name));
+        return false;
+    }
+    if (iequals(command.name, "anf")) return anf_expression(command.argument, threads);
+    if (iequals(command.name, "minimize")) return minimize_expression(command.argument, threads);
+    if (is_dimacs_path(command.argument)) return sat_dimacs(command.argument);
+    return sat_expression(command.argument);
+}
+
+}
@@ -0,0 +1,18 @@
+// Author: Caden LeCluyse
+
+#ifndef LOGIC_H
+#define LOGIC_H
+
+#include <string_view>
+
+namespace Logic {
+
+// Logic commands take a symbolic boolean expression (or a file) instead of something to evaluate
+[[nodiscard]] bool is_logic_command(const std::string_view input);
+// Truth tables and prime implicants are split across threads threads, 0 for one per core, like the threads setting.
+// Returns false if the command failed
+bool run_logic_command(const std::string_view input, const unsigned threads);
+
+}
+
+#endif
@@ -0,0 +1,285 @@
+// Author: Caden LeCluyse
+
+#include "logic/minimize.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "logic/bitslice.h"
+#include "parallel/pool.h"
+
+namespace Logic {
+
+namespace {
+
+[[nodiscard]] constexpr std::uint64_t pack(const Cube cube) noexcept {
+    return (static_cast<std::uint64_t>(cube.mask) << 32) | cube.value;
+}
+
+[[nodiscard]] constexpr Cube unpack(const std::uint64_t key) noexcept {
+    return Cube{static_cast<std::uint32_t>(key), static_cast<std::uint32_t>(key >> 32)};
+}
+
+[[nodiscard]] constexpr std::size_t num_literals(const Cube cube, const std::size_t num_vars) noexcept {
+    return num_vars - static_cast<std::size_t>(std::popcount(cube.mask));
+}
+
+[[nodiscard]] bool test_bit(const std::vector<std::uint64_t>& bits, const std::uint32_t index) noexcept {
+    return (bits[index >> 6] >> (index & 63)) & 1;
+}
+
+// Calls function on every minterm the cube covers by walking the subsets of its dashes
+template <typename Function>
+void for_each_minterm(const Cube cube, Function&& function) {
+    std::uint32_t subset = 0;
+    do {
+        function(cube.value | subset);
+        subset = (subset - cube.mask) & cube.mask;
+    } while (subset != 0);
+}
+
+// Primes of the tables that fit in a word, one map per number of variables. Deep in the recursion
+// the same small cofactors come up over and over
+using PrimeCache = std::array<std::unordered_map<std::uint64_t, std::vector<std::uint64_t>>, 7>;
+
+// Splitting f on its top variable x into f0 and f1, every prime of f is either a prime of f0 & f1 with x dropped,
+// or a prime of f0 (f1) with the literal !x (x) added when it isn't also a prime of f0 & f1. Only primes are ever
+// built, so dense functions don't blow up the way merging minterms level by level does. The top variable is the
+// highest bit of the index, so the cofactors are the two halves of the table
+[[nodiscard]] std::vector<std::uint64_t> primes_of(const std::vector<std::uint64_t>& table, const std::size_t num_vars,
+                                                   const std::size_t depth, const unsigned threads,
+                                                   PrimeCache& cache) {
+    // Levels this close to the root run their cofactors on separate threads
+    static constexpr std::size_t parallel_depth = 2;
+
+    const std::uint64_t used_bits = num_vars >= 6 ? ~std::uint64_t{0} : (std::uint64_t{1} << (1U << num_vars)) - 1;
+    if (std::ranges::all_of(table, [](const std::uint64_t word) { return word == 0; })) return {};
+    if (std::ranges::all_of(table, [used_bits](const std::uint64_t word) { return word == used_bits; })) {
+        return {pack(Cube{0, static_cast<std::uint32_t>((std::uint64_t{1} << num_vars) - 1)})};
+    }
+    if (num_vars <= 6) {
+        const auto cached = cache[num_vars].find(table[0]);
+        if (cached != cache[num_vars].end()) return cached->second;
+    }
+
+    // f0, f1, then f0 & f1
+    const std::size_t top = num_vars - 1;
+    std::vector<std::uint64_t> cofactors[3];
+    if (num_vars > 6) {
+        const std::size_t half = table.size() / 2;
+        cofactors[0].assign(table.begin(), table.begin() + static_cast<std::ptrdiff_t>(half));
+        cofactors[1].assign(table.begin() + static_cast<std::ptrdiff_t>(half), table.end());
+        cofactors[2].resize(half);
+        for (std::size_t w = 0; w < half; ++w) cofactors[2][w] = cofactors[0][w] & cofactors[1][w];
+    } else {
+        const unsigned half = 1U << top;
+        const std::uint64_t half_bits = (std::uint64_t{1} << half) - 1;
+        cofactors[0] = {table[0] & half_bits};
+        cofactors[1] = {(table[0] >> half) & half_bits};
+        cofactors[2] = {cofactors[0][0] & cofactors[1][0]};
+    }
+
+    // When one cofactor contains the other, f0 & f1 is the smaller one and its primes don't need to be found twice
+    std::size_t solve_begin = 0;
+    std::size_t solve_end = 3;
+    std::size_t meet = 2;
+    if (cofactors[2] == cofactors[0]) {
+        meet = 0;
+        solve_end = 2;
+    } else if (cofactors[2] == cofactors[1]) {
+        meet = 1;
+        solve_end = 2;
+    }
+    const bool same = cofactors[0] == cofactors[1];
+    if (same) solve_begin = 1;
+
+    std::vector<std::uint64_t> primes[3];
+    const auto solve = [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t i = solve_begin + begin; i < solve_begin + end; ++i) {
+            if (depth < parallel_depth) {
+                PrimeCache local_cache;
+                primes[i] = primes_of(cofactors[i], top, depth + 1, threads, local_cache);
+            } else {
+                primes[i] = primes_of(cofactors[i], top, depth + 1, threads, cache);
+            }
+        }
+    };
+    if (depth < parallel_depth) {
+        // On the shared pool, which hands the first exception, like bad_alloc, back to this thread
+        Parallel::run(solve_end - solve_begin, threads, [&solve](const std::size_t i) { solve(i, i + 1); });
+    } else {
+        solve(0, solve_end - solve_begin);
+    }
+
+    const std::uint64_t top_bit = std::uint64_t{1} << top;
+    std::vector<std::uint64_t> result;
+    if (same) {
+        // f doesn't depend on x
+        result = std::move(primes[1]);
+        for (auto& prime : result) prime |= top_bit << 32;
+        return result;
+    }
+
+    const std::vector<std::uint64_t>& meet_primes = primes[meet];
+    result.reserve(primes[0].size() + primes[1].size() + meet_primes.size());
+    for (const std::uint64_t prime : meet_primes) result.push_back(prime | (top_bit << 32));
+    if (meet != 0) {
+        for (const std::uint64_t prime : primes[0]) {
+            if (!std::ranges::binary_search(meet_primes, prime)) result.push_back(prime);
+        }
+    }
+    if (meet != 1) {
+        for (const std::uint64_t prime : primes[1]) {
+            if (!std::ranges::binary_search(meet_primes, prime)) result.push_back(prime | top_bit);
+        }
+    }
+    std::ranges::sort(result);
+    if (num_vars <= 6) cache[num_vars].emplace(table[0], result);
+    return result;
+}
+
+struct Candidate {
+    std::size_t uncovered;
+    std::size_t literals;
+    std::size_t index;
+
+    // The queue pops the candidate covering the most minterms, then the one with the fewest literals
+    [[nodiscard]] bool operator<(const Candidate& other) const noexcept {
+        if (uncovered != other.uncovered) return uncovered < other.uncovered;
+        return literals > other.literals;
+    }
+};
+
+[[nodiscard]] std::vector<Cube> select_cover(const std::vector<Cube>& primes, const std::size_t num_vars) {
+    const std::size_t num_points = std::size_t{1} << num_vars;
+
+    // How many primes cover each minterm, which finds the essential primes
+    std::vector<std::uint32_t> cover_count(num_points, 0);
+    for (const Cube prime : primes) {
+        for_each_minterm(prime, [&cover_count](const std::uint32_t minterm) { ++cover_count[minterm]; });
+    }
+
+    std::vector<std::uint64_t> covered((num_points + 63) / 64, 0);
+    std::vector<bool> essential(primes.size(), false);
+    std::vector<std::size_t> chosen;
+    const auto select = [&](const std::size_t index) {
+        chosen.push_back(index);
+        for_each_minterm(primes[index], [&covered](const std::uint32_t minterm) {
+            covered[minterm >> 6] |= std::uint64_t{1} << (minterm & 63);
+        });
+    };
+    const auto uncovered = [&](const std::size_t index) {
+        std::size_t count = 0;
+        for_each_minterm(primes[index], [&](const std::uint32_t minterm) { count += !test_bit(covered, minterm); });
+        return count;
+    };
+
+    for (std::size_t i = 0; i < primes.size(); ++i) {
+        for_each_minterm(primes[i], [&](const std::uint32_t minterm) {
+            if (cover_count[minterm] == 1) essential[i] = true;
+        });
+        if (essential[i]) select(i);
+    }
+
+    // Greedy cover of what the essential primes left. Counts only go down, so stale entries are re-queued
+    std::priority_queue<Candidate> queue;
+    for (std::size_t i = 0; i < primes.size(); ++i) {
+        if (essential[i]) continue;
+        const std::size_t count = uncovered(i);
+        if (count) queue.push(Candidate{count, num_literals(primes[i], num_vars), i});
+    }
+    while (!queue.empty()) {
+        Candidate candidate = queue.top();
+        queue.pop();
+        const std::size_t count = uncovered(candidate.index);
+        if (count == 0) continue;
+        if (count < candidate.uncovered) {
+            candidate.uncovered = count;
+            queue.push(candidate);
+            continue;
+        }
+        select(candidate.index);
+    }
+
+    // A greedy pick can end up covered by later picks, so drop those, latest first
+    std::ranges::fill(cover_count, 0);
+    for (const std::size_t index : chosen) {
+        for_each_minterm(primes[index], [&cover_count](const std::uint32_t minterm) { ++cover_count[minterm]; });
+    }
+    std::vector<Cube> cubes;
+    for (auto itr = chosen.rbegin(); itr != chosen.rend(); ++itr) {
+        bool redundant = !essential[*itr];
+        if (redundant) {
+            for_each_minterm(primes[*itr], [&](const std::uint32_t minterm) {
+                if (cover_count[minterm] < 2) redundant = false;
+            });
+        }
+        if (redundant) {
+            for_each_minterm(primes[*itr], [&cover_count](const std::uint32_t minterm) { --cover_count[minterm]; });
+            continue;
+        }
+        cubes.push_back(primes[*itr]);
+    }
+
+    std::ranges::sort(cubes, [num_vars](const Cube a, const Cube b) {
+        const std::size_t a_literals = num_literals(a, num_vars);
+        const std::size_t b_literals = num_literals(b, num_vars);
+        if (a_literals != b_literals) return a_literals < b_literals;
+        // Then by the first variable the cubes differ on, so terms read in the order the variables appeared
+        const std::uint32_t mask_diff = a.mask ^ b.mask;
+        if (mask_diff) return !(a.mask & (mask_diff & (~mask_diff + 1)));
+        const std::uint32_t value_diff = a.value ^ b.value;
+        return (a.value & (value_diff & (~value_diff + 1))) != 0;
+    });
+    return cubes;
+}
+
+}  // namespace
+
+[[nodiscard]] Cover minimize(const std::vector<std::uint64_t>& table, const std::size_t num_vars,
+                             const unsigned threads) {
+    Cover cover;
+    for (const std::uint64_t word : table) cover.num_minterms += static_cast<std::size_t>(std::popcount(word));
+    if (cover.num_minterms == 0) return cover;
+
+    PrimeCache cache;
+    std::vector<Cube> primes;
+    for (const std::uint64_t prime : primes_of(table, num_vars, 0, threads, cache)) primes.push_back(unpack(prime));
+    cover.num_primes = primes.size();
+    cover.cubes = select_cover(primes, num_vars);
+    return cover;
+}
+
+[[nodiscard]] BitProgram compile_sop(const std::vector<Cube>& cubes, const std::size_t num_vars) {
+    BitProgram program;
+    program.num_vars = num_vars;
+    if (cubes.empty()) {
+        program.code.push_back(BitProgram::Instruction{BitProgram::Op::LOAD_FALSE});
+        program.max_stack = 1;
+        return program;
+    }
+
+    for (std::size_t i = 0; i < cubes.size(); ++i) {
+        const Cube cube = cubes[i];
+        std::size_t literals = 0;
+        for (std::uint32_t var = 0; var < num_vars; ++var) {
+            const std::uint32_t bit = std::uint32_t{1} << var;
+            if (cube.mask & bit) continue;
+            program.code.push_back(BitProgram::Instruction{BitProgram::Op::LOAD_VAR, var});
+            if (!(cube.value & bit)) program.code.push_back(BitProgram::Instruction{BitProgram::Op::NOT});
+            if (literals++) program.code.push_back(BitProgram::Instruction{BitProgram::Op::AND});
+        }
+        if (!literals) program.code.push_back(BitProgram::Instruction{BitProgram::Op::LOAD_TRUE});
+        if (i) program.code.push_back(BitProgram::Instruction{BitProgram::Op::OR});
+    }
+    program.max_stack = cubes.size() > 1 ? 3 : 2;
+    return program;
+}
+
+}
@@ -0,0 +1,38 @@
+// Author: Caden LeCluyse
+
+#ifndef MINIMIZE_H
+#define MINIMIZE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "logic/bitslice.h"
+
+namespace Logic {
+
+// Two level minimization enumerates minterms, so it stays well below the truth table limit
+inline constexpr std::size_t max_minimize_vars = 24;
+
+// A product term. Bit i of mask is set when variable i doesn't appear, otherwise bit i of value is its polarity
+struct Cube {
+    std::uint32_t value = 0;
+    std::uint32_t mask = 0;
+};
+
+struct Cover {
+    std::vector<Cube> cubes;
+    std::size_t num_minterms = 0;
+    std::size_t num_primes = 0;
+};
+
+// Prime implicants are found by recursive Shannon expansion of the truth table, with the top levels spread across
+// up to threads threads, 0 for one per core. The cover is the essential primes, a greedy pass over the remaining
+// minterms, then removal of redundant terms
+[[nodiscard]] Cover minimize(const std::vector<std::uint64_t>& table, const std::size_t num_vars,
+                             const unsigned threads);
+// Stack code for the sum of products, so it can run through the bit sliced evaluator
+[[nodiscard]] BitProgram compile_sop(const std::vector<Cube>& cubes, const std::size_t num_vars);
+
+}
+
+#endif
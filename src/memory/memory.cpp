@@ -0,0 +1,390 @@
+// Author: Caden LeCluyse
+
+#include "memory/memory.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <gmp.h>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+
+namespace Memory {
+
+namespace {
+
+inline constexpr std::int64_t no_limit = std::numeric_limits<std::int64_t>::max();
+
+// held is signed, a number allocated on one thread can be freed on another
+struct ThreadUsage {
+    std::int64_t held = 0;
+    std::int64_t peak = 0;
+    std::size_t allocated = 0;
+    std::int64_t limit = no_limit; // Holding more than this is over the budget
+    bool exceeded = false;
+    Shared* shared = nullptr; // Charged as well while the thread works on split up work with a limit
+};
+
+thread_local ThreadUsage usage_state;
+std::atomic<bool> installed{false};
+Allocator installed_allocator = Allocator::MALLOC;
+
+// Pooled blocks are rounded up to a multiple of 16 bytes, which keeps them aligned for limbs. A 64 bit MPFR number
+// is 16 bytes, and one at the default 320 bits is 48
+inline constexpr std::size_t pool_granularity = 16;
+inline constexpr std::size_t num_size_classes = 32;
+inline constexpr std::size_t max_pooled_size = pool_granularity * num_size_classes;
+inline constexpr std::size_t chunk_size = 64 * 1024;
+
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+// New blocks are cut from the current chunk. Chunks are never given back to the system, a block freed on another
+// thread just joins that thread's free list. It's trivially destructible, so numbers freed while the thread is
+// being torn down still have somewhere to go
+struct Pool {
+    std::array<FreeBlock*, num_size_classes> free_lists{};
+    char* chunk_next = nullptr;
+    char* chunk_end = nullptr;
+};
+
+// What's left of a chunk an exited thread was cutting blocks from, with the link kept in the chunk itself
+struct SpareChunk {
+    SpareChunk* next;
+    char* end;
+};
+
+thread_local Pool thread_pool;
+// What exited threads left behind, taken over by the next thread that runs out of blocks. Every spare chunk has
+// room for a block of any pooled size
+std::mutex spare_mutex;
+std::array<FreeBlock*, num_size_classes> spare_free_lists{};
+SpareChunk* spare_chunks = nullptr;
+
+// Sizes of 0 wrap around and go to malloc along with the big ones
+[[nodiscard]] bool pooled(const std::size_t size) { return size - 1 < max_pooled_size; }
+[[nodiscard]] std::size_t size_class(const std::size_t size) { return (size - 1) / pool_granularity; }
+
+// Puts the blocks of from in front of the ones already in to
+void splice(FreeBlock*& to, FreeBlock* const from) {
+    if (!from) return;
+    FreeBlock* last = from;
+    while (last->next) last = last->next;
+    last->next = to;
+    to = from;
+}
+
+// Moves up to max blocks from the front of from to the front of to
+void take_blocks(FreeBlock*& to, FreeBlock*& from, const std::size_t max) {
+    if (!from) return;
+    FreeBlock* last = from;
+    for (std::size_t taken = 1; taken < max && last->next; ++taken) last = last->next;
+    FreeBlock* const rest = last->next;
+    last->next = to;
+    to = from;
+    from = rest;
+}
+
+// Cuts what's left of the pool's chunk into free blocks, so it isn't lost when the chunk is replaced. Chunks and
+// blocks are multiples of pool_granularity, so what's left is too
+void free_chunk_end(Pool& pool, std::array<FreeBlock*, num_size_classes>& free_lists) {
+    while (pool.chunk_next != pool.chunk_end) {
+        const std::size_t bytes = std::min(static_cast<std::size_t>(pool.chunk_end - pool.chunk_next), max_pooled_size);
+        FreeBlock*& free_list = free_lists[size_class(bytes)];
+        free_list = new (pool.chunk_next) FreeBlock{free_list};
+        pool.chunk_next += bytes;
+    }
+}
+
+void give_to_spare() {
+    Pool& pool = thread_pool;
+    const std::lock_guard<std::mutex> lock(spare_mutex);
+    for (std::size_t i = 0; i < num_size_classes; ++i) splice(spare_free_lists[i], pool.free_lists[i]);
+    if (static_cast<std::size_t>(pool.chunk_end - pool.chunk_next) >= max_pooled_size) {
+        spare_chunks = new (pool.chunk_next) SpareChunk{spare_chunks, pool.chunk_end};
+    } else {
+        free_chunk_end(pool, spare_free_lists);
+    }
+    pool = Pool{};
+}
+
+// Called when the thread's chunk is too small for the next block. Up to a chunk's worth of blocks of each size are
+// taken, so threads that run out at the same time all get some instead of the first one taking everything
+void take_spare() {
+    Pool& pool = thread_pool;
+    const std::lock_guard<std::mutex> lock(spare_mutex);
+    for (std::size_t i = 0; i < num_size_classes; ++i) {
+        take_blocks(pool.free_lists[i], spare_free_lists[i], chunk_size / ((i + 1) * pool_granularity));
+    }
+    if (SpareChunk* const chunk = spare_chunks) {
+        spare_chunks = chunk->next;
+        char* const end = chunk->end;
+        free_chunk_end(pool, pool.free_lists);
+        pool.chunk_next = reinterpret_cast<char*>(chunk);
+        pool.chunk_end = end;
+    }
+}
+
+// Made the first time a thread needs a chunk, so only threads that pooled something hand their blocks over
+struct SpareReturner {
+    ~SpareReturner() { give_to_spare(); }
+};
+
+// Every allocation GMP and MPFR make goes through these, so they're kept to a few additions
+void add(const std::size_t bytes) {
+    ThreadUsage& state = usage_state;
+    state.held += static_cast<std::int64_t>(bytes);
+    state.allocated += bytes;
+    if (state.held > state.peak) {
+        state.peak = state.held;
+        if (state.held > state.limit) state.exceeded = true;
+    }
+    if (state.shared && !state.shared->charge(static_cast<std::int64_t>(bytes))) state.exceeded = true;
+}
+
+void remove(const std::size_t bytes) {
+    ThreadUsage& state = usage_state;
+    state.held -= static_cast<std::int64_t>(bytes);
+    if (state.shared) static_cast<void>(state.shared->charge(-static_cast<std::int64_t>(bytes)));
+}
+
+// What this thread can still allocate, no_limit if nothing limits it
+[[nodiscard]] std::int64_t thread_headroom() {
+    const ThreadUsage& state = usage_state;
+    const std::int64_t own = state.limit == no_limit ? no_limit : state.limit - state.held;
+    return state.shared ? std::min(own, state.shared->headroom()) : own;
+}
+
+// GMP has no way to report a failed allocation, its own functions abort as well
+[[noreturn]] void out_of_memory() {
+    std::fputs("ccalc: out of memory\n", stderr);
+    std::abort();
+}
+
+void* system_allocate(const std::size_t size) {
+    void* const block = std::malloc(size);
+    if (!block) out_of_memory();
+    return block;
+}
+
+// Only reached when the free list is empty, about once for every few thousand small blocks
+void* carve(const std::size_t index) {
+    Pool& pool = thread_pool;
+    const std::size_t bytes = (index + 1) * pool_granularity;
+    if (static_cast<std::size_t>(pool.chunk_end - pool.chunk_next) < bytes) {
+        thread_local const SpareReturner returner;
+        take_spare();
+        if (FreeBlock* const block = pool.free_lists[index]) {
+            pool.free_lists[index] = block->next;
+            return block;
+        }
+        // The end of the old chunk is too small for this block, but not for smaller ones
+        if (static_cast<std::size_t>(pool.chunk_end - pool.chunk_next) < bytes) {
+            free_chunk_end(pool, pool.free_lists);
+            pool.chunk_next = static_cast<char*>(system_allocate(chunk_size));
+            pool.chunk_end = pool.chunk_next + chunk_size;
+        }
+    }
+    char* const block = pool.chunk_next;
+    pool.chunk_next += bytes;
+    return block;
+}
+
+template <Allocator allocator>
+void* allocate(const std::size_t size) {
+    if constexpr (allocator == Allocator::POOL) {
+        if (pooled(size)) {
+            const std::size_t index = size_class(size);
+            FreeBlock*& free_list = thread_pool.free_lists[index];
+            if (FreeBlock* const block = free_list) {
+                free_list = block->next;
+                return block;
+            }
+            return carve(index);
+        }
+    }
+    return system_allocate(size);
+}
+
+template <Allocator allocator>
+void release(void* const block, const std::size_t size) {
+    if constexpr (allocator == Allocator::POOL) {
+        if (pooled(size)) {
+            FreeBlock*& free_list = thread_pool.free_lists[size_class(size)];
+            free_list = new (block) FreeBlock{free_list};
+            return;
+        }
+    }
+    std::free(block);
+}
+
+template <Allocator allocator>
+void* reallocate(void* const block, const std::size_t old_size, const std::size_t new_size) {
+    if constexpr (allocator == Allocator::POOL) {
+        const bool old_pooled = pooled(old_size);
+        const bool new_pooled = pooled(new_size);
+        if (old_pooled && new_pooled && size_class(old_size) == size_class(new_size)) return block;
+        if (old_pooled || new_pooled) {
+            void* const moved = allocate<allocator>(new_size);
+            std::memcpy(moved, block, std::min(old_size, new_size));
+            release<allocator>(block, old_size);
+            return moved;
+        }
+    }
+    void* const moved = std::realloc(block, new_size);
+    if (!moved) out_of_memory();
+    return moved;
+}
+
+template <Allocator allocator>
+void* tracked_allocate(const std::size_t size) {
+    void* const block = allocate<allocator>(size);
+    add(size);
+    return block;
+}
+
+template <Allocator allocator>
+void* tracked_reallocate(void* const block, const std::size_t old_size, const std::size_t new_size) {
+    void* const moved = reallocate<allocator>(block, old_size, new_size);
+    if (new_size >= old_size) {
+        add(new_size - old_size);
+    } else {
+        remove(old_size - new_size);
+    }
+    return moved;
+}
+
+template <Allocator allocator>
+void tracked_free(void* const block, const std::size_t size) {
+    release<allocator>(block, size);
+    remove(size);
+}
+
+[[noreturn]] void over_budget() { throw std::runtime_error("Expression exceeds memory budget"); }
+
+}  // namespace
+
+void track(const Allocator allocator) {
+    static std::once_flag once;
+    std::call_once(once, [allocator] {
+        if (allocator == Allocator::POOL) {
+            mp_set_memory_functions(tracked_allocate<Allocator::POOL>, tracked_reallocate<Allocator::POOL>,
+                                    tracked_free<Allocator::POOL>);
+        } else {
+            mp_set_memory_functions(tracked_allocate<Allocator::MALLOC>, tracked_reallocate<Allocator::MALLOC>,
+                                    tracked_free<Allocator::MALLOC>);
+        }
+        installed_allocator = allocator;
+        installed.store(true, std::memory_order_release);
+    });
+}
+
+bool tracking() noexcept { return installed.load(std::memory_order_acquire); }
+
+Allocator allocator() noexcept { return installed_allocator; }
+
+Budget::Budget(const std::size_t limit) noexcept {
+    ThreadUsage& state = usage_state;
+    m_start_held = state.held;
+    m_start_allocated = state.allocated;
+    m_previous_peak = state.peak;
+    m_previous_limit = state.limit;
+    m_previous_exceeded = state.exceeded;
+    state.peak = state.held;
+    if (limit != 0 && limit < static_cast<std::size_t>(no_limit - state.held)) {
+        // A budget inside another can't give more than the outer one has left
+        state.limit = std::min(state.limit, state.held + static_cast<std::int64_t>(limit));
+    }
+    state.exceeded = false;
+}
+
+Budget::~Budget() {
+    ThreadUsage& state = usage_state;
+    state.peak = std::max(m_previous_peak, state.peak);
+    state.limit = m_previous_limit;
+    state.exceeded = m_previous_exceeded || state.held > state.limit;
+}
+
+Usage Budget::usage() const noexcept {
+    const ThreadUsage& state = usage_state;
+    return Usage{state.allocated - m_start_allocated, static_cast<std::size_t>(state.peak - m_start_held)};
+}
+
+Shared::Shared() noexcept {
+    ThreadUsage& state = usage_state;
+    const std::int64_t limit = thread_headroom();
+    if (limit == no_limit || !tracking()) return;
+    m_parent = state.shared;
+    m_limit = std::max<std::int64_t>(limit, 0);
+    m_start_held = state.held;
+    m_active = true;
+    state.shared = this;
+}
+
+Shared::~Shared() {
+    if (!m_active) return;
+    ThreadUsage& state = usage_state;
+    state.shared = m_parent;
+    // Everything this thread allocated while it was counted here is already in m_held
+    state.held = m_start_held + m_held.load(std::memory_order_relaxed);
+    state.peak = std::max(state.peak, m_start_held + m_peak.load(std::memory_order_relaxed));
+    if (state.held > state.limit) state.exceeded = true;
+}
+
+bool Shared::charge(const std::int64_t bytes) noexcept {
+    bool within = true;
+    for (Shared* shared = this; shared; shared = shared->m_parent) {
+        const std::int64_t held = shared->m_held.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        if (bytes <= 0) continue;
+        std::int64_t peak = shared->m_peak.load(std::memory_order_relaxed);
+        while (held > peak && !shared->m_peak.compare_exchange_weak(peak, held, std::memory_order_relaxed)) {
+        }
+        if (held > shared->m_limit) within = false;
+    }
+    return within;
+}
+
+std::int64_t Shared::headroom() const noexcept {
+    std::int64_t least = no_limit;
+    for (const Shared* shared = this; shared; shared = shared->m_parent) {
+        least = std::min(least, shared->m_limit - shared->m_held.load(std::memory_order_relaxed));
+    }
+    return least;
+}
+
+Share::Share(Shared& shared) noexcept : m_active(shared.m_active) {
+    ThreadUsage& state = usage_state;
+    m_previous = state.shared;
+    m_previous_exceeded = state.exceeded;
+    if (!m_active) return;
+    state.shared = &shared;
+    state.exceeded = false;
+}
+
+Share::~Share() {
+    if (!m_active) return;
+    ThreadUsage& state = usage_state;
+    state.shared = m_previous;
+    state.exceeded = m_previous_exceeded;
+}
+
+void check() {
+    if (usage_state.exceeded) over_budget();
+}
+
+void reserve(const std::size_t bytes) {
+    if (!tracking()) return;
+    const std::int64_t left = thread_headroom();
+    if (left == no_limit) return;
+    if (bytes > static_cast<std::size_t>(std::max<std::int64_t>(left, 0))) over_budget();
+}
+
+}  // namespace Memory
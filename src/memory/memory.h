@@ -0,0 +1,107 @@
+// Author: Caden LeCluyse
+
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Accounting for the memory GMP and MPFR numbers use, by replacing GMP's memory functions, which MPFR uses too.
+// Everything is counted separately for each thread
+namespace Memory {
+
+// Where the counting memory functions get their memory from. POOL keeps freed blocks of up to 512 bytes in a free
+// list for each size, per thread, and hands them out again, so the limbs of numbers that are made and dropped
+// for every node don't go through malloc each time. Bigger blocks always use malloc
+enum struct Allocator { MALLOC, POOL };
+
+// Installs the counting memory functions, the first call does and the rest return straight away, so the first
+// call picks the allocator. With MALLOC, numbers created before the call are freed as usual. POOL has to be
+// installed before any number is created, since a block that came from malloc can't go in a free list. Until
+// it's called nothing is counted and budgets aren't enforced
+void track(Allocator allocator = Allocator::MALLOC);
+[[nodiscard]] bool tracking() noexcept;
+// Only meaningful once tracking
+[[nodiscard]] Allocator allocator() noexcept;
+
+// In bytes
+struct Usage {
+    std::size_t allocated = 0; // Every allocation added up, including the ones already freed
+    std::size_t peak = 0;      // The most held at once, not counting what was held when measuring started
+};
+
+// Limits the bytes this thread's numbers can grow by while it's alive, and measures the usage from when it was
+// made. 0 is no limit. GMP can't be told an allocation failed, so going over the budget is only noticed by
+// check, which evaluation calls between operations
+class Budget {
+   public:
+    explicit Budget(std::size_t limit) noexcept;
+    // The budget that was in place before this one is put back
+    ~Budget();
+    Budget(const Budget&) = delete;
+    Budget& operator=(const Budget&) = delete;
+
+    [[nodiscard]] Usage usage() const noexcept;
+
+   private:
+    std::int64_t m_start_held;
+    std::size_t m_start_allocated;
+    std::int64_t m_previous_peak;
+    std::int64_t m_previous_limit;
+    bool m_previous_exceeded;
+};
+
+// A budget several threads draw from at once, for work split across threads. It's made on the thread that splits
+// the work, with what that thread's budget has left, and that thread counts against it until it's destroyed. The
+// threads doing the rest of the work join it with a Share, so the numbers of every thread together stay under
+// the one limit instead of each thread getting the whole of it. When it's destroyed, what the other threads
+// allocated and didn't free is counted as this thread's, since it's the one that ends up with their results.
+// Without a limit it does nothing
+class Shared {
+   public:
+    Shared() noexcept;
+    ~Shared();
+    Shared(const Shared&) = delete;
+    Shared& operator=(const Shared&) = delete;
+
+    // Adds bytes, or takes them off if negative, on this and every Shared it's inside of. Returns false if
+    // that went over one of their limits
+    bool charge(std::int64_t bytes) noexcept;
+    // The least any of them has left
+    [[nodiscard]] std::int64_t headroom() const noexcept;
+
+   private:
+    friend class Share;
+
+    Shared* m_parent = nullptr;
+    std::int64_t m_limit = 0;
+    std::atomic<std::int64_t> m_held{0};
+    std::atomic<std::int64_t> m_peak{0};
+    std::int64_t m_start_held = 0;
+    bool m_active = false;
+};
+
+// Counts what this thread allocates against shared while it's alive
+class Share {
+   public:
+    explicit Share(Shared& shared) noexcept;
+    ~Share();
+    Share(const Share&) = delete;
+    Share& operator=(const Share&) = delete;
+
+   private:
+    Shared* m_previous;
+    bool m_active;
+    bool m_previous_exceeded;
+};
+
+// Throws std::runtime_error if the thread went over its budget
+void check();
+// Throws std::runtime_error if allocating bytes more would go over the budget. For operations whose result
+// size is known before they run, so a huge one is stopped before it allocates anything
+void reserve(std::size_t bytes);
+
+}  // namespace Memory
+
+#endif
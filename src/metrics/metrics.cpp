@@ -0,0 +1,191 @@
+// Author: Caden LeCluyse
+
+#include "metrics/metrics.h"
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "history/history.h"
+#include "include/timing.hpp"
+#include "lib/ccalc.h"
+#include "ui/ui.h"
+
+namespace Metrics {
+
+namespace {
+
+inline constexpr std::size_t flush_size = 64 * 1024;
+// Reading the CPU clock is a system call for each phase, which would cost more than the clock reads and
+// formatting of the rest of the record, so only every 16th expression on each thread gets CPU times
+inline constexpr unsigned cpu_sample_interval = 16;
+
+// FNV-1a, so the same input hashes the same in every run and on every machine
+[[nodiscard]] std::uint64_t hash_input(const std::string_view input) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (const char c : input) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+[[nodiscard]] std::string_view kind(const CCalc::Stats& stats) {
+    if (stats.is_math) return stats.precision != 0 ? "float" : "int";
+    return stats.built ? "bool" : "none";
+}
+
+class Record {
+   public:
+    explicit Record(std::string& buffer) : m_buffer(buffer) { m_buffer.clear(); }
+
+    void key(const std::string_view name) {
+        m_buffer += m_first ? "{\"" : ",\"";
+        m_buffer += name;
+        m_buffer += "\":";
+        m_first = false;
+    }
+
+    template <typename Number>
+    void number(const std::string_view name, const Number value) {
+        key(name);
+        char digits[32];
+        m_buffer.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+    }
+
+    // Whole nanoseconds, formatting an integer is much cheaper than a fixed point double
+    void nanoseconds(const std::string_view name, const double seconds) {
+        number(name, static_cast<std::uint64_t>(seconds * 1e9 + 0.5));
+    }
+
+    // Only used for names and hex digits, which never need escaping
+    void text(const std::string_view name, const std::string_view value) {
+        key(name);
+        m_buffer += '"';
+        m_buffer += value;
+        m_buffer += '"';
+    }
+
+    void hex(const std::string_view name, std::uint64_t value) {
+        static constexpr std::string_view hex_digits = "0123456789abcdef";
+        char digits[16];
+        for (std::size_t i = sizeof(digits); i-- > 0; value >>= 4) digits[i] = hex_digits[value & 0xf];
+        text(name, std::string_view(digits, sizeof(digits)));
+    }
+
+    void boolean(const std::string_view name, const bool value) {
+        key(name);
+        m_buffer += value ? "true" : "false";
+    }
+
+    void null(const std::string_view name) {
+        key(name);
+        m_buffer += "null";
+    }
+
+    void phases(const std::string_view name, const CCalc::Stats& stats, double Timing::Phase::* const clock) {
+        key(name);
+        Record phase_record(m_buffer, Nested{});
+        phase_record.nanoseconds("normalize", stats.normalize.*clock);
+        phase_record.nanoseconds("lex", stats.lex.*clock);
+        phase_record.nanoseconds("parse", stats.parse.*clock);
+        phase_record.nanoseconds("build", stats.build.*clock);
+        phase_record.nanoseconds("evaluate", stats.evaluate.*clock);
+        phase_record.nanoseconds("format", stats.format.*clock);
+        m_buffer += '}';
+    }
+
+    void end() { m_buffer += "}\n"; }
+
+   private:
+    // Nested objects append to the same buffer
+    struct Nested {};
+    Record(std::string& buffer, Nested) : m_buffer(buffer) {}
+
+    std::string& m_buffer;
+    bool m_first = true;
+};
+
+}  // namespace
+
+Writer::Writer(const std::string& path) {
+    m_file = std::fopen(path.c_str(), "a");
+    if (m_file) m_buffer.reserve(flush_size * 2);
+}
+
+Writer::~Writer() {
+    if (!m_file) return;
+    flush();
+    if (std::fclose(m_file) != 0 && !m_failed) UI::print_error("Unable to write the metrics file");
+}
+
+CCalc::Result Writer::evaluate(CCalc::Context& context, const std::string_view expression) {
+    thread_local unsigned evaluations = 0;
+    CCalc::Stats stats;
+    stats.cpu_time = evaluations++ % cpu_sample_interval == 0;
+    CCalc::Result result = context.evaluate(expression, stats);
+
+    // Each thread builds its records in its own buffer, the lock is only held to copy them over
+    thread_local std::string record_buffer;
+    Record record(record_buffer);
+    record.hex("input_hash", hash_input(expression));
+    record.boolean("ok", result.success);
+    record.text("kind", kind(stats));
+    record.number("tokens", stats.tokens);
+    record.number("nodes", stats.nodes());
+    record.number("precision", stats.precision);
+    record.phases("wall_ns", stats, &Timing::Phase::wall);
+    if (stats.cpu_time) {
+        record.phases("cpu_ns", stats, &Timing::Phase::cpu);
+    } else {
+        record.null("cpu_ns");
+    }
+    record.number("bytes_allocated", stats.allocated);
+    record.number("peak_bytes", stats.peak_memory);
+    record.number("result_digits", !result.success  ? 0
+                                   : result.streamed ? result.digits
+                                                     : History::count_digits(result.text));
+    record.end();
+    write(record_buffer);
+    return result;
+}
+
+CCalc::Result PhaseCounters::evaluate(CCalc::Context& context, const std::string_view expression,
+                                      CCalc::Stats& stats) {
+    stats.counters = &m_counters;
+    CCalc::Result result = context.evaluate(expression, stats);
+    ++m_totals.expressions;
+    if (stats.built) {
+        ++m_totals.trees;
+        m_totals.nodes += stats.nodes();
+    }
+    m_totals.normalize += stats.normalize;
+    m_totals.lex += stats.lex;
+    m_totals.parse += stats.parse;
+    m_totals.build += stats.build;
+    m_totals.evaluate += stats.evaluate;
+    m_totals.format += stats.format;
+    return result;
+}
+
+void Writer::write(const std::string_view record) {
+    if (!m_file) return;
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_buffer += record;
+    if (m_buffer.size() >= flush_size) flush();
+}
+
+void Writer::flush() {
+    if (!m_buffer.empty() && std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) != m_buffer.size() &&
+        !m_failed) {
+        m_failed = true;
+        UI::print_error("Unable to write the metrics file");
+    }
+    m_buffer.clear();
+}
+
+}  // namespace Metrics
@@ -0,0 +1,74 @@
+// Author: Caden LeCluyse
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <cstddef>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "include/timing.hpp"
+#include "lib/ccalc.h"
+#include "perf/counters.h"
+
+namespace Metrics {
+
+// Writes one JSON object per line for every expression evaluated through it: a hash of the input, what kind of
+// expression it was, its size, the precision, the wall and CPU time of each phase, the bytes GMP and MPFR
+// allocated and the most they held at once, and how many digits the result has. The bytes are only counted
+// once Memory::track was called. CPU times are only taken for a sample of the expressions,
+// the others have null for them. Records are buffered and written in large blocks, so leaving it on costs
+// a few clock reads per expression. Any number of threads can share one writer
+class Writer {
+   public:
+    // Appends to the file, so several batch runs can share it
+    explicit Writer(const std::string& path);
+    ~Writer();
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    [[nodiscard]] bool ok() const noexcept { return m_file != nullptr; }
+    [[nodiscard]] CCalc::Result evaluate(CCalc::Context& context, std::string_view expression);
+
+   private:
+    void write(std::string_view record);
+    void flush();
+
+    std::mutex m_mutex;
+    std::FILE* m_file = nullptr;
+    std::string m_buffer;
+    bool m_failed = false;
+};
+
+// What every expression evaluated through a PhaseCounters added up to, for each phase
+struct PhaseTotals {
+    std::size_t expressions = 0;
+    std::size_t trees = 0; // Expressions that were parsed and built, the others skipped to evaluate
+    std::size_t nodes = 0;
+    Timing::Phase normalize;
+    Timing::Phase lex;
+    Timing::Phase parse;
+    Timing::Phase build;
+    Timing::Phase evaluate;
+    Timing::Phase format;
+};
+
+// Counts cycles, instructions, cache misses, and branch misses in each phase, on the thread that created it.
+// Without hardware counters it still adds up the times
+class PhaseCounters {
+   public:
+    [[nodiscard]] const Perf::Counters& counters() const noexcept { return m_counters; }
+    [[nodiscard]] const PhaseTotals& totals() const noexcept { return m_totals; }
+    // Evaluates with stats, which get this expression's counts, and adds them to the totals
+    [[nodiscard]] CCalc::Result evaluate(CCalc::Context& context, std::string_view expression, CCalc::Stats& stats);
+
+   private:
+    Perf::Counters m_counters;
+    PhaseTotals m_totals;
+};
+
+}  // namespace Metrics
+
+#endif
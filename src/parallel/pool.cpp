@@ -0,0 +1,210 @@
+// Author: Caden LeCluyse
+
+#include "parallel/pool.h"
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <csignal>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mpfr.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "interrupt/interrupt.h"
+#include "memory/memory.h"
+
+namespace Parallel {
+
+namespace {
+
+// run_ranges gives each thread this many ranges, so one that finishes early can steal another
+inline constexpr std::size_t ranges_per_thread = 4;
+
+// The tasks dealt to one thread. The owner takes from the front, thieves take from the back, so the two only meet
+// on the last task
+struct Queue {
+    std::mutex mutex;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+};
+
+// One call to run. It lives on the caller's stack, which waits for every worker to leave before returning
+struct Batch {
+    Batch(const std::size_t count, const unsigned threads, const std::function<void(std::size_t)>& _task)
+        : task(_task), queues(threads), limits(Interrupt::current()) {
+        // Contiguous blocks, so each thread starts on tasks that sit next to each other
+        for (std::size_t i = 0; i < threads; ++i) {
+            queues[i].begin = count * i / threads;
+            queues[i].end = count * (i + 1) / threads;
+        }
+    }
+
+    const std::function<void(std::size_t)>& task;
+    std::vector<Queue> queues;
+    const Interrupt::Limits limits;
+    // Made on the caller, which counts against it until the batch is gone
+    Memory::Shared memory;
+    // Guarded by the pool's mutex. The caller has the first queue
+    std::size_t joined = 1;
+    unsigned working = 0;
+    std::atomic<bool> failed{false};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+};
+
+[[nodiscard]] bool take(Batch& batch, const std::size_t own, std::size_t& index) {
+    {
+        Queue& queue = batch.queues[own];
+        const std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.begin < queue.end) {
+            index = queue.begin++;
+            return true;
+        }
+    }
+    const std::size_t num_queues = batch.queues.size();
+    for (std::size_t offset = 1; offset < num_queues; ++offset) {
+        Queue& victim = batch.queues[(own + offset) % num_queues];
+        const std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.begin < victim.end) {
+            index = --victim.end;
+            return true;
+        }
+    }
+    return false;
+}
+
+void work(Batch& batch, const std::size_t own) {
+    std::size_t index;
+    while (take(batch, own, index)) {
+        if (batch.failed.load(std::memory_order_relaxed)) continue;
+        try {
+            batch.task(index);
+        } catch (...) {
+            const std::lock_guard<std::mutex> lock(batch.error_mutex);
+            if (!batch.error) batch.error = std::current_exception();
+            batch.failed.store(true, std::memory_order_relaxed);
+        }
+    }
+}
+
+// Workers are only added, so the pool is as big as the most threads any call has asked for
+class Pool {
+   public:
+    Pool() = default;
+    ~Pool() {
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_work.notify_all();
+        for (auto& worker : m_workers) worker.join();
+    }
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    void run(Batch& batch) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        grow(batch.queues.size() - 1);
+        m_open.push_back(&batch);
+        lock.unlock();
+        m_work.notify_all();
+
+        work(batch, 0);
+
+        // Nothing is left to take, so the workers still in the batch are finishing their last task
+        lock.lock();
+        std::erase(m_open, &batch);
+        m_done.wait(lock, [&batch] { return batch.working == 0; });
+    }
+
+   private:
+    void grow(const std::size_t num_workers) {
+        if (m_workers.size() >= num_workers) return;
+        // Signals are for the thread that started the evaluation, it's the one that decides what they stop
+        sigset_t signals;
+        sigset_t previous;
+        sigfillset(&signals);
+        pthread_sigmask(SIG_BLOCK, &signals, &previous);
+        while (m_workers.size() < num_workers) m_workers.emplace_back([this] { worker_loop(); });
+        pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    }
+
+    [[nodiscard]] Batch* open_batch() const {
+        for (Batch* const batch : m_open) {
+            if (batch->joined < batch->queues.size()) return batch;
+        }
+        return nullptr;
+    }
+
+    void worker_loop() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            Batch* batch = nullptr;
+            m_work.wait(lock, [this, &batch] { return m_stopping || (batch = open_batch()) != nullptr; });
+            if (m_stopping) break;
+            const std::size_t own = batch->joined++;
+            ++batch->working;
+            lock.unlock();
+            {
+                const Interrupt::Scope limits(batch->limits);
+                const Memory::Share memory(batch->memory);
+                work(*batch, own);
+            }
+            lock.lock();
+            if (--batch->working == 0) m_done.notify_all();
+        }
+        lock.unlock();
+        // MPFR caches constants like pi per thread
+        mpfr_free_cache();
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_work;
+    std::condition_variable m_done;
+    std::vector<std::thread> m_workers;
+    std::vector<Batch*> m_open;
+    bool m_stopping = false;
+};
+
+Pool& shared_pool() {
+    static Pool pool;
+    return pool;
+}
+
+}  // namespace
+
+unsigned hardware_threads() noexcept { return std::max(1U, std::thread::hardware_concurrency()); }
+
+void run(const std::size_t count, unsigned threads, const std::function<void(std::size_t)>& task) {
+    if (threads == 0) threads = hardware_threads();
+    threads = static_cast<unsigned>(std::min<std::size_t>(std::min(threads, max_threads), count));
+    if (threads <= 1) {
+        for (std::size_t i = 0; i < count; ++i) task(i);
+        return;
+    }
+
+    Batch batch(count, threads, task);
+    shared_pool().run(batch);
+    if (batch.error) std::rethrow_exception(batch.error);
+}
+
+void run_ranges(const std::size_t count, unsigned threads, const std::function<void(std::size_t, std::size_t)>& task) {
+    if (threads == 0) threads = hardware_threads();
+    const std::size_t ranges =
+        std::min<std::size_t>(count, std::size_t{std::min(threads, max_threads)} * ranges_per_thread);
+    if (ranges <= 1) {
+        if (count > 0) task(0, count);
+        return;
+    }
+    run(ranges, threads, [count, ranges, &task](const std::size_t i) {
+        task(count * i / ranges, count * (i + 1) / ranges);
+    });
+}
+
+}  // namespace Parallel
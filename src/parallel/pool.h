@@ -0,0 +1,32 @@
+// Author: Caden LeCluyse
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <cstddef>
+#include <functional>
+
+// Splitting one evaluation across cores. The worker threads are shared by every caller and made the first time
+// they're needed. Each call deals its tasks out to one queue per thread taking part, a thread takes from the front
+// of its own queue, and once it's empty steals from the back of the others, so uneven tasks still keep every
+// thread busy until the end
+namespace Parallel {
+
+// More threads than this are taken as this many
+inline constexpr unsigned max_threads = 256;
+
+// How many threads the machine can run at once, at least 1
+[[nodiscard]] unsigned hardware_threads() noexcept;
+
+// Calls task(i) for each i in [0, count) on the calling thread and up to threads - 1 workers, and returns once
+// they've all finished. 0 threads is one per core. The workers are held to the time limit and cancel flag of the
+// calling thread, and together they share what the caller's memory budget has left, see Memory::Shared. If a task
+// throws, the tasks that haven't started are skipped and the first exception is rethrown
+void run(std::size_t count, unsigned threads, const std::function<void(std::size_t)>& task);
+// The same over contiguous ranges of [0, count), a few for each thread so stealing can still even them out, for
+// loops whose items are too small to be a task each. Calls task(begin, end) for each range
+void run_ranges(std::size_t count, unsigned threads, const std::function<void(std::size_t, std::size_t)>& task);
+
+}  // namespace Parallel
+
+#endif
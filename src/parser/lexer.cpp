@@ -0,0 +1,118 @@
+// Author: Caden LeCluyse
+
+#include "parser/lexer.h"
+
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "include/types.hpp"
+#include "include/value.hpp"
+
+using namespace Types;
+
+namespace Lexer {
+
+namespace {
+
+[[nodiscard]] bool is_digit(const char c) noexcept { return std::isdigit(static_cast<unsigned char>(c)); }
+[[nodiscard]] bool is_alpha(const char c) noexcept { return std::isalpha(static_cast<unsigned char>(c)); }
+[[nodiscard]] bool is_alnum(const char c) noexcept { return std::isalnum(static_cast<unsigned char>(c)); }
+
+void push_literal(const Token kind, const std::string_view text, std::vector<TypedToken>& tokens, std::string& literals) {
+    tokens.push_back(TypedToken{kind, static_cast<std::uint32_t>(literals.size()), static_cast<std::uint32_t>(text.size())});
+    literals += text;
+    literals += '\0';
+}
+
+// Returns the token for a keyword at the start of the input, along with its length
+[[nodiscard]] std::pair<Token, std::size_t> match_keyword(const std::string_view input) noexcept {
+    if (input.starts_with("SIN")) return {Token::SIN, 3};
+    if (input.starts_with("COS")) return {Token::COS, 3};
+    if (input.starts_with("TAN")) return {Token::TAN, 3};
+    if (input.starts_with("ANS")) return {Token::ANS, 3};
+    if (input.starts_with("PI")) return {Token::PI, 2};
+    if (input.starts_with("E")) return {Token::EULER, 1};
+    return {Token::NULLCHAR, 0};
+}
+
+}  // namespace
+
+void lex(const std::string_view input, const bool symbolic, const Types::VarMap& var_map,
+         std::vector<TypedToken>& tokens, std::string& literals, LexSummary& summary) {
+    tokens.clear();
+    summary = LexSummary{};
+
+    std::size_t i = 0;
+    while (i < input.size()) {
+        const char c = input[i];
+        if (c == ' ') {
+            ++i;
+            continue;
+        }
+
+        if (symbolic && is_alnum(c)) {
+            const std::size_t start = i;
+            while (i < input.size() && is_alnum(input[i])) ++i;
+            push_literal(Token::IDENT, input.substr(start, i - start), tokens, literals);
+            continue;
+        }
+        if (is_digit(c) || c == '.') {
+            const std::size_t start = i;
+            while (i < input.size() && (is_digit(input[i]) || input[i] == '.')) ++i;
+            push_literal(Token::NUMBER, input.substr(start, i - start), tokens, literals);
+            summary.has_number = true;
+            summary.math_evidence = true;
+            continue;
+        }
+        if (is_alpha(c)) {
+            const auto [keyword, length] = match_keyword(input.substr(i));
+            if (length) {
+                tokens.push_back(TypedToken{keyword});
+                summary.math_evidence = true;
+                i += length;
+                continue;
+            }
+            push_literal(Token::IDENT, input.substr(i, 1), tokens, literals);
+            if (var_map.contains(c)) {
+                summary.math_evidence = true;
+            } else if (c == 'T' || c == 'F') {
+                summary.bool_evidence = true;
+            }
+            ++i;
+            continue;
+        }
+
+        switch (c) {
+            case '+':
+            case '-':
+            case '*':
+            case '/':
+                summary.math_evidence = true;
+                tokens.push_back(TypedToken{static_cast<Token>(c)});
+                break;
+            case '&':
+            case '|':
+            case '@':
+            case '$':
+                summary.bool_evidence = true;
+                tokens.push_back(TypedToken{static_cast<Token>(c)});
+                break;
+            case '^':
+            case '!':
+            case '(':
+            case ')':
+                tokens.push_back(TypedToken{static_cast<Token>(c)});
+                break;
+            default:
+                tokens.push_back(TypedToken{Token::NULLCHAR, static_cast<unsigned char>(c)});
+        }
+        ++i;
+    }
+}
+
+}
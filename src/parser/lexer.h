@@ -0,0 +1,33 @@
+// Author: Caden LeCluyse
+
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "include/types.hpp"
+#include "include/value.hpp"
+
+namespace Lexer {
+
+// What the lexer came across, which decides if the expression is math or boolean
+struct LexSummary {
+    bool has_number = false;
+    bool math_evidence = false;
+    bool bool_evidence = false;
+};
+
+// Splits an expression into typed tokens in a single pass. Numbers and identifiers are appended to literals,
+// each followed by a null terminator. A character that doesn't start any token becomes a NULLCHAR token holding
+// the character in its offset, so the parser can report it with the message for the kind of expression.
+// In symbolic mode every run of letters and digits is an identifier. Otherwise identifiers are single letters, and
+// sin, cos, tan, pi, e, and ans get their own tokens. T and F count as boolean unless they're assigned variables
+void lex(const std::string_view input, const bool symbolic, const Types::VarMap& var_map,
+         std::vector<Types::TypedToken>& tokens, std::string& literals, LexSummary& summary);
+
+}
+
+#endif
@@ -4,15 +4,16 @@
 #include <algorithm>
 #include <cctype>
 #include <optional>
-#include <stack>
 #include <string>
 #include <string_view>
+#include <unordered_map>
+#include <vector>
 
-#include "boolparse.h"
 #include "include/error.hpp"
-#include "include/util.hpp"
+#include "include/timing.hpp"
 #include "include/types.hpp"
-#include "mathparse.h"
+#include "include/value.hpp"
+#include "parser/lexer.h"
 
 using namespace Types;
 
@@ -20,162 +21,325 @@ namespace Parse {
 
 namespace {
 
-[[nodiscard]]
-constexpr bool trig_check(const std::string_view infix_expression,
-                          const std::unordered_map<char, std::string>& var_map,
-                          const auto& itr, const char c) noexcept {
-    // Check if "TAN" is present in the expression, since TAN has a T and would mess things up
-    if (c == 'T') {
-        if (static_cast<std::size_t>(std::distance(infix_expression.begin(), itr)) + 2 >= infix_expression.size()) return false;
-        const std::string_view get_tan = infix_expression.substr(static_cast<std::size_t>(std::distance(infix_expression.begin(), itr)), 3);
-        if (get_tan == "TAN" || var_map.contains('T')) return true;
-        return false;
-    } else if (c == 'S') {
-        if (static_cast<std::size_t>(std::distance(infix_expression.begin(), itr)) + 2 >= infix_expression.size()) return false;
-        const std::string_view get_tan = infix_expression.substr(static_cast<std::size_t>(std::distance(infix_expression.begin(), itr)), 3);
-        if (get_tan == "SIN" || var_map.contains('S')) return true;
-        return false;
-    } else if (c == 'C') {
-        if (static_cast<std::size_t>(std::distance(infix_expression.begin(), itr)) + 2 >= infix_expression.size()) return false;
-        const std::string_view get_tan = infix_expression.substr(static_cast<std::size_t>(std::distance(infix_expression.begin(), itr)), 3);
-        if (get_tan == "COS" || var_map.contains('C')) return true;
-        return false;
+[[nodiscard]] constexpr std::size_t num_operands(const Token kind) noexcept {
+    if (kind == Token::UNARY || isnot(kind) || is_trig(kind)) return 1;
+    if (is_math_operator(kind) || is_bool_operator(kind)) return 2;
+    return 0;
+}
+
+[[nodiscard]] constexpr bool ends_operand(const Token kind) noexcept {
+    return is_math_operand(kind) || kind == Token::VAR || kind == Token::RIGHT_PAREN || kind == Token::FAC;
+}
+
+[[nodiscard]] constexpr bool starts_operand(const Token kind) noexcept {
+    return is_math_operand(kind) || kind == Token::VAR || kind == Token::LEFT_PAREN || is_trig(kind);
+}
+
+// A + or - is a sign instead of an operator when there's no value to its left
+[[nodiscard]] constexpr bool is_sign_position(const Token previous) noexcept {
+    return previous == Token::NULLCHAR || previous == Token::LEFT_PAREN ||
+           (is_math_operator(previous) && previous != Token::FAC);
+}
+
+// The character a token was written with, for error messages
+[[nodiscard]] constexpr char token_char(const Token kind) noexcept {
+    switch (kind) {
+        case Token::TAN:
+            return 'T';
+        case Token::EULER:
+            return 'E';
+        default:
+            return static_cast<char>(kind);
     }
-    return false;
 }
 
-[[nodiscard]]
-constexpr std::optional<bool> is_math_equation(const std::string_view infix_expression,
-                                               const std::unordered_map<char, std::string>& var_map) noexcept {
-    if (Util::contains_bool_op(infix_expression)) return false;
-
-    // From now on, we are operating on the assumption that there are no boolean operators
-    for (auto itr = infix_expression.begin(); itr != infix_expression.end(); ++itr) {
-        const char c = *itr;
-        const char next_token = (itr + 1 != infix_expression.end()) ? *(itr + 1) : '\0';
-
-        if (trig_check(infix_expression, var_map, itr, c)) return true;
-
-        if (c == 'F' && var_map.contains('F')) { 
-            return true;
-        } else if (c == 'F') return false;
-
-        if (c == '!' && is_bool_operand(static_cast<Token>(next_token))) {
-            return false;
-            // I think this is a more robust check than just looking for a digit
-            // This needs to be changed at some point
-        } else if ((std::isdigit(c) || var_map.contains(c)) && (next_token == '!' || next_token == ')' ||
-                                                                is_math_var(static_cast<Token>(next_token)) ||
-                                                                var_map.contains(next_token) || next_token == 'A')) {
-            return true;
+// Shunting yard, reading the tokens left to right. Values go straight to the result, and operators wait on the stack
+// until an operator that binds less tightly shows up. Signs, implicit multiplication, and the checks between
+// neighboring tokens are handled as the tokens arrive, and the result is checked to have an operand for every operator.
+// All binary operators are left associative. Math follows the usual precedence, and in boolean expressions NOT binds
+// tightest while every binary operator shares a level
+class PostfixBuilder {
+   public:
+    PostfixBuilder(ParseResult& result, std::vector<TypedToken>& operators, const bool math) noexcept
+        : m_result(result), m_operators(operators), m_math(math) {
+        m_operators.clear();
+    }
+
+    [[nodiscard]] std::optional<std::string> push(const TypedToken token) {
+        return m_math ? push_math(token) : push_bool(token);
+    }
+
+    [[nodiscard]] std::optional<std::string> finish() {
+        if (is_trig(m_previous)) return std::optional<std::string>("Use parentheses with trig functions");
+        while (!m_operators.empty()) {
+            if (m_operators.back().kind == Token::LEFT_PAREN) {
+                return std::optional<std::string>("Missing closing parentheses");
+            }
+            const auto output_result = output(pop_operator());
+            if (output_result) return output_result;
         }
-        if ((is_math_var(static_cast<Token>(c)) || var_map.contains(c)) &&
-            (is_math_var(static_cast<Token>(next_token)) || var_map.contains(next_token))) {
-            return true;
-        } else if (is_math_operator(static_cast<Token>(c))) {
-            return true;
-        } 
+        if (m_depth != 1) return std::optional<std::string>("Missing operator");
+        return std::nullopt;
     }
-    return std::nullopt;
-} 
-
-// Checks for tan, sin, and cos while expanding vars
-[[nodiscard]] constexpr bool check_trig_expand(const std::string_view infix, std::size_t& i) {
-    if (infix[i] == 'T' && i + 2 < infix.size() && infix[i + 1] == 'A' && infix[i + 2] == 'N') {
-        while (infix[++i] != 'N');
-        return true;
+
+   private:
+    [[nodiscard]] int precedence(const Token kind) const noexcept {
+        if (m_math) return get_precedence(kind);
+        return isnot(kind) ? 2 : 1;
     }
-    if (infix[i] == 'S' && i + 2 < infix.size() && infix[i + 1] == 'I' && infix[i + 2] == 'N') {
-        while (infix[++i] != 'N');
-        return true;
+
+    [[nodiscard]] TypedToken pop_operator() noexcept {
+        const TypedToken token = m_operators.back();
+        m_operators.pop_back();
+        return token;
     }
-    if (infix[i] == 'C' && i + 2 < infix.size() && infix[i + 1] == 'O' && infix[i + 2] == 'S') {
-        while (infix[++i] != 'S');
-        return true;
+
+    [[nodiscard]] std::optional<std::string> output(const TypedToken token) {
+        const std::size_t operands = num_operands(token.kind);
+        if (m_depth < operands) {
+            return std::optional<std::string>("Missing operand for " + std::string{token_char(token.kind)});
+        }
+        m_depth = m_depth - operands + 1;
+        m_result.result.push_back(token);
+        return std::nullopt;
     }
-    return false;
-}
 
-// Checks for ans while expanding vars
-[[nodiscard]]
-constexpr bool check_ans_expand(std::string& infix, const std::unordered_map<char, std::string>& var_map, std::size_t& index) {
-    if (index + 2 >= infix.size()) return false;
-    if (infix[index + 1] == 'N' && infix[index + 2] == 'S') {
-        infix.replace(index, 3, "(" + var_map.at('\0') + ")");
-        while (++index < infix.size() && infix[index] != ')');
-        return true;
+    [[nodiscard]] std::optional<std::string> push_binary(const TypedToken token) {
+        while (!m_operators.empty() && m_operators.back().kind != Token::LEFT_PAREN &&
+               !is_trig(m_operators.back().kind) && precedence(m_operators.back().kind) >= precedence(token.kind)) {
+            const auto output_result = output(pop_operator());
+            if (output_result) return output_result;
+        }
+        m_operators.push_back(token);
+        return std::nullopt;
     }
 
-    return false;
-}
+    [[nodiscard]] std::optional<std::string> close_parentheses() {
+        while (!m_operators.empty() && m_operators.back().kind != Token::LEFT_PAREN) {
+            const auto output_result = output(pop_operator());
+            if (output_result) return output_result;
+        }
+        if (m_operators.empty()) return std::optional<std::string>("Missing open parentheses");
+        m_operators.pop_back();
+        // A trig function applies to the parentheses right after it
+        if (!m_operators.empty() && is_trig(m_operators.back().kind)) return output(pop_operator());
+        return std::nullopt;
+    }
 
-constexpr void expand_vars(std::string& infix, const std::unordered_map<char, std::string>& var_map) {
-    for (std::size_t i = 0; i < infix.size(); ++i) {
-        if (!var_map.contains(infix[i]) && infix[i] != 'A') continue;
-        if (infix[i] == 'P' && i + 1 < infix.size() && infix[i + 1] == 'I') {
-            i++;
-            continue;
+    [[nodiscard]] std::optional<std::string> check_number(const TypedToken token) {
+        const std::string_view number(m_result.literals.data() + token.offset, token.length);
+        const auto decimals = std::ranges::count(number, '.');
+        if (decimals > 1) return std::optional<std::string>("Invalid floating point: " + std::string(number));
+        if (decimals) m_result.is_floating_point = true;
+        return std::nullopt;
+    }
+
+    [[nodiscard]] std::optional<std::string> push_math(TypedToken token) {
+        if (token.kind == Token::ADD && is_sign_position(m_previous)) return std::nullopt;
+        if (token.kind == Token::SUB && is_sign_position(m_previous)) token.kind = Token::UNARY;
+        if (is_trig(m_previous) && token.kind != Token::LEFT_PAREN) {
+            return std::optional<std::string>("Use parentheses with trig functions");
+        }
+        if (starts_operand(token.kind) && ends_operand(m_previous)) {
+            if (is_math_var(m_previous) && token.kind != Token::VAR) {
+                const auto variable_result = Error::variable_error(token.kind);
+                if (variable_result) return variable_result;
+            }
+            const auto mult_result = push_math(TypedToken{Token::MULT});
+            if (mult_result) return mult_result;
+        }
+        // Variables are checked as if they were a number
+        const Token check_kind = token.kind == Token::VAR ? Token::NUMBER : token.kind;
+        if (m_previous != Token::NULLCHAR) {
+            const auto checker_result = Error::error_math(m_previous, check_kind);
+            if (checker_result) return checker_result;
         }
-        if (check_trig_expand(infix, i)) continue;
-        if (infix[i] == 'A' && check_ans_expand(infix, var_map, i)) continue;
 
-        infix.replace(i, 1, "(" + var_map.at(infix[i]) + ")");
-        while (++i < infix.size() && infix[i] != ')');
+        // Division, decimals, constants, trig, and negative exponents are evaluated with floating point
+        if (token.kind == Token::DIV || is_trig(token.kind) || is_math_var(token.kind) ||
+            (token.kind == Token::UNARY && m_after_pow)) {
+            m_result.is_floating_point = true;
+        }
+
+        std::optional<std::string> push_result;
+        if (token.kind == Token::NUMBER) {
+            push_result = check_number(token);
+            if (!push_result) push_result = output(token);
+        } else if (is_math_var(token.kind) || token.kind == Token::VAR || token.kind == Token::FAC) {
+            push_result = output(token);
+        } else if (is_trig(token.kind) || token.kind == Token::UNARY || token.kind == Token::LEFT_PAREN) {
+            m_operators.push_back(token);
+        } else if (token.kind == Token::RIGHT_PAREN) {
+            push_result = close_parentheses();
+        } else if (is_math_operator(token.kind)) {
+            push_result = push_binary(token);
+        } else {
+            push_result = Error::invalid_character_error_math(token_char(token.kind));
+        }
+        if (push_result) return push_result;
+
+        m_after_pow = token.kind == Token::POW_XOR || (m_after_pow && token.kind == Token::LEFT_PAREN);
+        m_previous = check_kind;
+        return std::nullopt;
     }
-}
 
-[[nodiscard]] std::optional<std::string_view>
-clear_stack(std::vector<Token>& prefix_expression, std::stack<Token>& operator_stack, const bool is_math) {
-    while (!operator_stack.empty()) {
-        if (operator_stack.top() == Token::RIGHT_PAREN) {
-            while (!operator_stack.empty()) operator_stack.pop();
-            return std::optional<std::string_view>("Missing open parentheses");
+    // Every operand looks the same to the error checks, so variables are checked as if they were True
+    [[nodiscard]] std::optional<std::string> push_bool(const TypedToken token) {
+        const Token check_kind = token.kind == Token::VAR ? Token::TRUE : token.kind;
+        if (m_previous != Token::NULLCHAR) {
+            const auto checker_result = Error::error_bool(m_previous, check_kind);
+            if (checker_result) return checker_result;
+        }
+
+        std::optional<std::string> push_result;
+        if (is_bool_operand(check_kind)) {
+            push_result = output(token);
+        } else if (isnot(token.kind) || token.kind == Token::LEFT_PAREN) {
+            m_operators.push_back(token);
+        } else if (token.kind == Token::RIGHT_PAREN) {
+            push_result = close_parentheses();
+        } else if (is_bool_operator(token.kind)) {
+            push_result = push_binary(token);
+        } else {
+            push_result = Error::invalid_character_error_bool(token_char(token.kind));
         }
-        prefix_expression.push_back(operator_stack.top());
-        if(is_math) prefix_expression.push_back(Token::COMMA);
-        operator_stack.pop();
+        if (push_result) return push_result;
+
+        m_previous = check_kind;
+        return std::nullopt;
     }
 
-    return std::nullopt;
+    ParseResult& m_result;
+    std::vector<TypedToken>& m_operators;
+    const bool m_math;
+    Token m_previous = Token::NULLCHAR;
+    std::size_t m_depth = 0;  // Values the postfix expression would have on its stack so far
+    bool m_after_pow = false;
+};
+
+}  // namespace
+
+void Parser::reset() {
+    m_result.result.clear();
+    m_result.literals.clear();
+    m_result.variables.clear();
+    m_result.error_msg.clear();
+    m_result.success = false;
+    m_result.is_math = false;
+    m_result.is_floating_point = false;
+    m_var_indices.clear();
 }
 
+const ParseResult& Parser::fail(std::string error_msg) {
+    m_result.error_msg = std::move(error_msg);
+    m_result.success = false;
+    return m_result;
 }
 
-// Takes in a standard expression string in infix form, and converts it to prefix
+// Takes in a standard expression string in infix form, and converts it to postfix
 // This is a variation of the Shunting yard algorithm, invented by Dijkstra in 1961
 [[nodiscard]]
-ParseResult create_prefix_expression(std::string& infix_expression, const std::unordered_map<char, std::string>& var_map) {
-    std::stack<Token> operator_stack;
-    ParseResult parse_result; 
-
-    const auto is_math = is_math_equation(infix_expression, var_map);
-    if (!is_math) {
-        parse_result.error_msg = "No valid operators detected";
-        return parse_result;
-    }
-    if (*is_math) expand_vars(infix_expression, var_map);
+const ParseResult& Parser::parse(const std::string_view infix_expression, const VarMap& var_map,
+                                 Timing::Stopwatch* const stopwatch, Timing::Phase* const lex_time) {
+    reset();
+    if (infix_expression.size() == 1) return fail("Expression is only one character long");
 
-    const auto initial_checks = Error::initial_checks(infix_expression, *is_math);
-    if (initial_checks) {
-        parse_result.error_msg = *initial_checks;
-        return parse_result;
-    }
-    const auto error_parsing = *is_math ? MathParse::parse_math(infix_expression, parse_result, operator_stack)
-                                        : BoolParse::parse_bool(infix_expression, parse_result.result, operator_stack);
-    if (error_parsing) {
-        parse_result.error_msg = *error_parsing;
-        return parse_result;
+    Lexer::LexSummary summary;
+    Lexer::lex(infix_expression, false, var_map, m_tokens, m_result.literals, summary);
+    if (stopwatch) *lex_time = stopwatch->lap();
+    if (m_tokens.empty()) return fail("Empty input received");
+    if (!summary.bool_evidence && !summary.math_evidence) return fail("No valid operators detected");
+    if (summary.bool_evidence && summary.has_number) return fail("Boolean expression contains a number");
+    const bool math = !summary.bool_evidence;
+    m_result.is_math = math;
+
+    const auto initial_checks = Error::initial_checks(m_tokens.front().kind, m_tokens.back().kind, math);
+    if (initial_checks) return fail(*initial_checks);
+
+    PostfixBuilder builder(m_result, m_operators, math);
+    for (const TypedToken token : m_tokens) {
+        std::optional<std::string> push_result;
+        if (token.kind == Token::NULLCHAR) {
+            const char c = static_cast<char>(token.offset);
+            push_result = math ? Error::invalid_character_error_math(c) : Error::invalid_character_error_bool(c);
+        } else if (token.kind == Token::IDENT && !math) {
+            const char name = m_result.literals[token.offset];
+            if (name == 'T' || name == 'F') {
+                push_result = builder.push(TypedToken{static_cast<Token>(name)});
+            } else {
+                push_result = Error::invalid_character_error_bool(name);
+            }
+        } else if (token.kind == Token::IDENT || token.kind == Token::ANS) {
+            // Variables are bound to their stored value when the tree is built
+            const char name = token.kind == Token::ANS ? '\0' : m_result.literals[token.offset];
+            const auto var = var_map.find(name);
+            if (var == var_map.end()) {
+                push_result = token.kind == Token::ANS ? std::optional<std::string>("There is no ANS present")
+                                                       : Error::invalid_character_error_math(name);
+            } else {
+                if (var->second.is_floating_point()) m_result.is_floating_point = true;
+                push_result = builder.push(TypedToken{Token::VAR, static_cast<unsigned char>(name)});
+            }
+        } else {
+            push_result = builder.push(token);
+        }
+        if (push_result) return fail(*push_result);
     }
-    const auto stack_result = clear_stack(parse_result.result, operator_stack, *is_math);
-    parse_result.is_math = *is_math;
-    if (stack_result) {
-        parse_result.error_msg = *stack_result;
-        return parse_result; 
+    const auto finish_result = builder.finish();
+    if (finish_result) return fail(*finish_result);
+
+    m_result.success = true;
+    return m_result;
+}
+
+// Variables are indexed in order of first appearance
+[[nodiscard]]
+const ParseResult& Parser::parse_symbolic(const std::string_view infix_expression) {
+    static const VarMap no_vars;
+    reset();
+
+    Lexer::LexSummary summary;
+    Lexer::lex(infix_expression, true, no_vars, m_tokens, m_result.literals, summary);
+    if (m_tokens.empty()) return fail("Empty input received");
+    const auto initial_checks = Error::initial_checks(m_tokens.front().kind, m_tokens.back().kind, false);
+    if (initial_checks) return fail(*initial_checks);
+
+    PostfixBuilder builder(m_result, m_operators, false);
+    for (TypedToken token : m_tokens) {
+        if (token.kind == Token::NULLCHAR) {
+            return fail(Error::invalid_character_error_bool(static_cast<char>(token.offset)));
+        }
+        if (token.kind == Token::IDENT) {
+            const std::string_view name(m_result.literals.data() + token.offset, token.length);
+            if (std::isdigit(static_cast<unsigned char>(name[0]))) {
+                return fail("Variable names must begin with a letter: " + std::string(name));
+            }
+            if (name == "T" || name == "F") {
+                token = TypedToken{static_cast<Token>(name[0])};
+            } else {
+                const auto [index, inserted] = m_var_indices.try_emplace(std::string(name), m_result.variables.size());
+                if (inserted) m_result.variables.emplace_back(name);
+                token = TypedToken{Token::VAR, static_cast<std::uint32_t>(index->second)};
+            }
+        }
+        const auto push_result = builder.push(token);
+        if (push_result) return fail(*push_result);
     }
+    const auto finish_result = builder.finish();
+    if (finish_result) return fail(*finish_result);
+
+    m_result.success = true;
+    return m_result;
+}
+
+[[nodiscard]] ParseResult create_postfix_expression(const std::string_view infix_expression, const VarMap& var_map) {
+    Parser parser;
+    return parser.parse(infix_expression, var_map);
+}
 
-    std::ranges::reverse(parse_result.result);
-    parse_result.success = true;
-    return parse_result;
+[[nodiscard]] ParseResult create_symbolic_postfix(const std::string_view infix_expression) {
+    Parser parser;
+    return parser.parse_symbolic(infix_expression);
 }
 
 }
@@ -4,13 +4,44 @@
 #define PARSER_H
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
+#include "include/timing.hpp"
 #include "include/types.hpp"
+#include "include/value.hpp"
 
 namespace Parse {
-    [[nodiscard]] Types::ParseResult create_prefix_expression(std::string& infix_expression,
-                                                              const std::unordered_map<char, std::string>& var_map);
+
+// Converts infix expressions to postfix. The lexer output, the operator stack, and the result are kept between
+// calls, so parsing one expression after another doesn't allocate once the buffers have grown.
+// The returned result is only valid until the next call
+class Parser {
+   public:
+    // Expects the expression to be uppercase. Variables and ANS become VAR tokens holding their name in offset,
+    // and the expression is floating point if any of them are. If a stopwatch is given, it's lapped once lexing
+    // is done and the lap is stored in lex_time
+    [[nodiscard]] const Types::ParseResult& parse(const std::string_view infix_expression, const Types::VarMap& var_map,
+                                                  Timing::Stopwatch* const stopwatch = nullptr,
+                                                  Timing::Phase* const lex_time = nullptr);
+    // Symbolic expressions are always boolean, and identifiers other than T and F are treated as variables
+    [[nodiscard]] const Types::ParseResult& parse_symbolic(const std::string_view infix_expression);
+
+   private:
+    void reset();
+    const Types::ParseResult& fail(std::string error_msg);
+
+    Types::ParseResult m_result;
+    std::vector<Types::TypedToken> m_tokens;
+    std::vector<Types::TypedToken> m_operators;
+    std::unordered_map<std::string, std::size_t> m_var_indices;
+};
+
+[[nodiscard]] Types::ParseResult create_postfix_expression(const std::string_view infix_expression,
+                                                           const Types::VarMap& var_map);
+[[nodiscard]] Types::ParseResult create_symbolic_postfix(const std::string_view infix_expression);
+
 }
 
 #endif
@@ -0,0 +1,89 @@
+// Author: Caden LeCluyse
+
+#include "perf/counters.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Perf {
+
+#ifdef __linux__
+
+namespace {
+
+inline constexpr std::array<std::uint64_t, num_events> event_configs = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+[[nodiscard]] int open_event(const std::uint64_t config, const int group_fd) {
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.config = config;
+    attributes.read_format = PERF_FORMAT_GROUP;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    // The leader starts disabled so the whole group is enabled at once
+    attributes.disabled = group_fd == -1 ? 1 : 0;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, group_fd, 0));
+}
+
+}  // namespace
+
+Counters::Counters() {
+    m_fds.fill(-1);
+    for (std::size_t i = 0; i < num_events; ++i) {
+        const int fd = open_event(event_configs[i], m_leader);
+        if (fd == -1) continue;
+        if (m_leader == -1) m_leader = fd;
+        m_fds[i] = fd;
+        m_slots[i] = m_num_open++;
+    }
+    if (m_leader != -1 && ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) == -1) {
+        for (int& fd : m_fds) {
+            if (fd != -1) close(fd);
+            fd = -1;
+        }
+        m_leader = -1;
+    }
+}
+
+Counters::~Counters() {
+    // The leader goes last, closing it first would leave the others running on their own
+    for (const int fd : m_fds) {
+        if (fd != -1 && fd != m_leader) close(fd);
+    }
+    if (m_leader != -1) close(m_leader);
+}
+
+Counts Counters::read() const noexcept {
+    Counts counts;
+    if (m_leader == -1) return counts;
+    // The number of events, then one value for each in the order they were added to the group
+    std::array<std::uint64_t, num_events + 1> buffer{};
+    const ssize_t expected = static_cast<ssize_t>((m_num_open + 1) * sizeof(std::uint64_t));
+    if (::read(m_leader, buffer.data(), sizeof(buffer)) < expected) return counts;
+    for (std::size_t i = 0; i < num_events; ++i) {
+        if (m_fds[i] != -1) counts.values[i] = buffer[m_slots[i] + 1];
+    }
+    return counts;
+}
+
+#else
+
+Counters::Counters() { m_fds.fill(-1); }
+Counters::~Counters() = default;
+Counts Counters::read() const noexcept { return Counts{}; }
+
+#endif
+
+}  // namespace Perf
@@ -0,0 +1,63 @@
+// Author: Caden LeCluyse
+
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace Perf {
+
+enum struct Event { CYCLES, INSTRUCTIONS, CACHE_MISSES, BRANCH_MISSES };
+inline constexpr std::size_t num_events = 4;
+inline constexpr std::array<std::string_view, num_events> event_names = {"cycles", "instructions", "cache misses",
+                                                                          "branch misses"};
+
+// Hardware event counts, indexed by Event
+struct Counts {
+    std::array<std::uint64_t, num_events> values{};
+
+    [[nodiscard]] std::uint64_t operator[](const Event event) const noexcept {
+        return values[static_cast<std::size_t>(event)];
+    }
+    Counts& operator+=(const Counts& other) noexcept {
+        for (std::size_t i = 0; i < num_events; ++i) values[i] += other.values[i];
+        return *this;
+    }
+    Counts& operator-=(const Counts& other) noexcept {
+        for (std::size_t i = 0; i < num_events; ++i) values[i] -= other.values[i];
+        return *this;
+    }
+};
+
+// Hardware counters for the thread that creates them, opened as one perf_event_open group so they're all
+// counted over the same stretch of time, and read with a single system call. Only user space is counted,
+// which is what an unprivileged process is allowed to see. Events the CPU, kernel, or a container doesn't
+// provide are left out and read as 0, and off Linux nothing is ever available
+class Counters {
+   public:
+    Counters();
+    ~Counters();
+    Counters(const Counters&) = delete;
+    Counters& operator=(const Counters&) = delete;
+
+    [[nodiscard]] bool available() const noexcept { return m_leader != -1; }
+    [[nodiscard]] bool available(const Event event) const noexcept {
+        return m_fds[static_cast<std::size_t>(event)] != -1;
+    }
+    // Totals since the counters were opened
+    [[nodiscard]] Counts read() const noexcept;
+
+   private:
+    std::array<int, num_events> m_fds;
+    int m_leader = -1;
+    // The position of each open event in what the group read returns
+    std::array<std::size_t, num_events> m_slots{};
+    std::size_t m_num_open = 0;
+};
+
+}  // namespace Perf
+
+#endif
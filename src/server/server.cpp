@@ -0,0 +1,491 @@
+// Author: Caden LeCluyse
+
+#include "server/server.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <deque>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <mpfr.h>
+#include <mutex>
+#include <optional>
+#include <poll.h>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "engine/signal.h"
+#include "file/file.h"
+#include "include/value.hpp"
+#include "lib/ccalc.h"
+#include "metrics/metrics.h"
+#include "startup/startup.h"
+#include "ui/ui.h"
+
+namespace Server {
+
+namespace {
+
+// A client that sends this much without a newline is disconnected
+inline constexpr std::size_t max_request_size = 1 << 24;
+inline constexpr std::size_t read_chunk_size = 64 * 1024;
+// How often the accepting thread checks for a signal if poll wasn't interrupted by it
+inline constexpr int accept_poll_ms = 250;
+
+// Evaluations run on their own threads, made as they're needed up to this many. Past it, connections wait for
+// one to be free
+inline constexpr std::size_t max_evaluators = 64;
+
+[[nodiscard]] bool set_nonblocking(const int fd) {
+    const int flags = fcntl(fd, F_GETFL, 0);
+    return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+// A full pipe already wakes the poll, so the byte isn't needed
+void wake(const int wake_fd) {
+    const char byte = 0;
+    [[maybe_unused]] const ssize_t written = write(wake_fd, &byte, 1);
+}
+
+struct Connection {
+    Connection(const int _fd, const int _wake_fd, const CCalc::Settings& settings, const Types::VarMap& vars,
+               Metrics::Writer* const _metrics)
+        : fd(_fd), wake_fd(_wake_fd), context(settings), metrics(_metrics) {
+        context.variables() = vars;
+        // A long expression stops when the server is told to, rather than holding up the shutdown
+        context.set_cancel_flag(Signal::cancel_flag());
+    }
+    ~Connection() { close(fd); }
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    const int fd;
+    const int wake_fd; // Wakes the worker that reads and writes the connection
+    CCalc::Context context;
+    Metrics::Writer* const metrics;
+
+    // Only touched by the worker
+    std::string input;
+    std::string output;
+    std::size_t written = 0;
+    bool closing = false; // Nothing more will be read, the connection closes once every reply is sent
+
+    // Shared between the worker and the evaluators
+    std::mutex mutex;
+    std::deque<std::optional<std::string> > requests; // An empty optional for a request that was too long
+    std::string replies;
+    bool queued = false; // Waiting for or held by an evaluator, which is the only thread using the context
+};
+
+[[nodiscard]] std::string evaluate_line(Connection& connection, std::string_view line) {
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    const CCalc::Result result = connection.metrics ? connection.metrics->evaluate(connection.context, line)
+                                                    : connection.context.evaluate(line);
+    std::string reply = result.success ? "Result: " : "Error: ";
+    reply += result.text;
+    reply += '\n';
+    return reply;
+}
+
+// Evaluates the requests of every connection, one at a time for each connection and in the order they were sent.
+// Another thread is made whenever a connection is waiting and none is free, so a long evaluation only holds up
+// the connection that sent it
+class Evaluators {
+   public:
+    Evaluators() = default;
+    ~Evaluators() { stop(); }
+    Evaluators(const Evaluators&) = delete;
+    Evaluators& operator=(const Evaluators&) = delete;
+
+    [[nodiscard]] bool start() {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        return add_thread();
+    }
+
+    // Called once the connection has requests and isn't queued already
+    void submit(std::shared_ptr<Connection> connection) {
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stopping) return;
+            m_queue.push_back(std::move(connection));
+            if (m_queue.size() > m_threads.size() - m_busy && m_threads.size() < max_evaluators) {
+                // If it can't be made, the connection waits for one of the others
+                [[maybe_unused]] const bool added = add_thread();
+            }
+        }
+        m_ready.notify_one();
+    }
+
+    void stop() {
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_ready.notify_all();
+        for (auto& thread : m_threads) {
+            if (thread.joinable()) thread.join();
+        }
+        m_threads.clear();
+        m_queue.clear();
+    }
+
+   private:
+    // Called with the mutex held
+    [[nodiscard]] bool add_thread() {
+        try {
+            m_threads.emplace_back(&Evaluators::run, this);
+        } catch (const std::system_error&) {
+            return false;
+        }
+        return true;
+    }
+
+    // Answers the oldest request of the connection. Returns whether it has more
+    [[nodiscard]] static bool evaluate_next(Connection& connection) {
+        std::optional<std::string> request;
+        {
+            const std::lock_guard<std::mutex> lock(connection.mutex);
+            request = std::move(connection.requests.front());
+            connection.requests.pop_front();
+        }
+        const std::string reply = request ? evaluate_line(connection, *request) : "Error: Request too long\n";
+        bool more;
+        {
+            const std::lock_guard<std::mutex> lock(connection.mutex);
+            connection.replies += reply;
+            more = !connection.requests.empty();
+            connection.queued = more;
+        }
+        wake(connection.wake_fd);
+        return more;
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_ready.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_stopping) break;
+            std::shared_ptr<Connection> connection = std::move(m_queue.front());
+            m_queue.pop_front();
+            ++m_busy;
+            lock.unlock();
+            const bool more = evaluate_next(*connection);
+            lock.lock();
+            --m_busy;
+            // To the back, so a connection sending many requests takes turns with the others
+            if (more) m_queue.push_back(std::move(connection));
+        }
+        lock.unlock();
+        // MPFR caches constants like pi per thread, they're kept warm between requests and freed here
+        mpfr_free_cache();
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_ready;
+    std::deque<std::shared_ptr<Connection> > m_queue;
+    std::vector<std::thread> m_threads;
+    std::size_t m_busy = 0;
+    bool m_stopping = false;
+};
+
+// Queues every complete line. When the client is done sending, whatever is left is the last request
+void queue_requests(const std::shared_ptr<Connection>& connection, Evaluators& evaluators, const bool end_of_input) {
+    std::vector<std::optional<std::string> > lines;
+    std::size_t start = 0;
+    for (std::size_t newline; (newline = connection->input.find('\n', start)) != std::string::npos;
+         start = newline + 1) {
+        lines.emplace_back(connection->input.substr(start, newline - start));
+    }
+    connection->input.erase(0, start);
+
+    if (end_of_input && !connection->input.empty()) {
+        lines.emplace_back(std::move(connection->input));
+        connection->input.clear();
+    } else if (connection->input.size() > max_request_size) {
+        lines.emplace_back(std::nullopt);
+        connection->input.clear();
+        connection->closing = true;
+    }
+    if (lines.empty()) return;
+
+    bool submit;
+    {
+        const std::lock_guard<std::mutex> lock(connection->mutex);
+        for (auto& line : lines) connection->requests.push_back(std::move(line));
+        submit = !connection->queued;
+        connection->queued = true;
+    }
+    if (submit) evaluators.submit(connection);
+}
+
+// Returns false if the connection failed
+[[nodiscard]] bool read_requests(const std::shared_ptr<Connection>& connection, Evaluators& evaluators) {
+    char buffer[read_chunk_size];
+    while (true) {
+        const ssize_t received = recv(connection->fd, buffer, sizeof(buffer), 0);
+        if (received > 0) {
+            connection->input.append(buffer, static_cast<std::size_t>(received));
+            if (static_cast<std::size_t>(received) < sizeof(buffer)) break;
+            continue;
+        }
+        if (received == 0) {
+            connection->closing = true;
+            break;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        return false;
+    }
+    queue_requests(connection, evaluators, connection->closing);
+    return true;
+}
+
+// Moves the replies the evaluators finished behind the output
+void take_replies(Connection& connection) {
+    const std::lock_guard<std::mutex> lock(connection.mutex);
+    connection.output += connection.replies;
+    connection.replies.clear();
+}
+
+// Nothing more will be read and every reply has been sent
+[[nodiscard]] bool finished(Connection& connection) {
+    if (!connection.closing || !connection.output.empty()) return false;
+    const std::lock_guard<std::mutex> lock(connection.mutex);
+    return !connection.queued && connection.replies.empty();
+}
+
+// Sends as much of the output as the socket takes without blocking. Returns false if the connection failed
+[[nodiscard]] bool write_responses(Connection& connection) {
+    while (connection.written < connection.output.size()) {
+        const ssize_t sent = send(connection.fd, connection.output.data() + connection.written,
+                                  connection.output.size() - connection.written, 0);
+        if (sent >= 0) {
+            connection.written += static_cast<std::size_t>(sent);
+            continue;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+        return false;
+    }
+    connection.output.clear();
+    connection.written = 0;
+    return true;
+}
+
+// Each worker only reads and writes its own connections, waiting on them with poll, and hands the requests to the
+// evaluators. New connections and finished replies wake the poll up through a pipe
+class Worker {
+   public:
+    Worker(const CCalc::Settings& settings, const Types::VarMap& vars, Metrics::Writer* const metrics,
+           Evaluators& evaluators)
+        : m_settings(settings), m_vars(vars), m_metrics(metrics), m_evaluators(evaluators) {}
+    ~Worker() {
+        if (m_wake[0] != -1) close(m_wake[0]);
+        if (m_wake[1] != -1) close(m_wake[1]);
+    }
+    Worker(const Worker&) = delete;
+    Worker& operator=(const Worker&) = delete;
+
+    [[nodiscard]] bool start() {
+        if (pipe(m_wake) == -1 || !set_nonblocking(m_wake[0]) || !set_nonblocking(m_wake[1])) return false;
+        m_thread = std::thread(&Worker::run, this);
+        return true;
+    }
+
+    void add(const int fd) {
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending.push_back(fd);
+        }
+        wake(m_wake[1]);
+    }
+
+    void stop() {
+        m_stopping.store(true, std::memory_order_relaxed);
+        wake(m_wake[1]);
+        if (m_thread.joinable()) m_thread.join();
+    }
+
+   private:
+    void take_pending() {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        for (const int fd : m_pending) {
+            m_connections.push_back(std::make_shared<Connection>(fd, m_wake[1], m_settings, m_vars, m_metrics));
+        }
+        m_pending.clear();
+    }
+
+    void run() {
+        std::vector<pollfd> poll_fds;
+        while (!m_stopping.load(std::memory_order_relaxed)) {
+            poll_fds.clear();
+            poll_fds.push_back(pollfd{m_wake[0], POLLIN, 0});
+            for (const auto& connection : m_connections) {
+                const short events = static_cast<short>((connection->closing ? 0 : POLLIN) |
+                                                        (connection->output.empty() ? 0 : POLLOUT));
+                // A connection only waiting on its evaluation would report its hang up on every poll
+                poll_fds.push_back(pollfd{events == 0 ? -1 : connection->fd, events, 0});
+            }
+            if (poll(poll_fds.data(), poll_fds.size(), -1) == -1) continue;
+
+            // Drained before the replies are taken, so a reply finished after this wakes the next poll
+            const bool woken = poll_fds[0].revents & POLLIN;
+            if (woken) {
+                char drain[64];
+                while (read(m_wake[0], drain, sizeof(drain)) > 0) {}
+            }
+
+            const std::size_t num_polled = poll_fds.size() - 1;
+            for (std::size_t i = 0; i < num_polled; ++i) {
+                const std::shared_ptr<Connection>& connection = m_connections[i];
+                const short revents = poll_fds[i + 1].revents;
+                bool alive = true;
+                if (!connection->closing && (revents & (POLLIN | POLLHUP))) {
+                    alive = read_requests(connection, m_evaluators);
+                }
+                if (revents & (POLLERR | POLLNVAL)) alive = false;
+                take_replies(*connection);
+                if (alive && !connection->output.empty()) alive = write_responses(*connection);
+                // An evaluator still holding a connection that failed keeps it open until it's done with it
+                if (!alive || finished(*connection)) m_connections[i].reset();
+            }
+            std::erase(m_connections, nullptr);
+            if (woken) take_pending();
+        }
+
+        m_connections.clear();
+        take_pending();
+        m_connections.clear();
+    }
+
+    const CCalc::Settings& m_settings;
+    const Types::VarMap& m_vars;
+    Metrics::Writer* const m_metrics;
+    Evaluators& m_evaluators;
+    int m_wake[2] = {-1, -1};
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::vector<int> m_pending;
+    std::vector<std::shared_ptr<Connection> > m_connections;
+    std::atomic<bool> m_stopping{false};
+};
+
+[[nodiscard]] int open_socket(const std::string& socket_path) {
+    sockaddr_un address{};
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        UI::print_error("Socket path is too long");
+        return -1;
+    }
+    address.sun_family = AF_UNIX;
+    std::copy(socket_path.begin(), socket_path.end(), address.sun_path);
+
+    // A socket left behind by a server that didn't shut down cleanly refuses connections and is replaced. One that
+    // a server is still listening on, and anything else, is left alone
+    struct stat status;
+    if (lstat(socket_path.c_str(), &status) == 0) {
+        if (!S_ISSOCK(status.st_mode)) {
+            UI::print_error(socket_path + " already exists and isn't a socket");
+            return -1;
+        }
+        const int probe_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        const bool refused = probe_fd != -1 && set_nonblocking(probe_fd) &&
+                             connect(probe_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1 &&
+                             errno == ECONNREFUSED;
+        if (probe_fd != -1) close(probe_fd);
+        if (!refused) {
+            UI::print_error(socket_path + " is in use by another server");
+            return -1;
+        }
+        unlink(socket_path.c_str());
+    }
+
+    const int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd == -1) {
+        UI::print_error("Unable to create socket");
+        return -1;
+    }
+    if (bind(listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1 ||
+        listen(listen_fd, SOMAXCONN) == -1) {
+        UI::print_error("Unable to listen on " + socket_path);
+        close(listen_fd);
+        return -1;
+    }
+    return listen_fd;
+}
+
+}  // namespace
+
+int serve(const std::string& socket_path, Metrics::Writer* const metrics) {
+    const int listen_fd = open_socket(socket_path);
+    if (listen_fd == -1) return 1;
+
+    // A client that disconnects early shouldn't take the server down with it
+    std::signal(SIGPIPE, SIG_IGN);
+    Signal::register_handlers();
+
+    const CCalc::Settings settings = Startup::calculator_settings();
+    Types::VarMap vars;
+    File::read_vars(vars, Startup::var_map_location);
+
+    // The workers block the signals so they're delivered to this thread and interrupt its poll
+    sigset_t signals;
+    sigset_t previous;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, &previous);
+    Evaluators evaluators;
+    const unsigned num_workers = evaluators.start() ? std::max(1U, std::thread::hardware_concurrency()) : 0;
+    std::vector<std::unique_ptr<Worker> > workers;
+    for (unsigned i = 0; i < num_workers; ++i) {
+        workers.push_back(std::make_unique<Worker>(settings, vars, metrics, evaluators));
+        if (!workers.back()->start()) {
+            workers.pop_back();
+            break;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+
+    int exit_code = 0;
+    if (workers.empty()) {
+        UI::print_error("Unable to start worker threads");
+        exit_code = 1;
+    } else {
+        std::cout << "Listening on " << socket_path << " with " << workers.size() << " workers" << std::endl;
+    }
+
+    std::size_t next_worker = 0;
+    while (!workers.empty() && !Signal::signal_received()) {
+        pollfd listen_poll{listen_fd, POLLIN, 0};
+        if (poll(&listen_poll, 1, accept_poll_ms) <= 0) continue;
+        const int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd == -1) continue;
+        if (!set_nonblocking(fd)) {
+            close(fd);
+            continue;
+        }
+        workers[next_worker]->add(fd);
+        next_worker = (next_worker + 1) % workers.size();
+    }
+
+    // The workers go first so nothing more is submitted, the evaluators still write to their pipes until stopped
+    for (auto& worker : workers) worker->stop();
+    evaluators.stop();
+    close(listen_fd);
+    unlink(socket_path.c_str());
+    std::cout << "Exiting...\n";
+    return exit_code;
+}
+
+}  // namespace Server
@@ -0,0 +1,20 @@
+// Author: Caden LeCluyse
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <string>
+
+#include "metrics/metrics.h"
+
+namespace Server {
+
+// Serves expressions on a Unix domain socket until SIGINT or SIGTERM, returns the exit code.
+// Clients send one expression per line and get one line back for each, "Result: ..." or "Error: ...".
+// Every connection has its own variables, starting from the saved ones, and nothing is written back.
+// Every request is recorded in metrics if it isn't null
+[[nodiscard]] int serve(const std::string& socket_path, Metrics::Writer* const metrics);
+
+}  // namespace Server
+
+#endif
@@ -9,12 +9,15 @@
 #include <string>
 #include <string_view>
 #include <iostream>
+#include <limits>
 #include <unistd.h>
 #include <unordered_map>
 
 #include "engine/signal.h"
 #include "file/file.h"
 #include "include/types.hpp"
+#include "include/value.hpp"
+#include "parallel/pool.h"
 #include "ui/ui.h"
 
 using namespace Types;
@@ -39,6 +42,19 @@ bool create_ini(const std::filesystem::path& full_path) {
             for (std::size_t i = 0; i < num_settings; ++i) {
                 // Comment for angle setting
                 if (setting_fields[i] == "angle=") file << "# angle=0 (radians) or angle=1 (degrees)\n";
+                if (setting_fields[i] == "save_oneshot=") {
+                    file << "# save_oneshot=1 adds expressions passed as an argument to the history and saves ANS\n";
+                }
+                if (setting_fields[i] == "max_memory=") {
+                    file << "# max_memory is the most memory in MiB one expression can use, 0 means no limit\n";
+                }
+                if (setting_fields[i] == "timeout=") {
+                    file << "# timeout is the most time in milliseconds one expression can take, 0 means no limit\n";
+                }
+                if (setting_fields[i] == "threads=") {
+                    file << "# threads is how many cores one long expression can use, 0 means all of them\n";
+                }
+                if (setting_fields[i] == "base=") file << "# base=2, 8, 10 or 16 for integer results\n";
                 file << setting_fields[i] << default_setting_values[i] << '\n'; 
             }
             return true;
@@ -66,7 +82,10 @@ bool create_ini(const std::filesystem::path& full_path) {
 
     const std::string_view key = std::string_view(line).substr(0, equal_pos);
     const std::string_view value_string = std::string_view(line).substr(equal_pos + 1);
-    if (key == "angle" && value_string != "0" && value_string != "1") {
+    if ((key == "angle" || key == "save_oneshot") && value_string != "0" && value_string != "1") {
+        return create_ini_return_false(full_path);
+    }
+    if (key == "base" && value_string != "2" && value_string != "8" && value_string != "10" && value_string != "16") {
         return create_ini_return_false(full_path);
     }
     if(!std::ranges::all_of(value_string, ::isdigit)) [[unlikely]] {
@@ -104,6 +123,12 @@ inline std::unordered_map<Types::Setting, long> create_default_settings_map() {
     return retval;
 }
 
+// Limits too big to count in bytes are as good as no limit
+[[nodiscard]] std::size_t mib_to_bytes(const long mib) {
+    const auto size = static_cast<std::size_t>(mib);
+    return size > (std::numeric_limits<std::size_t>::max() >> 20) ? 0 : size << 20;
+}
+
 [[nodiscard]] std::filesystem::path get_history_location() {
     const std::string home = get_home_path();
     if (home.empty()) return std::filesystem::path(Types::history_file_name);
@@ -116,6 +141,12 @@ inline std::unordered_map<Types::Setting, long> create_default_settings_map() {
     return home / std::filesystem::path(Types::vars_filename);
 }
 
+[[nodiscard]] std::filesystem::path get_state_location() {
+    const std::string home = get_home_path();
+    if (home.empty()) return std::filesystem::path(Types::state_filename);
+    return home / std::filesystem::path(Types::state_filename);
+}
+
 }
 
 [[nodiscard]] std::unordered_map<Setting, long> source_ini() noexcept {
@@ -143,6 +174,10 @@ inline std::unordered_map<Types::Setting, long> create_default_settings_map() {
         if (line[0] == '#') continue; // Ignore comments
         if(!create_retval(line, full_path, retval)) return create_default_settings_map();
     }
+    // Settings added after the file was written get their default value
+    for (std::size_t i = 0; i < num_settings; ++i) {
+        retval.try_emplace(setting_keys[i], default_setting_values[i]);
+    }
     if (!final_verification(full_path, retval)) return create_default_settings_map();
 
     return retval;
@@ -150,21 +185,29 @@ inline std::unordered_map<Types::Setting, long> create_default_settings_map() {
 
 const std::string history_location = get_history_location();
 const std::string var_map_location = get_vars_location();
-const std::unordered_map<Types::Setting, long> settings = source_ini();
+const std::string state_location = get_state_location();
+const std::unordered_map<Types::Setting, long>& settings() {
+    static const std::unordered_map<Types::Setting, long> loaded = source_ini();
+    return loaded;
+}
+
+CCalc::Settings calculator_settings() {
+    return CCalc::Settings{settings().at(Setting::PRECISION), settings().at(Setting::DISPLAY_PREC),
+                           settings().at(Setting::ANGLE) == 1,
+                           mib_to_bytes(settings().at(Setting::MAX_MEMORY)), settings().at(Setting::TIMEOUT),
+                           static_cast<unsigned>(std::min<long>(settings().at(Setting::THREADS),
+                                                                Parallel::max_threads)),
+                           static_cast<unsigned>(settings().at(Setting::BASE))};
+}
 
-void startup(std::vector<std::pair<std::string, std::string> >& history,
-             std::unordered_map<char, std::string>& var_map) {
+void startup(History::Ring& history, VarMap& var_map, File::Journal& journal) {
     using_history();
-    stifle_history(static_cast<int>(Startup::settings.at(Setting::MAX_HISTORY)));
+    stifle_history(static_cast<int>(std::min(history.max_entries(), History::recall_limit)));
     rl_event_hook = Signal::check_signals_hook;
     rl_catch_signals = 0;
 
-    std::ifstream file;
-    file.open(history_location);
-    if(file.is_open()) File::read_history(history, file);
-    file.close();
-    file.open(var_map_location);
-    if(file.is_open()) File::read_vars(var_map, file);
+    journal.load(history);
+    File::read_vars(var_map, var_map_location);
 
     Signal::register_handlers();
 }
@@ -6,41 +6,68 @@
 #include <mpfr.h>
 #include <unordered_map>
 
+#include "file/journal.h"
+#include "history/history.h"
 #include "include/types.hpp"
+#include "include/value.hpp"
+#include "lib/ccalc.h"
 
 namespace Startup {
 
-inline constexpr std::size_t num_settings = 4;
+inline constexpr std::size_t num_settings = 9;
 inline constexpr std::array<Types::Setting, num_settings> setting_keys = {
     Types::Setting::PRECISION,
     Types::Setting::DISPLAY_PREC,
     Types::Setting::MAX_HISTORY,
-    Types::Setting::ANGLE
+    Types::Setting::ANGLE,
+    Types::Setting::SAVE_ONESHOT,
+    Types::Setting::MAX_MEMORY,
+    Types::Setting::TIMEOUT,
+    Types::Setting::THREADS,
+    Types::Setting::BASE
 };
 inline constexpr long default_precision = 320;
 inline constexpr long default_digits = 15;
 inline constexpr long default_history_max = 50;
 inline constexpr long default_angle = 0; // 0 is radians, 1 is degrees
+inline constexpr long default_save_oneshot = 0; // 1 adds one shot expressions to the history and saves ANS
+inline constexpr long default_max_memory = 1024; // In MiB, 0 is no limit
+inline constexpr long default_timeout = 0; // In milliseconds, 0 is no limit
+inline constexpr long default_threads = 0; // 0 is one per core
+inline constexpr long default_base = 10; // 2, 8, 10 or 16
 inline constexpr std::array<std::string_view, num_settings> setting_fields = {
     "precision=",
     "display_digits=",
     "max_history=",
-    "angle="
+    "angle=",
+    "save_oneshot=",
+    "max_memory=",
+    "timeout=",
+    "threads=",
+    "base="
 };
 inline constexpr std::array<long, num_settings> default_setting_values = {
     default_precision,
     default_digits,
     default_history_max,
-    default_angle
+    default_angle,
+    default_save_oneshot,
+    default_max_memory,
+    default_timeout,
+    default_threads,
+    default_base
 };
 
 [[nodiscard]] std::unordered_map<Types::Setting, long> source_ini() noexcept;
-extern const std::unordered_map<Types::Setting, long> settings;
+// settings.ini is read the first time this is called, so flags like --version never touch it
+[[nodiscard]] const std::unordered_map<Types::Setting, long>& settings();
 extern const std::string history_location;
 extern const std::string var_map_location;
+extern const std::string state_location;
 
-void startup(std::vector<std::pair<std::string, std::string> >& history,
-             std::unordered_map<char, std::string>& var_map);
+// The settings from settings.ini that the calculator itself uses
+[[nodiscard]] CCalc::Settings calculator_settings();
+void startup(History::Ring& history, Types::VarMap& var_map, File::Journal& journal);
 }
 
 #endif
@@ -3,6 +3,7 @@
 #include "ui/ui.h"
 
 #include <gmpxx.h>
+#include <iomanip>
 #include <iostream>
 #include <mpfr.h>
 #include <readline/history.h>
@@ -10,8 +11,9 @@
 #include <string>
 #include <unordered_map>
 
+#include "lib/ccalc.h"
+#include "memory/memory.h"
 #include "startup/startup.h"
-#include "include/util.hpp"
 #include "version.hpp"
 
 namespace UI {
@@ -29,9 +31,22 @@ void print_insufficient_arguments() {
 
 void print_help_continuous() {
     std::cout << "* Enter 'history' to view your history.\n"
+              << "* Enter 'history [text]' to view the entries whose expression contains the text.\n"
+              << "* Enter 'history =[result]' to view the entries with that result.\n"
               << "* Enter 'vars' to view assigned variables.\n"
               << "* Enter 'save' to save your program history to a file.\n"
               << "* Enter 'clear' to clear your history.\n"
+              << "* Enter 'stats' to turn printing the timing and operation counts of each expression on or off.\n"
+              << "* End an expression with '&' to evaluate it in the background, its result goes in the history and ANS when it's done.\n"
+              << "* End an expression with '@hex', '@oct', '@bin', or '@dec' to print its result in that base.\n"
+              << "* Enter 'jobs' to view the expressions running in the background.\n"
+              << "* Enter 'wait [number]' to wait for a background expression to finish, or 'wait' to wait for all of them.\n"
+              << "* Enter 'kill [number]' to stop a background expression.\n"
+              << "* Enter 'sat [expression]' to check if a boolean expression with variables is satisfiable.\n"
+              << "* Enter 'sat [file.cnf]' to solve a DIMACS CNF file.\n"
+              << "* Enter 'anf [expression]' to print the algebraic normal form of a boolean expression.\n"
+              << "* Enter 'minimize [expression]' to print a smaller sum of products for a boolean expression.\n"
+              << "* Press Ctrl-C while an expression is being evaluated to stop it, or at the prompt to exit.\n"
               << "* Enter 'exit', 'quit', or 'q' to exit the program.\n\n";
 }
 
@@ -39,34 +54,167 @@ void print_result(const std::string_view result) {
     std::cout << "Result: " << result << '\n';
 }
 
+void print_result_piece(const std::string_view piece, const bool first) {
+    if (first) std::cout << "Result: ";
+    std::cout << piece;
+}
+
+void print_result_end() { std::cout << '\n'; }
+
 void print_error(const std::string_view error) {
     std::cerr << "Error: " << error << '\n';
 }
 
-std::string print_mpfr(const mpfr_t& final_value, const mpfr_prec_t display_precision) {
-    std::string buffer;
-    // Resize the buffer to the display precision from config, and add 2 bytes for good measure
-    buffer.resize(static_cast<std::size_t>(Startup::settings.at(Types::Setting::DISPLAY_PREC)) + 2);
-    if(!Util::convert_mpfr_string(buffer, final_value, display_precision)) [[unlikely]] return "";
-    UI::print_result(buffer);
-    return buffer; 
+void print_job_started(const std::size_t id) {
+    std::cout << '[' << id << "] Running in the background\n";
+}
+
+void print_job_finished(const Jobs::Finished& job) {
+    if (job.killed) {
+        std::cout << '[' << job.id << "] Killed: " << job.input << '\n';
+        return;
+    }
+    std::cout << '[' << job.id << "] Done: " << job.input << '\n';
+    if (job.result.success) {
+        print_result(job.result.text);
+    } else {
+        std::cout.flush();
+        print_error(job.result.text);
+    }
+}
+
+void print_jobs(const std::span<const Jobs::Running> jobs) {
+    std::cout << std::fixed << std::setprecision(1);
+    for (const auto& job : jobs) {
+        std::cout << '[' << job.id << "] Running for " << job.seconds << "s: " << job.input << '\n';
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
+
+void print_history(const History::Ring& history) {
+    for (std::size_t i = 0; i < history.size(); ++i) {
+        const auto& [expression, result] = history[i];
+        std::cout << "Expression: " << expression << "\nResult: " << result << '\n';
+    }
 }
 
-void print_history(const std::span<const std::pair<std::string, std::string> > history) {
-    std::ranges::for_each(history, [](const auto& expression_result) {
-        const auto& [expression, result] = expression_result;
+void print_history(const History::Ring& history, const std::span<const std::size_t> positions) {
+    std::ranges::for_each(positions, [&history](const std::size_t position) {
+        const auto& [expression, result] = history[position];
         std::cout << "Expression: " << expression << "\nResult: " << result << '\n';
     });
 }
 
-void print_vars(const std::unordered_map<char, std::string>& vars) {
-    std::ranges::for_each(vars, [](const auto& expression_result) {
-        const auto& [var, result] = expression_result;
+void print_vars(const Types::VarMap& vars) {
+    const long display_digits = Startup::settings().at(Types::Setting::DISPLAY_PREC);
+    const auto threads = static_cast<unsigned>(Startup::settings().at(Types::Setting::THREADS));
+    const auto base = static_cast<unsigned>(Startup::settings().at(Types::Setting::BASE));
+    std::ranges::for_each(vars, [display_digits, threads, base](const auto& var_value) {
+        const auto& [var, value] = var_value;
         if (var == '\0') return;
-        std::cout << var << ": " << result << '\n';
+        std::cout << var << ": " << CCalc::format_value(value, display_digits, threads, base) << '\n';
     });
 }
 
+void print_stats(const CCalc::Stats& stats) {
+    const auto print_phase = [](const std::string_view phase, const Timing::Phase& time) {
+        std::cout << "  " << std::left << std::setw(11) << phase << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(12) << time.wall * 1e6 << " us" << std::setw(12) << time.cpu * 1e6 << " us\n";
+    };
+    std::cout << "Stats:" << std::setw(22) << "wall" << std::setw(15) << "cpu" << '\n';
+    print_phase("normalize", stats.normalize);
+    if (stats.built) {
+        print_phase("lex", stats.lex);
+        print_phase("parse", stats.parse);
+        print_phase("build", stats.build);
+    }
+    print_phase("evaluate", stats.evaluate);
+    if (stats.built) print_phase("format", stats.format);
+    std::cout.unsetf(std::ios::floatfield);
+    if (Memory::tracking()) {
+        std::cout << "  Memory: " << stats.peak_memory << " bytes at peak, " << stats.allocated
+                  << " bytes allocated\n";
+    }
+
+    if (!stats.built) {
+        std::cout << "  A single value, the parser and the tree were skipped\n";
+        return;
+    }
+    std::cout << "  Tokens: " << stats.tokens << '\n';
+    std::cout << "  Nodes: " << stats.values << " values, " << stats.variables << " variables, " << stats.operations
+              << " binary operations, ";
+    if (stats.is_math) std::cout << stats.trig << " trig, " << stats.factorials << " factorials, ";
+    std::cout << stats.negations << (stats.is_math ? " negations\n" : " nots\n");
+    if (!stats.is_math) {
+        std::cout << "  Boolean operations: " << stats.operator_nodes() << '\n';
+        return;
+    }
+    std::cout << "  MPFR/GMP operations: " << stats.operator_nodes() << '\n';
+    if (stats.precision != 0) {
+        std::cout << "  Precision: " << stats.precision << " bits\n";
+    } else {
+        std::cout << "  Precision: exact integers\n";
+    }
+}
+
+void print_phase_counters(const Metrics::PhaseCounters& phase_counters) {
+    const Perf::Counters& counters = phase_counters.counters();
+    const Metrics::PhaseTotals& totals = phase_counters.totals();
+    std::cout << "Counters over " << totals.expressions << " expressions, " << totals.trees << " parsed with "
+              << totals.nodes << " nodes:\n";
+    if (!counters.available()) {
+        std::cout << "  Hardware counters aren't available here, only times are shown\n";
+    }
+
+    std::cout << "  " << std::left << std::setw(11) << "phase" << std::right << std::setw(14) << "wall";
+    if (counters.available()) {
+        for (const std::string_view name : Perf::event_names) std::cout << std::setw(15) << name;
+        std::cout << std::setw(7) << "IPC";
+    }
+    std::cout << '\n';
+
+    const auto print_phase = [&counters](const std::string_view phase, const Timing::Phase& time) {
+        std::cout << "  " << std::left << std::setw(11) << phase << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(11) << time.wall * 1e3 << " ms";
+        if (counters.available()) {
+            for (std::size_t i = 0; i < Perf::num_events; ++i) {
+                std::cout << std::setw(15);
+                if (counters.available(static_cast<Perf::Event>(i))) {
+                    std::cout << time.counts.values[i];
+                } else {
+                    std::cout << '-';
+                }
+            }
+            const std::uint64_t cycles = time.counts[Perf::Event::CYCLES];
+            std::cout << std::setw(7) << std::setprecision(2);
+            if (cycles != 0 && counters.available(Perf::Event::INSTRUCTIONS)) {
+                std::cout << static_cast<double>(time.counts[Perf::Event::INSTRUCTIONS]) / static_cast<double>(cycles);
+            } else {
+                std::cout << '-';
+            }
+        }
+        std::cout << '\n';
+    };
+    print_phase("normalize", totals.normalize);
+    print_phase("lex", totals.lex);
+    print_phase("parse", totals.parse);
+    print_phase("build", totals.build);
+    print_phase("evaluate", totals.evaluate);
+    print_phase("format", totals.format);
+
+    // Every node is its own allocation, so misses per node show whether walking the tree is what misses
+    if (totals.nodes != 0 && counters.available(Perf::Event::CACHE_MISSES)) {
+        const auto per_node = [&totals](const Timing::Phase& time) {
+            return static_cast<double>(time.counts[Perf::Event::CACHE_MISSES]) / static_cast<double>(totals.nodes);
+        };
+        std::cout << "  Cache misses per node: " << per_node(totals.build) << " building, "
+                  << per_node(totals.evaluate) << " evaluating\n";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
+
 void print_version() {
     std::cout << "Version: " << PROGRAM_VERSION_MAJOR << "." << PROGRAM_VERSION_MINOR << "." << PROGRAM_VERSION_PATCH
               << "\n\n";
@@ -82,6 +230,16 @@ void print_help() {
               << std::endl
               << "\t - The [-v|--version] flag prints the version of the program.\n"
               << "\t - The [-H|--history] flag prints the program history.\n"
+              << "\t - The [--serve /path/to/socket] flag runs a server on a Unix domain socket. Clients send one "
+                 "expression per line and get one result per line back.\n"
+              << "\t - The [--stats 'expression'] flag evaluates the expression and prints how long each phase took, the "
+                 "nodes in the tree, the precision used, and the peak memory.\n"
+              << "\t - The [--metrics out.jsonl] flag goes before -f or --serve, and appends a JSON record with the "
+                 "timings, size, and allocations of every expression evaluated to the file.\n"
+              << "\t - The [--counters] flag goes before -c, -f, --stats, or an expression, and prints the CPU cycles, "
+                 "instructions, cache misses, and branch misses of each phase when the program finishes.\n"
+              << "\t - The [--pool] flag goes before every other flag, and gets the memory for small numbers from "
+                 "per-thread free lists instead of malloc.\n"
               << "\t - The [-h|--help] flag prints this screen.\n\n"
               << "* If no flags are passed in, the program expects an expression to be passed in. Wrap the expression "
                  "in single quotes.\n"
@@ -94,6 +252,14 @@ void print_help() {
               << "\t - NAND (@) returns True when both values are not True simultaneously. (T @ F = T).\n"
               << "\t - NOR ($) returns True when both values are false. (F $ F = T).\n"
               << "\t - NOT (!) negates the value it is in front of. (!F = T).\n\n"
+              << "* Logic commands:\n"
+              << "\t - 'sat [expression]' checks if a boolean expression with variables (A & !B1) can be True, and "
+                 "prints a satisfying assignment.\n"
+              << "\t - 'sat [file.cnf]' solves a CNF formula in DIMACS format.\n"
+              << "\t - 'anf [expression]' prints the algebraic normal form (XOR of ANDs) of a boolean expression "
+                 "with up to 34 variables, along with its degree and number of monomials.\n"
+              << "\t - 'minimize [expression]' prints a smaller sum of products (ORs of ANDs) for a boolean "
+                 "expression with up to 24 variables, or the expression itself if it's already smaller.\n\n"
               << "* Arithmetic operations:\n"
               << "\t - Addition (+) Adds two numbers together (2 + 2 = 4).\n"
               << "\t - Subtraction (-) Subtracts two numbers (3 - 2 = 1).\n"
@@ -106,6 +272,7 @@ void print_help() {
               << "* Variables:\n"
               << "\t - CCalc supports setting your own variables that persist between program sessions.\n"
               << "\t - To set a variable, the program expects the following format: [character] = [expression]\n"
+              << "\t - Variables and ANS keep the full precision of the result, not just the printed digits.\n"
               << "\t - Pi and e are preset variables available for use.\n\n"
               << "* Program settings:\n"
               << "\t - You can modify the settings of the program by editing ~/.config/ccalc/settings.ini\n"
@@ -113,6 +280,11 @@ void print_help() {
               << "\t - The 'display_digits=' field is set in digits, and it modifies the precision when printing the result (default = 15).\n"
               << "\t - The 'max_history=' field sets the maximum entries of the history when in continuous mode (default = 50).\n"
               << "\t - The 'angle=' setting specifies whether the program is using radians or degrees. 0 means radians, 1 means degrees (default = 0).\n"
+              << "\t - The 'save_oneshot=' setting specifies whether expressions passed as an argument are added to the history and saved as ANS. 0 means no, 1 means yes (default = 0).\n"
+              << "\t - The 'max_memory=' field is set in MiB, and it limits the memory one expression can use. 0 means no limit (default = 1024).\n"
+              << "\t - The 'timeout=' field is set in milliseconds, and it limits the time one expression can take. 0 means no limit (default = 0).\n"
+              << "\t - The 'threads=' field sets how many cores one long floating point expression, or the printing of a huge integer, can be split across. 0 means all of them (default = 0).\n"
+              << "\t - The 'base=' field sets the base integer results are printed in, 2, 8, 10, or 16. End an expression with @hex, @oct, @bin, or @dec to pick one for that expression (default = 10).\n"
               << std::endl;
 }
 
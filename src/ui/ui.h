@@ -10,16 +10,30 @@
 #include <string>
 #include <unordered_map>
 
+#include "engine/jobs.h"
+#include "history/history.h"
+#include "include/value.hpp"
+#include "lib/ccalc.h"
+#include "metrics/metrics.h"
+
 namespace UI {
 
 void print_excessive_arguments(const int arguments);
 void print_insufficient_arguments();
 void print_help_continuous();
 void print_result(const std::string_view result);
+// A result printed as it's converted, see CCalc::Context::set_sink. The first piece starts the line
+void print_result_piece(const std::string_view piece, const bool first);
+void print_result_end();
 void print_error(const std::string_view error);
-std::string print_mpfr(const mpfr_t& final_value, const mpfr_prec_t display_precision);
-void print_history(const std::span<const std::pair<std::string, std::string> > history);
-void print_vars(const std::unordered_map<char, std::string>& vars);
+void print_history(const History::Ring& history);
+void print_history(const History::Ring& history, const std::span<const std::size_t> positions);
+void print_vars(const Types::VarMap& vars);
+void print_stats(const CCalc::Stats& stats);
+void print_phase_counters(const Metrics::PhaseCounters& phase_counters);
+void print_job_started(const std::size_t id);
+void print_job_finished(const Jobs::Finished& job);
+void print_jobs(const std::span<const Jobs::Running> jobs);
 void print_version();
 void print_help();
 void print_invalid_flag(const std::string_view expression);
@@ -0,0 +1,138 @@
+// Author: Caden LeCluyse
+
+// Checks the integer to text conversions against mpz_get_str. format_integer splits big values by powers of 10
+// across threads, streamed results are converted a piece at a time, and an empty sink only counts the digits, so
+// each is compared on the values where a split is most likely to go wrong: powers of 10 and their neighbours,
+// which sit right on a piece boundary, and random values of a few million digits, with several thread counts.
+// Every mismatch is printed, and any of them fails the test
+#include <gmpxx.h>
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lib/ccalc.h"
+
+namespace {
+
+// Past split_conversion_digits, so format_integer splits with more than one thread
+constexpr unsigned long split_exponents[] = {999'999, 1'000'000, 2'000'001};
+constexpr std::size_t random_bits[] = {4'000'000, 10'000'000};
+constexpr unsigned thread_counts[] = {1, 2, 3, 4};
+constexpr unsigned long random_seed = 1;
+
+int failures = 0;
+int checks = 0;
+
+void check(const bool passed, const std::string_view what) {
+    ++checks;
+    if (passed) return;
+    ++failures;
+    std::cout << "FAIL: " << what << '\n';
+}
+
+[[nodiscard]] std::string reference(const mpz_class& value, const int base = 10) {
+    std::string text = value.get_str(base);
+    if (base == 10) return text;
+    const std::size_t sign = text[0] == '-' ? 1 : 0;
+    return text.insert(sign, base == 16 ? "0x" : base == 8 ? "0o" : "0b");
+}
+
+[[nodiscard]] std::vector<std::pair<std::string, mpz_class> > split_values() {
+    std::vector<std::pair<std::string, mpz_class> > values;
+    for (const unsigned long exponent : split_exponents) {
+        mpz_class power;
+        mpz_ui_pow_ui(power.get_mpz_t(), 10, exponent);
+        const std::string name = "10^" + std::to_string(exponent);
+        values.emplace_back(name, power);
+        values.emplace_back(name + "-1", power - 1);
+        values.emplace_back(name + "+1", power + 1);
+        values.emplace_back("-(" + name + "-1)", 1 - power);
+    }
+    gmp_randclass random(gmp_randinit_default);
+    random.seed(random_seed);
+    for (const std::size_t bits : random_bits) {
+        const mpz_class value = random.get_z_bits(bits);
+        values.emplace_back("random " + std::to_string(bits) + " bits", value);
+        values.emplace_back("-random " + std::to_string(bits) + " bits", -value);
+    }
+    return values;
+}
+
+void check_format_integer() {
+    for (const auto& [name, value] : split_values()) {
+        const std::string expected = reference(value);
+        for (const unsigned threads : thread_counts) {
+            check(CCalc::format_integer(value, threads) == expected,
+                  "format_integer(" + name + ") on " + std::to_string(threads) + " threads");
+        }
+    }
+}
+
+// The streamed pieces put together, and the start and digit count the result keeps of them
+struct Streamed {
+    std::string text;
+    CCalc::Result result;
+};
+
+[[nodiscard]] Streamed stream(const std::string_view expression, const unsigned threads, const bool summary) {
+    CCalc::Settings settings;
+    settings.threads = threads;
+    CCalc::Context context(settings);
+    Streamed streamed;
+    const CCalc::Sink sink = summary ? CCalc::Sink() : [&streamed](const std::string_view piece) {
+        streamed.text += piece;
+    };
+    context.set_sink(&sink);
+    streamed.result = context.evaluate(expression);
+    return streamed;
+}
+
+// Without the sign and the 0x, 0o, or 0b
+[[nodiscard]] std::size_t count_digits(const std::string_view text, const int base) {
+    return text.size() - (text[0] == '-' ? 1 : 0) - (base == 10 ? 0 : 2);
+}
+
+void check_streamed(const std::string_view expression, const mpz_class& value, const int base) {
+    const std::string expected = reference(value, base);
+    for (const unsigned threads : {1U, 3U}) {
+        const std::string name = std::string(expression) + " on " + std::to_string(threads) + " threads";
+        for (const bool summary : {false, true}) {
+            const Streamed streamed = stream(expression, threads, summary);
+            const CCalc::Result& result = streamed.result;
+            const std::string kind = summary ? "summary of " : "stream of ";
+            check(result.success && result.streamed, kind + name + " wasn't streamed");
+            if (!summary) check(streamed.text == expected, kind + name);
+            check(expected.starts_with(result.text) && result.text.size() == CCalc::streamed_prefix,
+                  kind + name + " kept the wrong start");
+            check(result.digits == count_digits(expected, base), kind + name + " counted the wrong number of digits");
+        }
+    }
+}
+
+void check_streams() {
+    // A piece is 4,000,000 digits for each thread, so the first two have a boundary on a power of 10 in them
+    mpz_class power;
+    mpz_ui_pow_ui(power.get_mpz_t(), 10, 8'000'000);
+    check_streamed("10^8000000", power, 10);
+    check_streamed("10^8000000-1", power - 1, 10);
+    check_streamed("-(10^8000000+1)", -(power + 1), 10);
+    mpz_class three;
+    mpz_ui_pow_ui(three.get_mpz_t(), 3, 2'000'000);
+    check_streamed("3^2000000", three, 10);
+    check_streamed("-(3^2000000) @hex", -three, 16);
+    check_streamed("3^2000000 @oct", three, 8);
+    check_streamed("3^2000000 @bin", three, 2);
+    check_streamed("2.0^100000", mpz_class(1) << 100'000, 10);
+}
+
+}  // namespace
+
+int main() {
+    check_format_integer();
+    check_streams();
+    std::cout << checks << " checks, " << failures << " failed\n";
+    return failures == 0 ? 0 : 1;
+}
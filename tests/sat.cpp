@@ -0,0 +1,148 @@
+// Author: Caden LeCluyse
+
+// Checks the CDCL solver. Small random 3-SAT formulas on both sides of the phase transition are compared with
+// trying every assignment, bigger ones near the transition only have their models checked, and pigeonhole formulas
+// must come back unsatisfiable. Every model the solver returns has to satisfy every clause it was given
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "logic/cdcl.h"
+
+namespace {
+
+using Clauses = std::vector<std::vector<int> >;
+
+constexpr std::size_t small_vars = 14;
+constexpr std::size_t small_formulas = 300;
+constexpr std::size_t large_vars = 250;
+constexpr std::size_t large_formulas = 20;
+constexpr unsigned random_seed = 1;
+
+int failures = 0;
+int checks = 0;
+
+void check(const bool passed, const std::string_view what) {
+    ++checks;
+    if (passed) return;
+    ++failures;
+    std::cout << "FAIL: " << what << '\n';
+}
+
+[[nodiscard]] Clauses random_3sat(const std::size_t num_vars, const std::size_t num_clauses, std::mt19937& random) {
+    std::uniform_int_distribution<int> variable(1, static_cast<int>(num_vars));
+    std::bernoulli_distribution negate;
+    Clauses clauses(num_clauses);
+    for (std::vector<int>& clause : clauses) {
+        for (int i = 0; i < 3; ++i) clause.push_back(negate(random) ? -variable(random) : variable(random));
+    }
+    return clauses;
+}
+
+// Pigeon p in hole h is variable p * holes + h + 1. Every pigeon gets a hole, and no two share one
+[[nodiscard]] Clauses pigeonhole(const int holes) {
+    const int pigeons = holes + 1;
+    Clauses clauses;
+    for (int p = 0; p < pigeons; ++p) {
+        std::vector<int>& clause = clauses.emplace_back();
+        for (int h = 0; h < holes; ++h) clause.push_back(p * holes + h + 1);
+    }
+    for (int h = 0; h < holes; ++h) {
+        for (int p = 0; p < pigeons; ++p) {
+            for (int q = p + 1; q < pigeons; ++q) clauses.push_back({-(p * holes + h + 1), -(q * holes + h + 1)});
+        }
+    }
+    return clauses;
+}
+
+// model[v - 1] is the value of DIMACS variable v
+[[nodiscard]] bool satisfies(const std::vector<bool>& model, const Clauses& clauses) {
+    for (const std::vector<int>& clause : clauses) {
+        bool satisfied = false;
+        for (const int lit : clause) satisfied |= model[static_cast<std::size_t>(std::abs(lit)) - 1] == (lit > 0);
+        if (!satisfied) return false;
+    }
+    return true;
+}
+
+[[nodiscard]] bool brute_force(const std::size_t num_vars, const Clauses& clauses) {
+    std::vector<bool> model(num_vars);
+    for (std::uint64_t assignment = 0; assignment < (std::uint64_t{1} << num_vars); ++assignment) {
+        for (std::size_t v = 0; v < num_vars; ++v) model[v] = (assignment >> v) & 1;
+        if (satisfies(model, clauses)) return true;
+    }
+    return false;
+}
+
+// Solves the formula and checks that a model was found for it if it had one. Returns the solver's answer
+Logic::SatResult solve(const std::size_t num_vars, const Clauses& clauses, const std::string& name) {
+    Logic::Solver solver(num_vars);
+    for (const std::vector<int>& clause : clauses) solver.add_clause(clause);
+    const Logic::SatResult result = solver.solve();
+    check(result != Logic::SatResult::INTERRUPTED, name + " was interrupted");
+    if (result == Logic::SatResult::SATISFIABLE) {
+        check(solver.model().size() == num_vars && satisfies(solver.model(), clauses),
+              name + " has a model that doesn't satisfy it");
+    }
+    return result;
+}
+
+void check_small(std::mt19937& random) {
+    for (std::size_t i = 0; i < small_formulas; ++i) {
+        // From 2 to 7 clauses per variable, around the transition at about 4.26
+        const std::size_t num_clauses = small_vars * 2 + i % (small_vars * 5);
+        const Clauses clauses = random_3sat(small_vars, num_clauses, random);
+        const std::string name = "small formula " + std::to_string(i);
+        const bool satisfiable = solve(small_vars, clauses, name) == Logic::SatResult::SATISFIABLE;
+        check(satisfiable == brute_force(small_vars, clauses),
+              name + (satisfiable ? " isn't satisfiable" : " is satisfiable"));
+    }
+}
+
+void check_large(std::mt19937& random) {
+    for (std::size_t i = 0; i < large_formulas; ++i) {
+        const std::size_t num_clauses = large_vars * 4 + i * large_vars / 20;
+        const Clauses clauses = random_3sat(large_vars, num_clauses, random);
+        static_cast<void>(solve(large_vars, clauses, "large formula " + std::to_string(i)));
+    }
+}
+
+void check_pigeonholes() {
+    for (const int holes : {1, 2, 5, 6, 7}) {
+        const std::string name = "pigeonhole " + std::to_string(holes);
+        const std::size_t num_vars = static_cast<std::size_t>((holes + 1) * holes);
+        check(solve(num_vars, pigeonhole(holes), name) == Logic::SatResult::UNSATISFIABLE, name + " is satisfiable");
+    }
+}
+
+void check_edge_cases() {
+    Logic::Solver empty(3);
+    check(empty.solve() == Logic::SatResult::SATISFIABLE, "a formula without clauses isn't satisfiable");
+
+    Logic::Solver contradiction(1);
+    const std::vector<int> x = {1};
+    const std::vector<int> not_x = {-1};
+    const bool consistent = contradiction.add_clause(x) && contradiction.add_clause(not_x);
+    check(!consistent || contradiction.solve() == Logic::SatResult::UNSATISFIABLE, "x and !x is satisfiable");
+
+    const Clauses tautologies = {{1, -1}, {2, 2, -3}, {-2, 3, 3}, {-1, -1}};
+    check(solve(3, tautologies, "repeated literals") == Logic::SatResult::SATISFIABLE,
+          "repeated literals aren't satisfiable");
+}
+
+}  // namespace
+
+int main() {
+    std::mt19937 random(random_seed);
+    check_small(random);
+    check_large(random);
+    check_pigeonholes();
+    check_edge_cases();
+    std::cout << checks << " checks, " << failures << " failed\n";
+    return failures == 0 ? 0 : 1;
+}